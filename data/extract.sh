@@ -11,6 +11,8 @@
 BDD_PATH=${1:-/tmp/bdd100k_images_10k/bdd100k/images/10k}
 TARGETS_PATH=${2:-./data/targets}
 OUTPUT_PATH=${3:-./data}
+# Use "jpg" to keep the images as they are, for lane_image_jpeg
+FORMAT=${4:-ppm}
 
 #
 # A list of all the images we want to move
@@ -29,7 +31,7 @@ for pic in "${sample_pics[@]}";
 do 
 	echo "Extracting picture: $pic";
 	cp "$BDD_PATH/train/$pic" "$OUTPUT_PATH/$pic" &&
-	mogrify -format ppm "$OUTPUT_PATH/$pic";
+	[ "$FORMAT" = "jpg" ] || mogrify -format "$FORMAT" "$OUTPUT_PATH/$pic";
 done
 
 echo "Finished"
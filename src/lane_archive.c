@@ -0,0 +1,499 @@
+/**
+ * @file lane_archive.c
+ * @author Matthijs Bakker
+ * @brief Pack many frames into one indexed file
+ *
+ * This code unit provides an archive format for datasets, which
+ * stores many frames after each other in one file, with a table
+ * of their positions at its end. The reader maps the archive, so
+ * any frame is found in constant time and returned as a view of
+ * the mapped file, without parsing headers or copying pixels.<br />
+ * <br />
+ * An archive starts with a header of ARCHIVE_ALIGNMENT bytes, and
+ * every frame starts at a multiple of it, so that the rows of the
+ * grayscale frames are as aligned as those of lane_plane_new.
+ */
+
+#include "lane_archive.h"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef LANE_LZ4_ENABLE
+#include <lz4.h>
+#endif
+
+#include "lane_log.h"
+
+/**
+ * @internal
+ *
+ * The start of every archive
+ */
+#define ARCHIVE_MAGIC		"LANEPACK"
+
+/**
+ * @internal
+ *
+ * The version of the layout of the archive
+ */
+#define ARCHIVE_VERSION		(1)
+
+/**
+ * @internal
+ *
+ * The alignment in bytes of the header and of each frame
+ */
+#define ARCHIVE_ALIGNMENT	(LANE_PLANE_ALIGNMENT)
+
+/**
+ * @internal
+ *
+ * @copydoc archive_header
+ */
+typedef struct archive_header	lane_archive_header_t;
+
+/**
+ * @internal
+ *
+ * @brief The start of an archive
+ *
+ * Padded to ARCHIVE_ALIGNMENT bytes, after which the first frame starts.
+ */
+struct archive_header {
+	char magic[8];
+	uint32_t version, count;
+	uint64_t index;
+	uint8_t reserved[ARCHIVE_ALIGNMENT - 24];
+};
+
+/**
+ * @internal
+ *
+ * Appends a frame to an archive and adds it to the table.
+ *
+ * @param writer	The writer
+ * @param data		The frame, in the layout that it is stored in
+ * @param entry		The entry of the frame, without its position
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+static int append(lane_archive_writer_t *writer, const uint8_t *data, lane_archive_entry_t entry);
+
+/**
+ * @internal
+ *
+ * Makes sure that a buffer is at least a certain size,
+ * without keeping its contents.
+ *
+ * @param buffer	The buffer, which may be NULL
+ * @param capacity	The size of the buffer
+ * @param size		The size that is needed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+static int reserve(uint8_t **buffer, size_t *capacity, size_t size);
+
+/*
+ * @inheritDoc
+ */
+int lane_archive_open(FILE *file, lane_archive_t **archive) {
+	lane_archive_t *out;
+	const lane_archive_header_t *header;
+	const lane_archive_entry_t *entry;
+	struct stat info;
+	size_t i, channels;
+
+	if (!file) {
+		LANE_LOG_ERROR("No file specified");
+		return 1;
+	}
+
+	if (fstat(fileno(file), &info) || !S_ISREG(info.st_mode) || (size_t) info.st_size < sizeof(lane_archive_header_t)) {
+		LANE_LOG_ERROR("Archive is not a regular file or is too small");
+		return 2;
+	}
+
+	out = calloc(1, sizeof(lane_archive_t));
+
+	if (!out) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		return 5;
+	}
+
+	// Private, so that frames can be modified like those of lane_image_ppm_map
+	out->base = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0);
+
+	if (out->base == MAP_FAILED) {
+		LANE_LOG_ERROR("Archive cannot be mapped");
+		free(out);
+
+		return 2;
+	}
+
+	out->length = info.st_size;
+
+	header = out->base;
+
+	if (memcmp(header->magic, ARCHIVE_MAGIC, sizeof(header->magic)) || header->version != ARCHIVE_VERSION) {
+		LANE_LOG_ERROR("File is not an archive of version %d", ARCHIVE_VERSION);
+		lane_archive_close(out);
+
+		return 3;
+	}
+
+	if (header->index % ARCHIVE_ALIGNMENT || header->index > out->length
+			|| header->count > (out->length - header->index) / sizeof(lane_archive_entry_t)) {
+		LANE_LOG_ERROR("Table of the archive is out of bounds");
+		lane_archive_close(out);
+
+		return 3;
+	}
+
+	out->count = header->count;
+	out->entries = (const lane_archive_entry_t *) (((uint8_t *) out->base) + header->index);
+
+	// Every frame is checked once, so reading one is just a lookup
+	for (i = 0; i < out->count; ++i) {
+		entry = &(out->entries[i]);
+		channels = entry->format == LANE_ARCHIVE_RGB ? 3 : 1;
+
+		if (entry->format > LANE_ARCHIVE_GRAY || entry->compression > LANE_ARCHIVE_LZ4
+				|| entry->stride < (size_t) entry->width * channels
+				|| entry->offset > header->index || entry->size > header->index - entry->offset
+				|| (entry->compression == LANE_ARCHIVE_RAW && entry->size != (uint64_t) entry->stride * entry->height)
+				|| (entry->format == LANE_ARCHIVE_RGB && entry->stride != (size_t) entry->width * channels)) {
+			LANE_LOG_ERROR("Frame %zu of the archive is invalid", i);
+			lane_archive_close(out);
+
+			return 4;
+		}
+	}
+
+	LANE_LOG_INFO("Archive with %zu frames mapped", out->count);
+
+	(*archive) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_archive_read(lane_archive_t *archive, size_t index, lane_image_t **image, lane_plane_t **plane) {
+	const lane_archive_entry_t *entry;
+	uint8_t *data;
+#ifdef LANE_LZ4_ENABLE
+	size_t size;
+#endif
+
+	if (index >= archive->count) {
+		LANE_LOG_ERROR("Archive has no frame %zu", index);
+		return 1;
+	}
+
+	entry = &(archive->entries[index]);
+	data = ((uint8_t *) archive->base) + entry->offset;
+
+	if (entry->compression == LANE_ARCHIVE_LZ4) {
+#ifdef LANE_LZ4_ENABLE
+		size = (size_t) entry->stride * entry->height;
+
+		if (reserve(&(archive->buffer), &(archive->capacity), size)) {
+			return 5;
+		}
+
+		if (entry->size > INT32_MAX || size > INT32_MAX
+				|| LZ4_decompress_safe((const char *) data, (char *) archive->buffer, entry->size, size) != (int) size) {
+			LANE_LOG_ERROR("Frame %zu of the archive cannot be decompressed", index);
+			return 6;
+		}
+
+		data = archive->buffer;
+#else
+		LANE_LOG_ERROR("LZ4 support was not compiled in");
+		return 2;
+#endif
+	}
+
+	(*image) = NULL;
+	(*plane) = NULL;
+
+	if (entry->format == LANE_ARCHIVE_RGB) {
+		archive->image.width = entry->width;
+		archive->image.height = entry->height;
+		archive->image.data = (lane_pixel_t *) data;
+
+		(*image) = &(archive->image);
+	} else {
+		archive->plane.width = entry->width;
+		archive->plane.height = entry->height;
+		archive->plane.type = LANE_PLANE_U8;
+		archive->plane.stride = entry->stride;
+		archive->plane.data = data;
+
+		(*plane) = &(archive->plane);
+	}
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_archive_close(lane_archive_t *archive) {
+	munmap(archive->base, archive->length);
+	free(archive->buffer);
+	free(archive);
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_archive_writer_open(FILE *file, lane_archive_writer_t **writer) {
+	lane_archive_writer_t *out;
+	lane_archive_header_t header = {0};
+
+	if (!file) {
+		LANE_LOG_ERROR("No file specified");
+		return 1;
+	}
+
+	out = calloc(1, sizeof(lane_archive_writer_t));
+
+	if (!out) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		return 5;
+	}
+
+	// The header is written again once the table is known
+	if (fwrite(&header, sizeof(header), 1, file) < 1) {
+		LANE_LOG_ERROR("Error while writing archive header");
+		free(out);
+
+		return 2;
+	}
+
+	out->file = file;
+	out->offset = sizeof(header);
+
+	(*writer) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_archive_write_image(lane_archive_writer_t *writer, const lane_image_t *const image, uint8_t compression) {
+	if (!image || !image->data) {
+		LANE_LOG_ERROR("No image specified");
+		return 1;
+	}
+
+	// The pixels already have the layout of the frame
+	return append(writer, &(image->data->r), (lane_archive_entry_t) {
+		.stride=image->width * sizeof(lane_pixel_t),
+		.width=image->width,
+		.height=image->height,
+		.format=LANE_ARCHIVE_RGB,
+		.compression=compression
+	});
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_archive_write_plane(lane_archive_writer_t *writer, const lane_plane_t *const plane, uint8_t compression) {
+	lane_plane_t *converted = NULL;
+	const lane_plane_t *source = plane;
+	size_t stride;
+	uint16_t y;
+	int result;
+
+	if (!plane || !plane->data) {
+		LANE_LOG_ERROR("No plane specified");
+		return 1;
+	}
+
+	if (plane->type != LANE_PLANE_U8) {
+		if (lane_plane_convert(plane, LANE_PLANE_U8, &converted)) {
+			return 5;
+		}
+
+		source = converted;
+	}
+
+	// The rows are padded with zeros instead of whatever the plane
+	// has in its padding, and views of files may have none at all
+	stride = ((size_t) source->width + ARCHIVE_ALIGNMENT - 1) & ~((size_t) ARCHIVE_ALIGNMENT - 1);
+	result = reserve(&(writer->buffer), &(writer->size), stride * source->height);
+
+	if (!result) {
+		for (y = 0; y < source->height; ++y) {
+			memcpy(&(writer->buffer[y * stride]), LANE_PLANE_ROW(source, uint8_t, y), source->width);
+			memset(&(writer->buffer[(y * stride) + source->width]), 0, stride - source->width);
+		}
+
+		result = append(writer, writer->buffer, (lane_archive_entry_t) {
+			.stride=stride,
+			.width=source->width,
+			.height=source->height,
+			.format=LANE_ARCHIVE_GRAY,
+			.compression=compression
+		});
+	}
+
+	if (converted) {
+		lane_plane_free(converted);
+	}
+
+	return result;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_archive_writer_close(lane_archive_writer_t *writer) {
+	lane_archive_header_t header = {0};
+	int result = 0;
+
+	memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+	header.version = ARCHIVE_VERSION;
+	header.count = writer->count;
+	header.index = writer->offset;
+
+	// The table follows the last frame, which ends aligned
+	if (fwrite(writer->entries, sizeof(lane_archive_entry_t), writer->count, writer->file) < writer->count
+			|| fseeko(writer->file, 0, SEEK_SET)
+			|| fwrite(&header, sizeof(header), 1, writer->file) < 1
+			|| fseeko(writer->file, 0, SEEK_END)
+			|| fflush(writer->file)) {
+		LANE_LOG_ERROR("Error while writing archive table");
+		result = 2;
+	} else {
+		LANE_LOG_INFO("Archive with %zu frames written", writer->count);
+	}
+
+	free(writer->entries);
+	free(writer->buffer);
+	free(writer);
+
+	return result;
+}
+
+/*
+ * @inheritDoc
+ */
+static int append(lane_archive_writer_t *writer, const uint8_t *data, lane_archive_entry_t entry) {
+	static const uint8_t padding[ARCHIVE_ALIGNMENT] = {0};
+	lane_archive_entry_t *entries;
+	size_t size = (size_t) entry.stride * entry.height, capacity;
+#ifdef LANE_LZ4_ENABLE
+	uint8_t *compressed = NULL;
+	size_t compressed_size = 0;
+	int bound;
+#endif
+
+	if (entry.compression > LANE_ARCHIVE_LZ4) {
+		LANE_LOG_ERROR("Unknown compression %d", entry.compression);
+		return 2;
+	}
+
+	if (writer->count == UINT32_MAX) {
+		LANE_LOG_ERROR("Archive is full");
+		return 3;
+	}
+
+	if (writer->count == writer->capacity) {
+		capacity = writer->capacity ? writer->capacity * 2 : 64;
+		entries = realloc(writer->entries, capacity * sizeof(lane_archive_entry_t));
+
+		if (!entries) {
+			LANE_LOG_ERROR("Unable to initialize memory");
+			return 5;
+		}
+
+		writer->entries = entries;
+		writer->capacity = capacity;
+	}
+
+	entry.size = size;
+
+	if (entry.compression == LANE_ARCHIVE_LZ4) {
+#ifdef LANE_LZ4_ENABLE
+		if (size > LZ4_MAX_INPUT_SIZE) {
+			LANE_LOG_ERROR("Frame of %zu bytes is too large to compress", size);
+			return 6;
+		}
+
+		bound = LZ4_compressBound(size);
+		compressed = malloc(bound);
+
+		if (!compressed) {
+			LANE_LOG_ERROR("Unable to initialize memory");
+			return 5;
+		}
+
+		compressed_size = LZ4_compress_default((const char *) data, (char *) compressed, size, bound);
+
+		if (!compressed_size) {
+			LANE_LOG_ERROR("Frame cannot be compressed");
+			free(compressed);
+
+			return 6;
+		}
+
+		data = compressed;
+		entry.size = compressed_size;
+#else
+		LANE_LOG_ERROR("LZ4 support was not compiled in");
+		return 2;
+#endif
+	}
+
+	entry.offset = writer->offset;
+
+	// Pad up to the next frame, so that it starts aligned as well
+	if (fwrite(data, 1, entry.size, writer->file) < entry.size
+			|| fwrite(padding, 1, -entry.size & (ARCHIVE_ALIGNMENT - 1), writer->file) < (-entry.size & (ARCHIVE_ALIGNMENT - 1))) {
+		LANE_LOG_ERROR("Error while writing frame %zu", writer->count);
+#ifdef LANE_LZ4_ENABLE
+		free(compressed);
+#endif
+
+		return 4;
+	}
+
+#ifdef LANE_LZ4_ENABLE
+	free(compressed);
+#endif
+
+	writer->offset += (entry.size + ARCHIVE_ALIGNMENT - 1) & ~((uint64_t) ARCHIVE_ALIGNMENT - 1);
+	writer->entries[(writer->count)++] = entry;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+static int reserve(uint8_t **buffer, size_t *capacity, size_t size) {
+	void *data;
+
+	if (*capacity >= size) {
+		return 0;
+	}
+
+	// Aligned, so that the rows of a plane in it are as well
+	if (posix_memalign(&data, ARCHIVE_ALIGNMENT, size ? size : 1)) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		return 1;
+	}
+
+	free(*buffer);
+
+	(*buffer) = data;
+	(*capacity) = size;
+
+	return 0;
+}
@@ -0,0 +1,193 @@
+/**
+ * @file lane_archive.h
+ * @author Matthijs Bakker
+ * @brief Pack many frames into one indexed file
+ *
+ * This code unit provides an archive format for datasets, which
+ * stores many frames after each other in one file, with a table
+ * of their positions at its end. The reader maps the archive, so
+ * any frame is found in constant time and returned as a view of
+ * the mapped file, without parsing headers or copying pixels.<br />
+ * <br />
+ * Frames are stored as RGB images or as LANE_PLANE_U8 planes, of
+ * which the rows are padded like those of lane_plane_new. Frames
+ * can also be compressed with LZ4 if compiled with LANE_LZ4_ENABLE;
+ * those are decompressed into a buffer of the reader instead.<br />
+ * <br />
+ * The numbers in an archive are in the byte order of the machine,
+ * which is little-endian on both the x86 hosts and the Zynq.
+ */
+
+#ifndef LANE_ARCHIVE_H
+#define LANE_ARCHIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lane_image.h"
+#include "lane_plane.h"
+
+/**
+ * A frame that is stored as the pixels of an image.
+ */
+#define LANE_ARCHIVE_RGB	(0)
+
+/**
+ * A frame that is stored as the rows of a LANE_PLANE_U8 plane.
+ */
+#define LANE_ARCHIVE_GRAY	(1)
+
+/**
+ * A frame that is stored as is.
+ */
+#define LANE_ARCHIVE_RAW	(0)
+
+/**
+ * A frame that is compressed with LZ4.
+ */
+#define LANE_ARCHIVE_LZ4	(1)
+
+/**
+ * @copydoc archive_entry
+ */
+typedef struct archive_entry	lane_archive_entry_t;
+
+/**
+ * @copydoc archive
+ */
+typedef struct archive		lane_archive_t;
+
+/**
+ * @copydoc archive_writer
+ */
+typedef struct archive_writer	lane_archive_writer_t;
+
+/**
+ * @brief The position and layout of a frame in an archive
+ *
+ * An entry of the table at the end of an archive. The size is
+ * that of the stored frame, which is smaller than the stride
+ * times the height if it is compressed.
+ */
+struct archive_entry {
+	uint64_t offset, size;
+	uint32_t stride;
+	uint16_t width, height;
+	uint8_t format, compression;
+	uint8_t reserved[6];
+};
+
+/**
+ * @brief An archive that is being read
+ *
+ * The image and the plane are the views of the frame that
+ * was read last, so they are changed by the next read.
+ */
+struct archive {
+	void *base;
+	size_t length, count;
+	const lane_archive_entry_t *entries;
+	uint8_t *buffer;
+	size_t capacity;
+	lane_image_t image;
+	lane_plane_t plane;
+};
+
+/**
+ * @brief An archive that is being written
+ *
+ * The table of the frames is kept in memory until
+ * the archive is closed, and then written at its end.
+ */
+struct archive_writer {
+	FILE *file;
+	uint64_t offset;
+	size_t count, capacity;
+	lane_archive_entry_t *entries;
+	uint8_t *buffer;
+	size_t size;
+};
+
+/**
+ * @brief Open an archive
+ *
+ * Maps an archive and checks its table, so that reading
+ * a frame does not have to check the archive anymore.
+ *
+ * @param file		The archive, which must be a regular file
+ * 			and can be closed after opening
+ * @param archive	Where the new archive should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_archive_open(FILE *file, lane_archive_t **archive);
+
+/**
+ * @brief Read a frame of an archive
+ *
+ * Sets either the image or the plane to a view of a frame, depending
+ * on the format it is stored in, and the other one to NULL. The view
+ * points into the mapped archive, unless the frame is compressed.<br />
+ * <br />
+ * The pixels can be modified, but this does not change the file,
+ * only the frame for the rest of the lifetime of the archive.
+ *
+ * @param archive	The archive
+ * @param index		The index of the frame
+ * @param image		Where the view of an RGB frame should be placed
+ * @param plane		Where the view of a grayscale frame should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_archive_read(lane_archive_t *archive, size_t index, lane_image_t **image, lane_plane_t **plane);
+
+/**
+ * Unmaps and deallocates an archive.
+ *
+ * @param archive	The archive to be deallocated
+ */
+void lane_archive_close(lane_archive_t *archive);
+
+/**
+ * @brief Start writing an archive
+ *
+ * @param file		The file, which must be seekable and is
+ * 			not closed by lane_archive_writer_close
+ * @param writer	Where the new writer should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_archive_writer_open(FILE *file, lane_archive_writer_t **writer);
+
+/**
+ * @brief Append an image to an archive
+ *
+ * @param writer	The writer
+ * @param image		The image, which is stored as LANE_ARCHIVE_RGB
+ * @param compression	LANE_ARCHIVE_RAW or LANE_ARCHIVE_LZ4
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_archive_write_image(lane_archive_writer_t *writer, const lane_image_t *const image, uint8_t compression);
+
+/**
+ * @brief Append a plane to an archive
+ *
+ * Planes that are not of type LANE_PLANE_U8 are converted first.
+ *
+ * @param writer	The writer
+ * @param plane		The plane, which is stored as LANE_ARCHIVE_GRAY
+ * @param compression	LANE_ARCHIVE_RAW or LANE_ARCHIVE_LZ4
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_archive_write_plane(lane_archive_writer_t *writer, const lane_plane_t *const plane, uint8_t compression);
+
+/**
+ * @brief Finish writing an archive
+ *
+ * Writes the table of the frames and the header, and
+ * deallocates the writer, also if that fails.
+ *
+ * @param writer	The writer
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_archive_writer_close(lane_archive_writer_t *writer);
+
+#endif /* LANE_ARCHIVE_H */
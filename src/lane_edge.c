@@ -0,0 +1,142 @@
+/**
+ * @file lane_edge.c
+ * @author Matthijs Bakker
+ * @brief Sparse lists of edge pixels
+ *
+ * This code unit provides a compact list of edge pixel
+ * coordinates, which the edge detection stages can emit
+ * and the line detection stages can consume directly
+ * instead of rescanning a full image.
+ */
+
+#include "lane_edge.h"
+
+#include <math.h>
+
+#include "lane_log.h"
+
+/**
+ * @internal
+ *
+ * The amount of points to allocate room for in a new list
+ */
+#define INITIAL_LIST_SIZE	(4096)
+
+/**
+ * @internal
+ *
+ * Converts radians to degrees.
+ */
+#define DEGREES(radians)	(radians * 180L / M_PI)
+
+/*
+ * @inheritDoc
+ */
+lane_edge_list_t *lane_edge_list_new(uint16_t width, uint16_t height) {
+	lane_edge_list_t *list = malloc(sizeof(lane_edge_list_t));
+
+	if (!list) {
+		LANE_LOG_ERROR("Allocating of edge list failed; aborting");
+		return NULL;
+	}
+
+	list->width = width;
+	list->height = height;
+	list->size = 0;
+	list->alloc = INITIAL_LIST_SIZE;
+	list->points = malloc(list->alloc * sizeof(lane_edge_point_t));
+
+	if (!list->points) {
+		LANE_LOG_ERROR("Allocating of edge points failed; aborting");
+		free(list);
+
+		return NULL;
+	}
+
+	return list;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_edge_list_clear(lane_edge_list_t *list, uint16_t width, uint16_t height) {
+	list->width = width;
+	list->height = height;
+	list->size = 0;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_edge_list_push(lane_edge_list_t *list, uint16_t x, uint16_t y, uint8_t theta, uint8_t magnitude) {
+	lane_edge_point_t *points;
+
+	if (list->size >= list->alloc) {
+		points = realloc(list->points, list->alloc * 2 * sizeof(lane_edge_point_t));
+
+		if (!points) {
+			LANE_LOG_ERROR("Unable to realloc memory for edge points; aborting");
+			return 1;
+		}
+
+		list->points = points;
+		list->alloc *= 2;
+	}
+
+	list->points[list->size++] = (lane_edge_point_t) {
+		.x=x,
+		.y=y,
+		.theta=theta,
+		.magnitude=magnitude
+	};
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_edge_list_from_image(const lane_image_t *const image, const double *const directions, uint8_t thres, lane_edge_list_t *list) {
+	size_t x, y, i;
+
+	lane_edge_list_clear(list, image->width, image->height);
+
+	for (y = 0; y < image->height; ++y) {
+		for (x = 0; x < image->width; ++x) {
+			i = (y * image->width) + x;
+
+			if (image->data[i].r > thres) {
+				lane_edge_list_push(list, x, y,
+						directions ? lane_edge_theta(directions[i]) : LANE_EDGE_NO_DIRECTION,
+						image->data[i].r);
+			}
+		}
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+uint8_t lane_edge_theta(double direction) {
+	long theta;
+
+	// The Sobel direction is atan2(gx, -gy), so the angle
+	// of the gradient (and the normal of the line) is a
+	// quarter turn behind it
+	theta = lround(DEGREES(direction) - 90) % 180;
+
+	// Lines at th and th+180 are the same line with a negated rho
+	if (theta < 0) {
+		theta += 180;
+	}
+
+	return theta;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_edge_list_free(lane_edge_list_t *list) {
+	free(list->points);
+	free(list);
+}
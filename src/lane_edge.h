@@ -0,0 +1,128 @@
+/**
+ * @file lane_edge.h
+ * @author Matthijs Bakker
+ * @brief Sparse lists of edge pixels
+ *
+ * This code unit provides a compact list of edge pixel
+ * coordinates, which the edge detection stages can emit
+ * and the line detection stages can consume directly
+ * instead of rescanning a full image.
+ */
+
+#ifndef LANE_EDGE_H
+#define LANE_EDGE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "lane_image.h"
+
+/**
+ * The theta value of a point whose gradient direction is unknown.
+ */
+#define LANE_EDGE_NO_DIRECTION	(0xFF)
+
+/**
+ * @copydoc edge_point
+ */
+typedef struct edge_point	lane_edge_point_t;
+
+/**
+ * @copydoc edge_list
+ */
+typedef struct edge_list	lane_edge_list_t;
+
+/**
+ * @brief A single edge pixel
+ *
+ * The location of an edge pixel together with its gradient.<br />
+ * <br />
+ * The direction is stored as the angle in degrees (0-179) of the
+ * normal of the line the pixel may be part of, which is the theta
+ * of the Hough Transform. It is LANE_EDGE_NO_DIRECTION if unknown.
+ */
+struct edge_point {
+	uint16_t x, y;
+	uint8_t theta, magnitude;
+};
+
+/**
+ * @brief A list of edge pixels
+ *
+ * A growable array of edge pixels within an image of a specific size.<br />
+ * <br />
+ * The points are stored in the order they were added, which is
+ * row-major for all of the edge detection stages.
+ */
+struct edge_list {
+	uint16_t width, height;
+	size_t size, alloc;
+	lane_edge_point_t *points;
+};
+
+/**
+ * Allocates a new empty list of edge pixels.
+ *
+ * @param width		The width in pixels of the image the edges are in
+ * @param height	The height in pixels of the image the edges are in
+ * @return		A pointer to the list, or NULL on failure
+ */
+lane_edge_list_t *lane_edge_list_new(uint16_t width, uint16_t height);
+
+/**
+ * @brief Empty a list of edge pixels
+ *
+ * Removes all points from the list without deallocating
+ * them, so that the list can be reused for the next frame.
+ *
+ * @param list		The list to empty
+ * @param width		The width in pixels of the image the edges are in
+ * @param height	The height in pixels of the image the edges are in
+ */
+void lane_edge_list_clear(lane_edge_list_t *list, uint16_t width, uint16_t height);
+
+/**
+ * Append an edge pixel to a list.
+ *
+ * @param list		The list to append to
+ * @param x		The X coordinate of the pixel
+ * @param y		The Y coordinate of the pixel
+ * @param theta		The direction, or LANE_EDGE_NO_DIRECTION
+ * @param magnitude	The gradient magnitude of the pixel
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_edge_list_push(lane_edge_list_t *list, uint16_t x, uint16_t y, uint8_t theta, uint8_t magnitude);
+
+/**
+ * @brief Collect the edge pixels of an image
+ *
+ * Replaces the contents of a list with all pixels of the image
+ * that are brighter than the threshold.
+ *
+ * @param image		The image to collect the edge pixels from
+ * @param directions	The gradient directions for each pixel in the
+ * 			format of lane_sobel_apply, or NULL if unknown
+ * @param thres		Pixels with a higher value are edges
+ * @param list		The list where the pixels will be stored
+ */
+void lane_edge_list_from_image(const lane_image_t *const image, const double *const directions, uint8_t thres, lane_edge_list_t *list);
+
+/**
+ * @brief Convert a gradient direction to a Hough angle
+ *
+ * Converts a direction as produced by lane_sobel_apply to the
+ * angle of the normal of the line through the pixel, in degrees.
+ *
+ * @param direction	The direction in radians
+ * @return		The angle in degrees from 0 up to 179
+ */
+uint8_t lane_edge_theta(double direction);
+
+/**
+ * Deallocates a list of edge pixels.
+ *
+ * @param list		The list to be deallocated
+ */
+void lane_edge_list_free(lane_edge_list_t *list);
+
+#endif /* LANE_EDGE_H */
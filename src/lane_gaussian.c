@@ -9,77 +9,574 @@
 #include "lane_gaussian.h"
 
 #include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "lane_log.h"
+
+/**
+ * @internal
+ *
+ * Amount of fractional bits of the fixed-point kernel weights
+ */
+#define WEIGHT_SHIFT						(LANE_GAUSSIAN_WEIGHT_SHIFT)
+
+/**
+ * @internal
+ *
+ * Amount of fractional bits that are kept between the two passes
+ */
+#define INTERMEDIATE_SHIFT					(8)
+
+/**
+ * @internal
+ *
+ * Amount of kernels that are remembered
+ */
+#define CACHE_SIZE						(8)
+
+/**
+ * @internal
+ *
+ * Amount of box filters that approximate a Gaussian
+ */
+#define BOX_PASSES						(4)
+
+/**
+ * @internal
+ *
+ * Amount of fractional bits of the reciprocal of a box width
+ */
+#define RECIPROCAL_SHIFT					(24)
+
+/**
+ * @internal
+ *
+ * Clamps a coordinate to the range [0, n)
+ */
+#define CLAMP(i, n)						((i) < 0 ? 0 : ((i) >= (n) ? (n) - 1 : (i)))
+
+/**
+ * @internal
+ *
+ * Amount of color channels in a pixel
+ */
+#define CHANNELS						(sizeof(lane_pixel_t) / sizeof(lane_color_t))
+
+/**
+ * @internal
+ *
+ * @copydoc kernel
+ */
+typedef struct kernel	lane_gaussian_kernel_t;
+
+/**
+ * @internal
+ *
+ * @brief A one-dimensional Gaussian kernel
+ *
+ * The fixed-point weights of a kernel, which add up to exactly
+ * 1 << WEIGHT_SHIFT. Applying the kernel horizontally and then
+ * vertically equals applying the two-dimensional kernel.
+ */
+struct kernel {
+	uint8_t size;
+	double variance;
+	uint16_t weights[UINT8_MAX];
+};
+
+/**
+ * @internal
+ *
+ * The kernels that were used most recently
+ */
+static lane_gaussian_kernel_t cache[CACHE_SIZE];
+
+/**
+ * @internal
+ *
+ * The amount of kernels in the cache, and the slot that is replaced next
+ */
+static uint8_t cache_amount, cache_next;
+
+/**
+ * @internal
+ *
+ * Guards the cache, since filters may run on multiple threads
+ */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @internal
+ *
+ * Looks up the kernel for a size and variance, computing it if
+ * it is not in the cache yet.
+ *
+ * @param size		The size of the kernel
+ * @param variance	The sigma value of the Gaussian function
+ * @param weights	Output for the weights of the kernel
+ */
+static void lookup(uint8_t size, double variance, uint16_t *weights);
+
+/**
+ * @internal
+ *
+ * Blurs an image with the method of choice, into a new
+ * image that is cropped by the inclusive kernel radius.
+ *
+ * @param src		The input image, which data will be read
+ * @param dest		The output image, which will be (over)written to
+ * @param size		The size of the kernel
+ * @param variance	The sigma value of the Gaussian function
+ * @param method	LANE_GAUSSIAN_EXACT or LANE_GAUSSIAN_BOX
+ * @param channels	The amount of channels to blur; if this is
+ * 			one, the result is copied to all channels
+ */
+static void blur_image(const lane_image_t *const src, lane_image_t **dest, uint8_t size, double variance, uint8_t method, uint8_t channels);
+
+/**
+ * @internal
+ *
+ * Blurs a number of channels of pixel data with a separable kernel.<br />
+ * <br />
+ * The output has the size of the input minus the inclusive
+ * kernel radius on each side.
+ *
+ * @param src		The first value of the input
+ * @param src_stride	The amount of values between input rows
+ * @param width		The width in pixels of the input
+ * @param height	The height in pixels of the input
+ * @param dest		The first value of the output
+ * @param dest_stride	The amount of values between output rows
+ * @param step		The amount of values per pixel
+ * @param size		The size of the kernel
+ * @param variance	The sigma value of the Gaussian function
+ * @param channels	The amount of channels to blur; if this is
+ * 			less than the step, the result is copied to all
+ */
+static void blur(const lane_color_t *src, size_t src_stride, uint16_t width, uint16_t height, lane_color_t *dest, size_t dest_stride, uint8_t step, uint8_t size, double variance, uint8_t channels);
+
+/**
+ * @internal
+ *
+ * Blurs a number of channels of pixel data with repeated box filters.
+ *
+ * @param src		The first value of the input
+ * @param src_stride	The amount of values between input rows
+ * @param width		The width in pixels of the input
+ * @param height	The height in pixels of the input
+ * @param dest		The first value of the output
+ * @param dest_stride	The amount of values between output rows
+ * @param step		The amount of values per pixel
+ * @param size		The size of the kernel that is approximated
+ * @param variance	The sigma value of the Gaussian function
+ * @param channels	The amount of channels to blur; if this is
+ * 			less than the step, the result is copied to all
+ */
+static void blur_box(const lane_color_t *src, size_t src_stride, uint16_t width, uint16_t height, lane_color_t *dest, size_t dest_stride, uint8_t step, uint8_t size, double variance, uint8_t channels);
+
+/**
+ * @internal
+ *
+ * Computes the extended box filter that approximates the kernel
+ * of the exact method after repeating it for every pass. The
+ * outer values of the box get a fractional weight, so the
+ * variance of the passes adds up to the variance of that kernel.
+ *
+ * @param size		The size of the kernel
+ * @param variance	The sigma value of the Gaussian function
+ * @param radius	Output for the radius of the box
+ * @param outer		Output for the weight of the two outer values
+ */
+static void box_extent(uint8_t size, double variance, int *radius, double *outer);
+
+/*
+ * @inheritDoc
+ */
+void lane_gaussian_apply(const lane_image_t *const src, lane_image_t **dest, uint8_t size, double variance, uint8_t method) {
+	blur_image(src, dest, size, variance, method, CHANNELS);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_gaussian_apply_gray(const lane_image_t *const src, lane_image_t **dest, uint8_t size, double variance, uint8_t method) {
+	blur_image(src, dest, size, variance, method, 1);
+}
 
 /*
  * @inheritDoc
  */
-void lane_gaussian_apply(const lane_image_t *const src, lane_image_t **dest, uint8_t size, double variance) {
+int lane_gaussian_apply_plane(const lane_plane_t *const src, lane_plane_t **dest, uint8_t size, double variance, uint8_t method) {
+	lane_plane_t *out;
+	int ir = ((size - 1) / 2) + 1;
+
+	if (src->type != LANE_PLANE_U8) {
+		LANE_LOG_ERROR("Only planes of type LANE_PLANE_U8 can be blurred; aborting");
+		return 1;
+	}
+
+	out = lane_plane_new(src->width - (2 * ir), src->height - (2 * ir), LANE_PLANE_U8);
+
+	if (!out) {
+		return 2;
+	}
+
+	if (method == LANE_GAUSSIAN_BOX) {
+		blur_box(src->data, src->stride, src->width, src->height, out->data, out->stride, 1, size, variance, 1);
+	} else {
+		blur(src->data, src->stride, src->width, src->height, out->data, out->stride, 1, size, variance, 1);
+	}
+
+	(*dest) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_gaussian_weights(uint8_t size, double variance, uint16_t *weights) {
+	lookup(size, variance, weights);
+}
+
+/*
+ * @inheritDoc
+ */
+static void blur_image(const lane_image_t *const src, lane_image_t **dest, uint8_t size, double variance, uint8_t method, uint8_t channels) {
 	lane_image_t *out;
-	lane_pixel_t next;
-	double kernel[size][size], total, r, g, b;
-	int x, y, i, j, si, ci, radius, ir;
+	int ir;
 
-	// Assuming that 'size' is an odd number,
-	// the radius of the kernel is ((size-1)/2)
-	radius = (size - 1) / 2;
-	// The inclusive radius is the radius plus the center point
-	ir = radius + 1;
-	// Reset the total value
-	total = 0;
+	// Assuming that 'size' is an odd number, the inclusive
+	// radius is the radius ((size-1)/2) plus the center point
+	ir = ((size - 1) / 2) + 1;
 
 	// It's kinda confusing because we have to crop the image.
 	// The borders of the source image won't be used if there are
 	// no pixels for the kernel te be applied to. So we always
 	// end up with a smaller output image than input image.
-	// Variable si is the source index and ci is the corrected index
 	out = lane_image_new(src->width - (2 * ir), src->height - (2 * ir));
 
-	// Calculate the values for the kernel assuming its size
-	for (y = 0; y < size; ++y) {
-		for (x = 0; x < size; ++x) {
-			kernel[y][x] = exp(((pow((y - radius), 2) + pow((x - radius), 2)) / ((2 * pow(variance, 2)))) * (-1));
-			total += kernel[y][x];
+	if (method == LANE_GAUSSIAN_BOX) {
+		blur_box(&(src->data->r), src->width * CHANNELS, src->width, src->height, &(out->data->r), out->width * CHANNELS, CHANNELS, size, variance, channels);
+	} else {
+		blur(&(src->data->r), src->width * CHANNELS, src->width, src->height, &(out->data->r), out->width * CHANNELS, CHANNELS, size, variance, channels);
+	}
+
+	(*dest) = out;
+}
+
+/*
+ * @inheritDoc
+ */
+static void blur(const lane_color_t *src, size_t src_stride, uint16_t width, uint16_t height, lane_color_t *dest, size_t dest_stride, uint8_t step, uint8_t size, double variance, uint8_t channels) {
+	const lane_color_t *in;
+	lane_color_t *o, *line;
+	uint16_t weights[size], *tmp, *t;
+	uint32_t *sums, value;
+	size_t row;
+	int x, y, i, c, radius, ir;
+
+	radius = (size - 1) / 2;
+	ir = radius + 1;
+
+	// Values of the row between the two passes
+	row = (width - (2 * ir)) * channels;
+	tmp = malloc(height * row * sizeof(uint16_t));
+	sums = malloc(row * sizeof(uint32_t));
+	line = malloc(width * channels * sizeof(lane_color_t));
+
+	if (!tmp || !sums || !line) {
+		LANE_LOG_ERROR("Unable to allocate memory for the blur; aborting");
+
+		free(tmp);
+		free(sums);
+		free(line);
+
+		return;
+	}
+
+	lookup(size, variance, weights);
+
+	// Horizontal pass over every row of the source, only
+	// computing the columns that end up in the output
+	for (y = 0; y < height; ++y) {
+		in = &(src[y * src_stride]);
+
+		// Pick the channels to blur, so that neighbouring
+		// values of a channel are always <i>channels</i> apart
+		if (channels == step) {
+			memcpy(line, in, width * step * sizeof(lane_color_t));
+		} else {
+			for (x = 0; x < width; ++x) {
+				line[x] = in[x * step];
+			}
+		}
+
+		memset(sums, 0, row * sizeof(uint32_t));
+
+		for (i = 0; i < size; ++i) {
+			in = &(line[(ir - radius + i) * channels]);
+
+			for (x = 0; x < (int) row; ++x) {
+				sums[x] += weights[i] * in[x];
+			}
+		}
+
+		// Keep some fractional bits for the next pass
+		t = &(tmp[y * row]);
+
+		for (x = 0; x < (int) row; ++x) {
+			t[x] = (sums[x] + (1 << (WEIGHT_SHIFT - INTERMEDIATE_SHIFT - 1))) >> (WEIGHT_SHIFT - INTERMEDIATE_SHIFT);
 		}
 	}
 
-	// Create a factor between 0...1 for the values
-	for (y = 0; y < size; ++y) {
-		for (x = 0; x < size; ++x) {
-			kernel[y][x] /= total;
+	// Vertical pass, which adds whole rows at a time
+	for (y = ir; y < height - ir; ++y) {
+		memset(sums, 0, row * sizeof(uint32_t));
+
+		for (i = 0; i < size; ++i) {
+			t = &(tmp[(y - radius + i) * row]);
+
+			for (x = 0; x < (int) row; ++x) {
+				sums[x] += weights[i] * t[x];
+			}
+		}
+
+		o = &(dest[(y - ir) * dest_stride]);
+
+		for (x = 0; x < (int) row; ++x) {
+			// Round to the nearest integer value
+			value = (sums[x] + (1 << (WEIGHT_SHIFT + INTERMEDIATE_SHIFT - 1))) >> (WEIGHT_SHIFT + INTERMEDIATE_SHIFT);
+
+			if (channels == step) {
+				o[x] = value;
+			} else {
+				for (c = 0; c < step; ++c) {
+					o[(x * step) + c] = value;
+				}
+			}
+		}
+	}
+
+	free(tmp);
+	free(sums);
+	free(line);
+}
+
+/*
+ * @inheritDoc
+ */
+static void blur_box(const lane_color_t *src, size_t src_stride, uint16_t width, uint16_t height, lane_color_t *dest, size_t dest_stride, uint8_t step, uint8_t size, double variance, uint8_t channels) {
+	const lane_color_t *in;
+	const uint16_t *before, *first, *last;
+	lane_color_t *o;
+	uint16_t *plane, *other, *pad, *p, *q;
+	uint32_t *sums, sum, value;
+	uint64_t inverse, edge;
+	size_t row;
+	double outer;
+	int pass, radius, x, y, c, k, ir;
+
+	ir = ((size - 1) / 2) + 1;
+
+	row = width * channels;
+	plane = malloc(height * row * sizeof(uint16_t));
+	other = malloc(height * row * sizeof(uint16_t));
+	sums = malloc(row * sizeof(uint32_t));
+
+	box_extent(size, variance, &radius, &outer);
+
+	// Room for a line with the outer values on both sides
+	pad = malloc((width + (2 * radius) + 2) * sizeof(uint16_t));
+
+	if (!plane || !other || !sums || !pad) {
+		LANE_LOG_ERROR("Unable to allocate memory for the blur; aborting");
+
+		free(plane);
+		free(other);
+		free(sums);
+		free(pad);
+
+		return;
+	}
+
+	// Keep some fractional bits, so the rounding errors
+	// of the passes do not add up
+	for (y = 0; y < height; ++y) {
+		in = &(src[y * src_stride]);
+		p = &(plane[y * row]);
+
+		for (x = 0; x < width; ++x) {
+			for (c = 0; c < channels; ++c) {
+				p[(x * channels) + c] = in[(x * step) + c] << INTERMEDIATE_SHIFT;
+			}
 		}
 	}
 
-	// Iterate over each pixel in a horizontal manner
-	for (y = ir; y < src->height - ir; ++y) {
-		for (x = ir; x < src->width - ir; ++x) {
-			r = g = b = 0.0;
-			// The source index (si) corresponds to the pixel
-			// in the src image and the corrected index (ci)
-			// is the relative index in the cropped output image
-			// This was a nightmare to debug.......
-			ci = ((y - ir) * out->width) + (x - ir);
-
-			// Convolve the kernel with the image around the
-			// current pixel to calculate the RGB value for x,y
-			for (i = 0; i < size; ++i) {
-				for (j = 0; j < size; ++j) {
-					si = (y - radius + i) * src->width + x - radius + j;
-					r += src->data[si].r * kernel[i][j];
-					g += src->data[si].g * kernel[i][j];
-					b += src->data[si].b * kernel[i][j];
+	// The weights of the inner and the outer values, scaled so
+	// that all of them add up to one
+	inverse = llround((1ULL << RECIPROCAL_SHIFT) / ((2 * radius) + 1 + (2 * outer)));
+	edge = llround((1ULL << RECIPROCAL_SHIFT) * outer / ((2 * radius) + 1 + (2 * outer)));
+
+	// Every pass is a running sum, so it costs the same for any radius.
+	// Pixels outside of the image repeat the nearest border pixel
+	for (pass = 0; pass < BOX_PASSES; ++pass) {
+		// Horizontal box, one channel at a time. The channel is
+		// copied into a padded line first, so the running sum
+		// does not have to check the borders
+		for (y = 0; y < height; ++y) {
+			p = &(plane[y * row]);
+			q = &(other[y * row]);
+
+			for (c = 0; c < channels; ++c) {
+				for (k = 0; k < width + (2 * radius) + 2; ++k) {
+					pad[k] = p[(CLAMP(k - radius - 1, width) * channels) + c];
+				}
+
+				sum = 0;
+
+				for (k = 1; k <= (2 * radius) + 1; ++k) {
+					sum += pad[k];
+				}
+
+				for (x = 0; x < width; ++x) {
+					q[(x * channels) + c] = ((sum * inverse) + ((pad[x] + pad[x + (2 * radius) + 2]) * edge) + (1ULL << (RECIPROCAL_SHIFT - 1))) >> RECIPROCAL_SHIFT;
+					sum += pad[x + (2 * radius) + 2] - pad[x + 1];
 				}
 			}
+		}
+
+		// Vertical box, sliding whole rows at a time
+		memset(sums, 0, row * sizeof(uint32_t));
 
-			// Round the values to the nearest integer value
-			// and put them in the output image
-			next.r = r;
-			next.g = g;
-			next.b = b;
+		for (k = -radius; k <= radius; ++k) {
+			q = &(other[CLAMP(k, height) * row]);
 
-			out->data[ci] = next;
+			for (x = 0; x < (int) row; ++x) {
+				sums[x] += q[x];
+			}
+		}
+
+		for (y = 0; y < height; ++y) {
+			p = &(plane[y * row]);
+			before = &(other[CLAMP(y - radius - 1, height) * row]);
+			first = &(other[CLAMP(y - radius, height) * row]);
+			last = &(other[CLAMP(y + radius + 1, height) * row]);
+
+			for (x = 0; x < (int) row; ++x) {
+				p[x] = ((sums[x] * inverse) + ((before[x] + last[x]) * edge) + (1ULL << (RECIPROCAL_SHIFT - 1))) >> RECIPROCAL_SHIFT;
+				sums[x] += last[x] - first[x];
+			}
 		}
 	}
 
-	(*dest) = out;
+	// Crop like the exact kernel, and round to the nearest integer value
+	for (y = ir; y < height - ir; ++y) {
+		p = &(plane[(y * row) + (ir * channels)]);
+		o = &(dest[(y - ir) * dest_stride]);
+
+		for (x = 0; x < (width - (2 * ir)) * channels; ++x) {
+			value = (p[x] + (1 << (INTERMEDIATE_SHIFT - 1))) >> INTERMEDIATE_SHIFT;
+			value = value > UINT8_MAX ? UINT8_MAX : value;
+
+			if (channels == step) {
+				o[x] = value;
+			} else {
+				for (c = 0; c < step; ++c) {
+					o[(x * step) + c] = value;
+				}
+			}
+		}
+	}
+
+	free(plane);
+	free(other);
+	free(sums);
+	free(pad);
+}
+
+/*
+ * @inheritDoc
+ */
+static void box_extent(uint8_t size, double variance, int *radius, double *outer) {
+	double value, total, moment, pass;
+	int i, r;
+
+	r = (size - 1) / 2;
+	total = 0;
+	moment = 0;
+
+	// The sampled kernel is cut off at its size, which makes
+	// its variance a bit smaller than sigma^2
+	for (i = -r; i <= r; ++i) {
+		value = exp(-pow(i, 2) / (2 * pow(variance, 2)));
+		total += value;
+		moment += value * i * i;
+	}
+
+	// The variance of a box of width 2r+1 is r(r+1)/3, and variances
+	// add up when filters are repeated. Take the widest box that
+	// fits, and weigh the values just outside of it to make up for
+	// the rest (Gwosdek et al., "Theoretical foundations of Gaussian
+	// convolution by extended box filtering")
+	pass = moment / total / BOX_PASSES;
+	r = floor((sqrt((12 * pass) + 1) - 1) / 2);
+
+	(*radius) = r;
+	(*outer) = ((2 * r) + 1) * (pass - (r * (r + 1) / 3.0)) / (2 * (pow(r + 1, 2) - pass));
 }
 
+/*
+ * @inheritDoc
+ */
+static void lookup(uint8_t size, double variance, uint16_t *weights) {
+	lane_gaussian_kernel_t *kernel;
+	double values[size], total;
+	int32_t remainder;
+	uint8_t i;
+	int radius;
+
+	pthread_mutex_lock(&cache_lock);
+
+	for (i = 0; i < cache_amount; ++i) {
+		if (cache[i].size == size && cache[i].variance == variance) {
+			memcpy(weights, cache[i].weights, size * sizeof(uint16_t));
+			pthread_mutex_unlock(&cache_lock);
+
+			return;
+		}
+	}
+
+	radius = (size - 1) / 2;
+	total = 0;
+
+	// The two-dimensional kernel is the product of two of these
+	for (i = 0; i < size; ++i) {
+		values[i] = exp(-pow(i - radius, 2) / (2 * pow(variance, 2)));
+		total += values[i];
+	}
+
+	// Normalize and put the rounding error in the center, so
+	// the weights add up to exactly one and keep the brightness
+	remainder = 1 << WEIGHT_SHIFT;
+
+	for (i = 0; i < size; ++i) {
+		weights[i] = lround((values[i] / total) * (1 << WEIGHT_SHIFT));
+		remainder -= weights[i];
+	}
+
+	weights[radius] += remainder;
+
+	// Replace the oldest kernel if the cache is full
+	kernel = &(cache[cache_next]);
+	kernel->size = size;
+	kernel->variance = variance;
+	memcpy(kernel->weights, weights, size * sizeof(uint16_t));
+
+	cache_next = (cache_next + 1) % CACHE_SIZE;
+	cache_amount = cache_amount < CACHE_SIZE ? cache_amount + 1 : CACHE_SIZE;
+
+	pthread_mutex_unlock(&cache_lock);
+}
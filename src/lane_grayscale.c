@@ -9,47 +9,57 @@
 
 #include "lane_grayscale.h"
 
+#include "lane_simd.h"
+
 // MATLAB rgb2gray uses the weights from Rec.ITU-R BT.601-7:
 // 0.2989 * R + 0.5870 * G + 0.1140 * B
 // source: [https://nl.mathworks.com/help/matlab/ref/rgb2gray.html]
+// These are applied in fixed-point by lane_simd_gray
 
 /**
  * @internal
+ *
+ * Amount of pixels that are converted at once
  */
-#define CHANNEL_R_WEIGHT	0.2989
+#define CHUNK			(256)
 
-/**
- * @internal
+/*
+ * @inheritDoc
  */
-#define CHANNEL_G_WEIGHT	0.5870
+void lane_grayscale_apply(lane_image_t *image) {
+	lane_color_t values[CHUNK], *rgb;
+	size_t i, n, amount;
 
-/**
- * @internal
- */
-#define CHANNEL_B_WEIGHT	0.1140
+	amount = (size_t) image->width * image->height;
+
+	// The pixels are contiguous, so the rows do not matter
+	for (i = 0; i < amount; i += n) {
+		n = amount - i < CHUNK ? amount - i : CHUNK;
+		rgb = &(image->data[i].r);
+
+		lane_simd_gray(rgb, values, n);
+		lane_simd_expand(values, rgb, n);
+	}
+}
 
 /*
  * @inheritDoc
  */
-void lane_grayscale_apply(lane_image_t *image) {
-	size_t x, y, index, value;
+int lane_grayscale_apply_plane(const lane_image_t *const src, lane_plane_t **dest) {
+	lane_plane_t *out;
+	size_t y;
 
-	// MATLAB rgb2gray uses the following constants:
-	// 0.2989 * R + 0.5870 * G + 0.1140 * B
-	// so we will use them as well
+	out = lane_plane_new(src->width, src->height, LANE_PLANE_U8);
 
-	for (y = 0; y < image->height; ++y) {
-		for (x = 0; x < image->width; ++x) {
-			index = (y * image->width) + x;
-
-			value	= image->data[index].r * CHANNEL_R_WEIGHT
-				+ image->data[index].g * CHANNEL_G_WEIGHT
-				+ image->data[index].b * CHANNEL_B_WEIGHT;
+	if (!out) {
+		return 1;
+	}
 
-			image->data[index].r = value;
-			image->data[index].g = value;
-			image->data[index].b = value;
-		}
+	for (y = 0; y < src->height; ++y) {
+		lane_simd_gray(&(src->data[y * src->width].r), LANE_PLANE_ROW(out, uint8_t, y), src->width);
 	}
-}
 
+	(*dest) = out;
+
+	return 0;
+}
@@ -11,6 +11,7 @@
 #define LANE_GRAYSCALE_H
 
 #include "lane_image.h"
+#include "lane_plane.h"
 
 /**
  * Convert a color image to grayscale.<br />
@@ -23,4 +24,16 @@
  */
 void lane_grayscale_apply(lane_image_t *image);
 
+/**
+ * Convert a color image to a grayscale plane.<br />
+ * <br />
+ * The values are the same as those of lane_grayscale_apply,
+ * but they are stored once instead of in three channels.
+ *
+ * @param src		The input image, which data will be read
+ * @param dest		Where the LANE_PLANE_U8 plane should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_grayscale_apply_plane(const lane_image_t *const src, lane_plane_t **dest);
+
 #endif /* LANE_GRAYSCALE_H */
@@ -12,6 +12,9 @@
 #include "lane_hough.h"
 
 #include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
 
 #include "lane_log.h"
 
@@ -25,23 +28,37 @@
 /**
  * @internal
  *
- * Normalizes a normal line (rho, theta) to a Cartesian line
+ * Amount of fractional bits of the fixed-point trigonometry tables
  */
-#define NORMALIZE(x, y, cx, cy, th, h)				(round((((double) x - cx) * cos(RADIANS(th)) + (((double) y - cy) * sin(RADIANS(th)))) + h))
+#define FIXED_SHIFT						(16)
+
+/**
+ * @internal
+ *
+ * Converts a real number to its fixed-point representation
+ */
+#define FIXED(value)						((int32_t) lround((value) * (1L << FIXED_SHIFT)))
+
+/**
+ * @internal
+ *
+ * Half a turn in Q6.1 form; lines at th and th+180 degrees are the same
+ */
+#define HALF_TURN						(360)
 
 /**
  * @internal
  *
  * Converts a Cartesian line to a polar line
  */
-#define POLARIZE(coord, relx, rely, line, space, o1, o2)	((double) (line.rho - ((int) space->height / 2)) - ((coord - (relx / 2)) * o1(RADIANS(line.theta)))) / o2(RADIANS(line.theta)) + (rely / 2)
+#define POLARIZE(coord, relx, rely, line, plan, angle, o1, o2)	((double) (line.rho - ((int) plan->rows / 2)) * plan->rho_step - ((coord - (relx / 2)) * o1(angle))) / o2(angle) + (rely / 2)
 
 /**
  * @internal
  *
  * Checks if a line is vertical (between 45 and 135 degrees)
  */
-#define IS_LINE_VERTICAL(line)					(line.theta >= 45 && line.theta <= 135)
+#define IS_LINE_VERTICAL(degrees)				(degrees >= 45 && degrees <= 135)
 
 /**
  * @internal
@@ -68,77 +85,1277 @@
  */
 #define INITIAL_ARRAY_SIZE					(50)
 
-/**
- * @internal
- *
- * Fills an accumulator from the image using the Hough voting technique.
- *
- * @param image		The target image, which will not be modified
- * @param space		The accumulator where votes will be written to
- * @param h		The height of the accumulator
- * @param min		The minimum value of theta to compute rho for
- * @param max		The maximum value of theta to compute rho for
- */
-static inline void quantize(const lane_image_t *const image, lane_hough_space_t *space, double h, uint8_t min, uint8_t max);
+/**
+ * @internal
+ *
+ * Amount of fractional bits of the votes in a streaming accumulator,
+ * so that small values still decay instead of getting stuck
+ */
+#define STREAM_SHIFT						(4)
+
+/**
+ * @internal
+ *
+ * The strongest decay of a streaming accumulator, which keeps the
+ * cells of a busy image far from overflowing
+ */
+#define STREAM_MAX_DECAY					(8)
+
+/**
+ * @internal
+ *
+ * Seed of the generator which picks the order of the edge pixels
+ * in the probabilistic transform, so that results are reproducible
+ */
+#define SHUFFLE_SEED						(0x9E3779B9)
+
+/**
+ * @internal
+ *
+ * State of an edge pixel in the probabilistic transform
+ */
+#define EDGE_NONE						(0)
+
+/**
+ * @internal
+ */
+#define EDGE_PENDING						(1)
+
+/**
+ * @internal
+ */
+#define EDGE_VOTED						(2)
+
+/**
+ * @internal
+ *
+ * @copydoc slab
+ */
+typedef struct slab	lane_hough_slab_t;
+
+/**
+ * @internal
+ *
+ * @brief A range of theta values that a worker votes for
+ *
+ * The arguments for a worker thread of the parallel transform.
+ */
+struct slab {
+	const lane_color_t *data;
+	size_t stride;
+	uint8_t step;
+	const lane_hough_plan_t *plan;
+	lane_hough_space_t *space;
+	uint32_t first, last;
+};
+
+/**
+ * @internal
+ *
+ * Fills an accumulator from the image using the Hough voting technique.<br />
+ * <br />
+ * The pixels may be those of an image or of a plane, which
+ * has the dimensions of the plan.
+ *
+ * @param data		The first value of the pixels, which will not be modified
+ * @param stride	The amount of values between rows
+ * @param step		The amount of values per pixel
+ * @param plan		The precomputed trigonometry tables
+ * @param space		The accumulator where votes will be written to
+ * @param first		The first accumulator column to vote for
+ * @param last		The column after the last one to vote for
+ */
+static inline void quantize(const lane_color_t *data, size_t stride, uint8_t step, const lane_hough_plan_t *const plan, lane_hough_space_t *space, uint32_t first, uint32_t last);
+
+/**
+ * @internal
+ *
+ * Entry point of a worker thread which quantizes a slab.
+ *
+ * @param arg		The slab to quantize
+ * @return		Always NULL
+ */
+static void *quantize_slab(void *arg);
+
+/**
+ * @internal
+ *
+ * Fills an accumulator from the image, only voting for the angles
+ * within a window around the gradient direction of each pixel.
+ *
+ * @param image		The target image, which will not be modified
+ * @param directions	The gradient directions for each pixel
+ * @param plan		The precomputed trigonometry tables
+ * @param space		The accumulator where votes will be written to
+ * @param window	How many degrees to vote for on each side
+ */
+static inline void quantize_gradient(const lane_image_t *const image, const double *const directions, const lane_hough_plan_t *const plan, lane_hough_space_t *space, uint8_t window);
+
+/**
+ * @internal
+ *
+ * Fills an accumulator from a list of edge pixels. Pixels with a
+ * known direction only vote within a window around it.
+ *
+ * @param edges		The edge pixels to vote for
+ * @param plan		The precomputed trigonometry tables
+ * @param space		The accumulator where votes will be written to
+ * @param window	How many degrees to vote for on each side
+ * @param first		The index of the first point to vote for
+ * @param step		Only every n-th point from the first votes
+ * @param weight	The value that each vote adds to a cell
+ */
+static inline void quantize_edges(const lane_edge_list_t *const edges, const lane_hough_plan_t *const plan, lane_hough_space_t *space, uint8_t window, size_t first, size_t step, uint32_t weight);
+
+/**
+ * @internal
+ *
+ * Allocates an empty accumulator for the plan.
+ *
+ * @param plan		The plan which determines the size
+ * @return		The accumulator, or NULL on failure
+ */
+static inline lane_hough_space_t *allocate(const lane_hough_plan_t *const plan);
+
+/**
+ * @internal
+ *
+ * Compares two candidates for sorting them by descending votes.
+ */
+static int compare_candidates(const void *a, const void *b);
+
+/**
+ * @internal
+ *
+ * Compares two candidates for sorting them by their position.
+ */
+static int compare_indices(const void *a, const void *b);
+
+/**
+ * @internal
+ *
+ * Computes the accumulator row of the line through a pixel.
+ *
+ * @param plan		The precomputed trigonometry tables
+ * @param xc		The X coordinate relative to the image center
+ * @param yc		The Y coordinate relative to the image center
+ * @param th		The accumulator column (theta)
+ * @return		The accumulator row (rho)
+ */
+static inline uint32_t bin(const lane_hough_plan_t *const plan, int32_t xc, int32_t yc, uint32_t th);
+
+/**
+ * @internal
+ *
+ * Finds the theta step of the plan which is nearest to an angle.
+ *
+ * @param plan		The plan with the size of the steps
+ * @param degrees	The angle in degrees, below 180
+ * @return		The step, counted from 0 degrees
+ */
+static inline int32_t nearest_step(const lane_hough_plan_t *const plan, uint8_t degrees);
+
+/**
+ * @internal
+ *
+ * Checks if a column lies within one of the spans of the plan.
+ *
+ * @param plan		The plan with the allowed spans
+ * @param column	The column, which may be out of range
+ * @return		Whether votes may be cast for the column
+ */
+static inline bool allowed(const lane_hough_plan_t *const plan, int32_t column);
+
+/**
+ * @internal
+ *
+ * Checks if a pixel lies within the region of interest of the plan.
+ *
+ * @param plan		The plan with the horizon and mask
+ * @param x		The x coordinate of the pixel
+ * @param y		The y coordinate of the pixel
+ * @return		Whether the pixel may vote
+ */
+static inline bool inside(const lane_hough_plan_t *const plan, uint16_t x, uint16_t y);
+
+/**
+ * @internal
+ *
+ * Clips the spans of the plan to a range of columns.
+ *
+ * @param plan		The plan with the allowed spans
+ * @param first		The first column of the range
+ * @param last		The column after the range
+ * @param spans		Output for the clipped spans, which must
+ * 			have room for all spans of the plan
+ * @return		The amount of clipped spans
+ */
+static inline uint8_t clip_spans(const lane_hough_plan_t *const plan, uint32_t first, uint32_t last, lane_hough_span_t *spans);
+
+/**
+ * @internal
+ *
+ * Compares two doubles for sorting them in ascending order.
+ */
+static int compare_doubles(const void *a, const void *b);
+
+/**
+ * @internal
+ *
+ * Compares two spans for sorting them by their start.
+ */
+static int compare_spans(const void *a, const void *b);
+
+/**
+ * @internal
+ *
+ * Adds a weight to an accumulator cell, saturating if the cells are narrow.
+ *
+ * @param cell		The cell to vote for
+ * @param weight	The value to add
+ */
+static inline void vote(lane_hough_cell_t *cell, uint32_t weight);
+
+/**
+ * @internal
+ *
+ * Takes a weight back from an accumulator cell, the opposite of vote.<br />
+ * <br />
+ * A narrow cell that has saturated no longer knows how many votes it
+ * received, so it keeps its maximum instead of becoming too small.
+ *
+ * @param cell		The cell to take the vote back from
+ * @param weight	The value that was added
+ */
+static inline void unvote(lane_hough_cell_t *cell, uint32_t weight);
+
+/**
+ * @internal
+ *
+ * Generates the next pseudo-random number using xorshift32.
+ *
+ * @param state		The state of the generator, which is updated
+ * @return		The next number in the sequence
+ */
+static inline uint32_t shuffle_next(uint32_t *state);
+
+/**
+ * @internal
+ *
+ * @copydoc candidate
+ */
+typedef struct candidate	lane_hough_candidate_t;
+
+/**
+ * @internal
+ *
+ * @brief A peak in the accumulator which may become a line
+ *
+ * An entry of the heap that keeps the most voted peaks.
+ */
+struct candidate {
+	uint32_t votes, index;
+};
+
+/**
+ * @internal
+ *
+ * Computes the maximum of every window of (2*KERNEL_SIZE+1) values
+ * along one row or column of the accumulator, using the van Herk/
+ * Gil-Werman algorithm. This costs three comparisons per value
+ * regardless of the size of the window.
+ *
+ * @param src		The first value of the row or column
+ * @param dest		Where the maxima will be written to
+ * @param n		The amount of values in the row or column
+ * @param stride	The distance between two consecutive values
+ * @param scratch	Buffer of at least 3*(n+2*KERNEL_SIZE) values
+ */
+static inline void dilate(const lane_hough_cell_t *src, lane_hough_cell_t *dest, uint32_t n, uint32_t stride, lane_hough_cell_t *scratch);
+
+/**
+ * @internal
+ *
+ * Checks if candidate a has received less votes than candidate b.
+ * Ties are broken by position, so the extraction is deterministic.
+ */
+static inline bool weaker(lane_hough_candidate_t a, lane_hough_candidate_t b);
+
+/**
+ * @internal
+ *
+ * Restores the order of a min-heap after its root has been replaced.
+ *
+ * @param heap		The heap of candidates
+ * @param size		The amount of candidates in the heap
+ * @param i		The index of the candidate to move down
+ */
+static inline void sift_down(lane_hough_candidate_t *heap, size_t size, size_t i);
+
+/*
+ * @inheritDoc
+ */
+lane_hough_plan_t *lane_hough_plan_new(uint16_t width, uint16_t height, uint8_t min, uint8_t max) {
+	return lane_hough_plan_new_steps(width, height, min, max, 1, 2);
+}
+
+/*
+ * @inheritDoc
+ */
+lane_hough_plan_t *lane_hough_plan_new_steps(uint16_t width, uint16_t height, uint8_t min, uint8_t max, uint8_t rho_step, uint8_t theta_step) {
+	lane_hough_plan_t *plan;
+	uint32_t half;
+	double h, angle;
+	uint16_t th, first, last;
+
+	if (!rho_step || !theta_step || HALF_TURN % theta_step) {
+		LANE_LOG_ERROR("Invalid steps (rho=%d, theta=%d) for plan", rho_step, theta_step);
+		return NULL;
+	}
+
+	// The first steps at or after min and max
+	first = ((2 * min) + theta_step - 1) / theta_step;
+	last = ((2 * max) + theta_step - 1) / theta_step;
+
+	if (min >= max || first >= last) {
+		LANE_LOG_ERROR("Invalid theta range [%d, %d) for plan", min, max);
+		return NULL;
+	}
+
+	plan = malloc(sizeof(lane_hough_plan_t));
+
+	if (!plan) {
+		LANE_LOG_ERROR("Allocating of plan failed; aborting");
+		return NULL;
+	}
+
+	// The largest distance of a pixel from the center, and the
+	// amount of rows on each side of rho=0 needed to cover it
+	h = (sqrt(HEIGHT_FACTOR) * (double)(height>width?height:width)) / HEIGHT_FACTOR;
+	half = ceil(h / rho_step);
+
+	plan->width = width;
+	plan->height = height;
+	plan->min = min;
+	plan->max = max;
+	plan->max_lines = 0;
+	plan->rho_step = rho_step;
+	plan->theta_step = theta_step;
+	plan->first = first;
+	plan->columns = last - first;
+	plan->rows = (2 * half) + 1;
+	plan->horizon = 0;
+	plan->roi = NULL;
+	plan->spans_amount = 1;
+	plan->spans = malloc(sizeof(lane_hough_span_t));
+	plan->cos = malloc(plan->columns * sizeof(int32_t));
+	plan->sin = malloc(plan->columns * sizeof(int32_t));
+
+	if (!plan->cos || !plan->sin || !plan->spans) {
+		LANE_LOG_ERROR("Allocating of trigonometry tables failed; aborting");
+		lane_hough_plan_free(plan);
+
+		return NULL;
+	}
+
+	// Put rho=0 in the middle row, and add half a step to the
+	// offset so the shift rounds to the nearest bin
+	plan->offset = FIXED(half) + (1L << (FIXED_SHIFT - 1));
+
+	// Divide by the rho step beforehand, so the tables
+	// directly give the row in the accumulator
+	for (th = first; th < last; ++th) {
+		angle = RADIANS(th * theta_step / 2.0);
+
+		plan->cos[th - first] = FIXED(cos(angle) / rho_step);
+		plan->sin[th - first] = FIXED(sin(angle) / rho_step);
+	}
+
+	plan->spans[0] = (lane_hough_span_t) {
+		.start=0,
+		.end=plan->columns
+	};
+
+	return plan;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_hough_plan_set_horizon(lane_hough_plan_t *plan, uint16_t horizon) {
+	plan->horizon = horizon < plan->height ? horizon : plan->height;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_hough_plan_set_roi(lane_hough_plan_t *plan, const lane_hough_vertex_t *const vertices, size_t amount) {
+	const lane_hough_vertex_t *a, *b;
+	uint8_t *roi;
+	double *crossings, yc;
+	int32_t start, end;
+	size_t count, i, k;
+	uint16_t y;
+
+	free(plan->roi);
+	plan->roi = NULL;
+
+	if (!amount) {
+		return 0;
+	}
+
+	roi = calloc(plan->width * plan->height, sizeof(uint8_t));
+	crossings = malloc(amount * sizeof(double));
+
+	if (!roi || !crossings) {
+		LANE_LOG_ERROR("Allocating of region of interest failed; aborting");
+
+		free(roi);
+		free(crossings);
+
+		return 1;
+	}
+
+	// Fill the pixels whose centers lie within the polygon by
+	// pairing up the edges that each row crosses (even-odd rule)
+	for (y = 0; y < plan->height; ++y) {
+		yc = y + 0.5;
+		count = 0;
+
+		for (i = 0; i < amount; ++i) {
+			a = &(vertices[i]);
+			b = &(vertices[(i + 1) % amount]);
+
+			if ((a->y > yc) != (b->y > yc)) {
+				crossings[count++] = a->x + ((yc - a->y) * (b->x - a->x)) / (b->y - a->y);
+			}
+		}
+
+		qsort(crossings, count, sizeof(double), compare_doubles);
+
+		for (i = 0; i + 1 < count; i += 2) {
+			start = ceil(crossings[i] - 0.5);
+			end = ceil(crossings[i + 1] - 0.5);
+			start = start > 0 ? start : 0;
+			end = end < plan->width ? end : plan->width;
+
+			for (k = start; (int32_t) k < end; ++k) {
+				roi[(y * plan->width) + k] = 1;
+			}
+		}
+	}
+
+	free(crossings);
+
+	plan->roi = roi;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_hough_plan_set_bands(lane_hough_plan_t *plan, const lane_hough_band_t *const bands, size_t amount) {
+	lane_hough_span_t *spans;
+	int32_t start, end;
+	size_t count, i;
+
+	spans = malloc((amount ? amount : 1) * sizeof(lane_hough_span_t));
+
+	if (!spans) {
+		LANE_LOG_ERROR("Allocating of spans failed; aborting");
+		return 1;
+	}
+
+	count = 0;
+
+	// Convert the angles into columns, like the range of the plan
+	for (i = 0; i < amount; ++i) {
+		start = (((2 * bands[i].min) + plan->theta_step - 1) / plan->theta_step) - plan->first;
+		end = (((2 * bands[i].max) + plan->theta_step - 1) / plan->theta_step) - plan->first;
+		start = start > 0 ? start : 0;
+		end = end < plan->columns ? end : plan->columns;
+
+		if (start < end) {
+			spans[count++] = (lane_hough_span_t) {
+				.start=start,
+				.end=end
+			};
+		}
+	}
+
+	if (!amount) {
+		spans[count++] = (lane_hough_span_t) {
+			.start=0,
+			.end=plan->columns
+		};
+	}
+
+	if (!count || count > UINT8_MAX) {
+		LANE_LOG_ERROR("Bands do not fit within the range [%d, %d) of the plan", plan->min, plan->max);
+		free(spans);
+
+		return 1;
+	}
+
+	// Merge overlapping spans, so no column is voted for twice
+	qsort(spans, count, sizeof(lane_hough_span_t), compare_spans);
+
+	for (amount = 0, i = 1; i < count; ++i) {
+		if (spans[i].start <= spans[amount].end) {
+			spans[amount].end = spans[i].end > spans[amount].end ? spans[i].end : spans[amount].end;
+		} else {
+			spans[++amount] = spans[i];
+		}
+	}
+
+	free(plan->spans);
+
+	plan->spans = spans;
+	plan->spans_amount = amount + 1;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_hough_plan_free(lane_hough_plan_t *plan) {
+	free(plan->cos);
+	free(plan->sin);
+	free(plan->spans);
+	free(plan->roi);
+	free(plan);
+}
+
+/*
+ * @inheritDoc
+ */
+size_t lane_hough_apply(const lane_image_t *const src, const lane_hough_plan_t *const plan, lane_hough_space_t **rspace, lane_hough_normal_t **rnormals, uint16_t thres) {
+	lane_hough_space_t *space;
+	lane_hough_normal_t *lines = NULL;
+	size_t lines_amount;
+
+	if (src->width != plan->width || src->height != plan->height) {
+		LANE_LOG_ERROR("Image (%d x %d) does not match plan (%d x %d); aborting",
+				src->width, src->height, plan->width, plan->height);
+
+		return 0;
+	}
+
+	space = allocate(plan);
+	
+	if (!space) {
+		return 0;
+	}
+
+	quantize(&(src->data->r), src->width * sizeof(lane_pixel_t), sizeof(lane_pixel_t), plan, space, 0, space->width);
+	lines_amount = lane_hough_peaks(space, plan, thres, &lines);
+
+	(*rspace) = space;
+	(*rnormals) = lines;
+
+	return lines_amount;
+}
+
+/*
+ * @inheritDoc
+ */
+size_t lane_hough_apply_plane(const lane_plane_t *const src, const lane_hough_plan_t *const plan, lane_hough_space_t **rspace, lane_hough_normal_t **rnormals, uint16_t thres) {
+	lane_hough_space_t *space;
+	lane_hough_normal_t *lines = NULL;
+	size_t lines_amount;
+
+	if (src->type != LANE_PLANE_U8) {
+		LANE_LOG_ERROR("Only planes of type LANE_PLANE_U8 are supported; aborting");
+
+		return 0;
+	}
+
+	if (src->width != plan->width || src->height != plan->height) {
+		LANE_LOG_ERROR("Plane (%d x %d) does not match plan (%d x %d); aborting",
+				src->width, src->height, plan->width, plan->height);
+
+		return 0;
+	}
+
+	space = allocate(plan);
+
+	if (!space) {
+		return 0;
+	}
+
+	quantize(src->data, src->stride, 1, plan, space, 0, space->width);
+	lines_amount = lane_hough_peaks(space, plan, thres, &lines);
+
+	(*rspace) = space;
+	(*rnormals) = lines;
+
+	return lines_amount;
+}
+
+/*
+ * @inheritDoc
+ */
+size_t lane_hough_apply_parallel(const lane_image_t *const src, const lane_hough_plan_t *const plan, uint8_t threads, lane_hough_space_t **rspace, lane_hough_normal_t **rnormals, uint16_t thres) {
+	lane_hough_space_t *space;
+	lane_hough_normal_t *lines = NULL;
+	size_t lines_amount;
+	uint8_t i;
+
+	if (src->width != plan->width || src->height != plan->height) {
+		LANE_LOG_ERROR("Image (%d x %d) does not match plan (%d x %d); aborting",
+				src->width, src->height, plan->width, plan->height);
+
+		return 0;
+	}
+
+	space = allocate(plan);
+
+	if (!space) {
+		return 0;
+	}
+
+	// There's no use in having more workers than columns
+	if (threads > space->width) {
+		threads = space->width;
+	}
+
+	if (threads <= 1) {
+		quantize(&(src->data->r), src->width * sizeof(lane_pixel_t), sizeof(lane_pixel_t), plan, space, 0, space->width);
+	} else {
+		pthread_t workers[threads];
+		bool started[threads];
+		lane_hough_slab_t slabs[threads];
+
+		// Divide the columns as evenly as possible over the workers
+		for (i = 0; i < threads; ++i) {
+			slabs[i] = (lane_hough_slab_t) {
+				.data=&(src->data->r),
+				.stride=src->width * sizeof(lane_pixel_t),
+				.step=sizeof(lane_pixel_t),
+				.plan=plan,
+				.space=space,
+				.first=(space->width * i) / threads,
+				.last=(space->width * (i + 1)) / threads
+			};
+
+			started[i] = !pthread_create(&workers[i], NULL, quantize_slab, &slabs[i]);
+
+			// Do the work on this thread if no worker could be spawned
+			if (!started[i]) {
+				LANE_LOG_ERROR("Unable to spawn worker %d; quantizing on caller", i);
+				quantize_slab(&slabs[i]);
+			}
+		}
+
+		for (i = 0; i < threads; ++i) {
+			if (started[i]) {
+				pthread_join(workers[i], NULL);
+			}
+		}
+	}
+
+	lines_amount = lane_hough_peaks(space, plan, thres, &lines);
+
+	(*rspace) = space;
+	(*rnormals) = lines;
+
+	return lines_amount;
+}
+
+/*
+ * @inheritDoc
+ */
+size_t lane_hough_apply_gradient(const lane_image_t *const src, const double *const directions, const lane_hough_plan_t *const plan, uint8_t window, lane_hough_space_t **rspace, lane_hough_normal_t **rnormals, uint16_t thres) {
+	lane_hough_space_t *space;
+	lane_hough_normal_t *lines = NULL;
+	size_t lines_amount;
+
+	if (src->width != plan->width || src->height != plan->height) {
+		LANE_LOG_ERROR("Image (%d x %d) does not match plan (%d x %d); aborting",
+				src->width, src->height, plan->width, plan->height);
+
+		return 0;
+	}
+
+	space = allocate(plan);
+
+	if (!space) {
+		return 0;
+	}
+
+	quantize_gradient(src, directions, plan, space, window);
+	lines_amount = lane_hough_peaks(space, plan, thres, &lines);
+
+	(*rspace) = space;
+	(*rnormals) = lines;
+
+	return lines_amount;
+}
+
+/*
+ * @inheritDoc
+ */
+size_t lane_hough_apply_edges(const lane_edge_list_t *const edges, const lane_hough_plan_t *const plan, uint8_t window, lane_hough_space_t **rspace, lane_hough_normal_t **rnormals, uint16_t thres) {
+	lane_hough_space_t *space;
+	lane_hough_normal_t *lines = NULL;
+	size_t lines_amount;
+
+	if (edges->width != plan->width || edges->height != plan->height) {
+		LANE_LOG_ERROR("Edges (%d x %d) do not match plan (%d x %d); aborting",
+				edges->width, edges->height, plan->width, plan->height);
+
+		return 0;
+	}
+
+	space = allocate(plan);
+
+	if (!space) {
+		return 0;
+	}
+
+	quantize_edges(edges, plan, space, window, 0, 1, 1);
+	lines_amount = lane_hough_peaks(space, plan, thres, &lines);
+
+	(*rspace) = space;
+	(*rnormals) = lines;
+
+	return lines_amount;
+}
+
+/*
+ * @inheritDoc
+ */
+lane_hough_stream_t *lane_hough_stream_new(const lane_hough_plan_t *const plan, uint8_t decay, uint8_t subsample) {
+	lane_hough_stream_t *stream;
+	lane_hough_space_t *space;
+
+	if (decay > STREAM_MAX_DECAY || !subsample) {
+		LANE_LOG_ERROR("Invalid arguments passed to %s", __func__);
+		return NULL;
+	}
+
+	stream = malloc(sizeof(lane_hough_stream_t));
+	space = allocate(plan);
+
+	if (!stream || !space) {
+		LANE_LOG_ERROR("Allocating of stream failed; aborting");
+
+		free(stream);
+
+		if (space) {
+			free(space->acc);
+			free(space);
+		}
+
+		return NULL;
+	}
+
+	stream->space = space;
+	stream->plan = plan;
+	stream->decay = decay;
+	stream->subsample = subsample;
+	stream->phase = 0;
+
+	return stream;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_hough_stream_reset(lane_hough_stream_t *stream) {
+	memset(stream->space->acc, 0, stream->space->size * sizeof(lane_hough_cell_t));
+	stream->phase = 0;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_hough_stream_free(lane_hough_stream_t *stream) {
+	free(stream->space->acc);
+	free(stream->space);
+	free(stream);
+}
+
+/*
+ * @inheritDoc
+ */
+size_t lane_hough_stream_apply(lane_hough_stream_t *stream, const lane_edge_list_t *const edges, uint8_t window, lane_hough_normal_t **rnormals, uint16_t thres) {
+	const lane_hough_plan_t *plan = stream->plan;
+	lane_hough_space_t *space = stream->space;
+	lane_hough_normal_t *lines = NULL;
+	lane_hough_cell_t *cell, *end;
+	uint64_t scaled;
+	size_t lines_amount;
+
+	if (edges->width != plan->width || edges->height != plan->height) {
+		LANE_LOG_ERROR("Edges (%d x %d) do not match plan (%d x %d); aborting",
+				edges->width, edges->height, plan->width, plan->height);
+
+		return 0;
+	}
+
+	// Let the old votes fade out instead of clearing them; without
+	// decay the accumulator only holds the votes of this frame
+	if (stream->decay) {
+		for (cell = space->acc, end = space->acc + space->size; cell < end; ++cell) {
+			*cell -= *cell >> stream->decay;
+		}
+	} else {
+		memset(space->acc, 0, space->size * sizeof(lane_hough_cell_t));
+	}
+
+	// Rotate through the subsets, so every pixel of a static line
+	// has voted once after <i>subsample</i> frames
+	quantize_edges(edges, plan, space, window, stream->phase, stream->subsample, 1 << STREAM_SHIFT);
+	stream->phase = (stream->phase + 1) % stream->subsample;
+
+	// A line that is seen every frame settles where the decay
+	// removes as many votes as a frame adds
+	scaled = ((uint64_t) thres << (STREAM_SHIFT + stream->decay)) / stream->subsample;
+
+	lines_amount = lane_hough_peaks(space, plan, scaled < LANE_HOUGH_CELL_MAX ? scaled : LANE_HOUGH_CELL_MAX, &lines);
+
+	(*rnormals) = lines;
+
+	return lines_amount;
+}
+
+/*
+ * @inheritDoc
+ */
+size_t lane_hough_apply_hierarchical(const lane_edge_list_t *const edges, const lane_hough_plan_t *const plan, uint8_t rho_factor, uint8_t theta_factor, uint8_t decimation, lane_hough_normal_t **rnormals, uint16_t thres) {
+	const lane_edge_point_t *point, *end;
+	lane_hough_plan_t flat;
+	lane_hough_space_t coarse, local;
+	lane_hough_normal_t *peaks = NULL, *refined = NULL, *results;
+	lane_hough_candidate_t *found;
+	uint32_t columns, r0, r1, t0, t1, margin, center, th, r, coarse_thres;
+	int32_t cx, cy, xc, yc, rc;
+	size_t peaks_amount, refined_amount, amount, alloc, i, j, k;
+
+	if (edges->width != plan->width || edges->height != plan->height) {
+		LANE_LOG_ERROR("Edges (%d x %d) do not match plan (%d x %d); aborting",
+				edges->width, edges->height, plan->width, plan->height);
+
+		return 0;
+	}
+
+	if (!rho_factor || !theta_factor || !decimation) {
+		LANE_LOG_ERROR("Invalid arguments passed to %s", __func__);
+		return 0;
+	}
+
+	columns = plan->columns;
+	cx = edges->width / 2;
+	cy = edges->height / 2;
+	amount = 0;
+	alloc = INITIAL_ARRAY_SIZE;
+
+	// The peak extraction only needs the first column and the cap
+	// of a plan, so a copy without those serves the coarse level
+	flat = *plan;
+	flat.first = 0;
+	flat.max_lines = 0;
+
+	coarse.width = (columns + theta_factor - 1) / theta_factor;
+	coarse.height = (plan->rows + rho_factor - 1) / rho_factor;
+	coarse.size = coarse.width * coarse.height;
+	coarse.acc = calloc(coarse.size, sizeof(lane_hough_cell_t));
+
+	// A neighbourhood of 3 by 3 coarse cells is refined at a time
+	local.width = 3 * theta_factor;
+	local.height = 3 * rho_factor;
+	local.size = local.width * local.height;
+	local.acc = malloc(local.size * sizeof(lane_hough_cell_t));
+
+	found = malloc(alloc * sizeof(lane_hough_candidate_t));
+
+	if (!coarse.acc || !local.acc || !found) {
+		LANE_LOG_ERROR("Unable to allocate memory for accumulators; aborting");
+
+		free(coarse.acc);
+		free(local.acc);
+		free(found);
+
+		return 0;
+	}
+
+	bool usable[coarse.width];
+
+	// A coarse column is voted for if any of its columns is allowed
+	for (th = 0; th < coarse.width; ++th) {
+		usable[th] = false;
+
+		for (r = th * theta_factor; r < (th + 1) * theta_factor && r < columns; ++r) {
+			usable[th] = usable[th] || allowed(plan, r);
+		}
+	}
+
+	// Vote into the coarse grid with a subset of the pixels, using
+	// the angle in the center of each coarse column
+	for (point = edges->points, end = edges->points + edges->size; point < end; point += decimation) {
+		if (!inside(plan, point->x, point->y)) {
+			continue;
+		}
+
+		xc = point->x - cx;
+		yc = point->y - cy;
+
+		for (th = 0; th < coarse.width; ++th) {
+			if (!usable[th]) {
+				continue;
+			}
+
+			center = (th * theta_factor) + (theta_factor / 2);
+			center = center < columns ? center : columns - 1;
+
+			vote(&(coarse.acc[th + (coarse.width * (bin(plan, xc, yc, center) / rho_factor))]), 1);
+		}
+	}
+
+	// The votes of a line are spread over a fraction of the pixels
+	// and may fall into two neighbouring coarse cells, so be lenient,
+	// but not so lenient that every empty coarse cell becomes a peak
+	coarse_thres = thres / decimation / 2;
+	coarse_thres = coarse_thres ? coarse_thres : 1;
+
+	peaks_amount = lane_hough_peaks(&coarse, &flat, coarse_thres, &peaks);
+
+	for (i = 0; i < peaks_amount; ++i) {
+		// The fine neighbourhood of the coarse peak
+		r0 = peaks[i].rho > 0 ? (peaks[i].rho - 1) * rho_factor : 0;
+		t0 = peaks[i].theta > 0 ? (peaks[i].theta - 1) * theta_factor : 0;
+		r1 = r0 + local.height < plan->rows ? r0 + local.height : plan->rows;
+		t1 = t0 + local.width < columns ? t0 + local.width : columns;
+
+		// Rho can only change this much over the range of angles,
+		// so most pixels can be skipped after checking one angle
+		center = (t0 + t1) / 2;
+		margin = ceil(sin(RADIANS((t1 - t0) * plan->theta_step / 2.0)) * plan->rows / 2) + 1;
+
+		memset(local.acc, 0, local.size * sizeof(lane_hough_cell_t));
+
+		for (point = edges->points, end = edges->points + edges->size; point < end; ++point) {
+			if (!inside(plan, point->x, point->y)) {
+				continue;
+			}
+
+			xc = point->x - cx;
+			yc = point->y - cy;
+			rc = bin(plan, xc, yc, center);
+
+			if (rc + (int32_t) margin < (int32_t) r0 || rc >= (int32_t) (r1 + margin)) {
+				continue;
+			}
+
+			for (th = t0; th < t1; ++th) {
+				r = bin(plan, xc, yc, th);
+
+				if (r >= r0 && r < r1 && allowed(plan, th)) {
+					vote(&(local.acc[(th - t0) + (local.width * (r - r0))]), 1);
+				}
+			}
+		}
+
+		refined_amount = lane_hough_peaks(&local, &flat, thres, &refined);
+
+		for (j = 0; j < refined_amount; ++j) {
+			refined[j].rho += r0;
+			refined[j].theta += t0;
+
+			// Neighbourhoods of coarse peaks may overlap
+			for (k = 0; k < amount; ++k) {
+				if (found[k].index == (refined[j].rho * columns) + refined[j].theta) {
+					break;
+				}
+			}
+
+			if (k < amount) {
+				continue;
+			}
+
+			if (amount >= alloc) {
+				alloc *= 2;
+				found = realloc(found, alloc * sizeof(lane_hough_candidate_t));
+
+				if (!found) {
+					LANE_LOG_ERROR("Unable to realloc memory for lines; aborting");
+
+					free(coarse.acc);
+					free(local.acc);
+					free(peaks);
+					free(refined);
+
+					return 0;
+				}
+			}
+
+			found[amount++] = (lane_hough_candidate_t) {
+				.votes=local.acc[(refined[j].theta - t0) + (local.width * (refined[j].rho - r0))],
+				.index=(refined[j].rho * columns) + refined[j].theta
+			};
+		}
+
+		free(refined);
+		refined = NULL;
+	}
+
+	// Order the lines like lane_hough_peaks would
+	if (plan->max_lines) {
+		qsort(found, amount, sizeof(lane_hough_candidate_t), compare_candidates);
+
+		if (amount > plan->max_lines) {
+			amount = plan->max_lines;
+		}
+	} else {
+		qsort(found, amount, sizeof(lane_hough_candidate_t), compare_indices);
+	}
+
+	results = calloc(amount ? amount : 1, sizeof(lane_hough_normal_t));
+
+	if (!results) {
+		LANE_LOG_ERROR("Unable to allocate memory for lines; aborting");
+		amount = 0;
+	}
+
+	for (i = 0; results && i < amount; ++i) {
+		results[i] = (lane_hough_normal_t) {
+			.rho=found[i].index / columns,
+			.theta=plan->first + (found[i].index % columns)
+		};
+	}
+
+	free(coarse.acc);
+	free(local.acc);
+	free(peaks);
+	free(found);
+
+	(*rnormals) = results;
+
+	return amount;
+}
+
+/*
+ * @inheritDoc
+ */
+size_t lane_hough_apply_probabilistic(const lane_image_t *const src, const lane_hough_plan_t *const plan, uint16_t thres, uint16_t min_length, uint16_t max_gap, lane_hough_resolved_line_t **rsegments) {
+	lane_hough_resolved_line_t *results;
+	const lane_hough_span_t *span, *last;
+	lane_hough_cell_t *acc, *cell;
+	uint32_t *points, columns, state, best, votes, th, t, r, i, j, tmp;
+	uint8_t *mask, *m;
+	int32_t cx, cy, x0, y0, x, y, dx, dy, px, py, sx, sy, ex, ey, step[2], ends[2][2];
+	size_t amount, alloc, count, size;
+	int gap, k;
+	bool xflag, good;
+
+	if (src->width != plan->width || src->height != plan->height) {
+		LANE_LOG_ERROR("Image (%d x %d) does not match plan (%d x %d); aborting",
+				src->width, src->height, plan->width, plan->height);
+
+		return 0;
+	}
+
+	columns = plan->columns;
+	last = plan->spans + plan->spans_amount;
+	size = src->width * src->height;
+	cx = src->width / 2;
+	cy = src->height / 2;
+	amount = count = 0;
+	alloc = plan->max_lines ? plan->max_lines : INITIAL_ARRAY_SIZE;
+	state = SHUFFLE_SEED;
+
+	acc = calloc(columns * plan->rows, sizeof(lane_hough_cell_t));
+	mask = malloc(size * sizeof(uint8_t));
+	points = malloc(size * sizeof(uint32_t));
+	results = calloc(alloc, sizeof(lane_hough_resolved_line_t));
+
+	if (!acc || !mask || !points || !results) {
+		LANE_LOG_ERROR("Unable to allocate memory for segments; aborting");
+
+		free(acc);
+		free(mask);
+		free(points);
+		free(results);
+
+		return 0;
+	}
+
+	// Mark the edge pixels and collect their positions
+	for (i = 0; i < size; ++i) {
+		mask[i] = IS_WHITE(src->data[i]) && inside(plan, i % src->width, i / src->width) ? EDGE_PENDING : EDGE_NONE;
+
+		if (mask[i]) {
+			points[count++] = i;
+		}
+	}
+
+	// Visit the edge pixels in a random order (Fisher-Yates)
+	for (i = count; i > 1; --i) {
+		j = shuffle_next(&state) % i;
+		tmp = points[i - 1];
+		points[i - 1] = points[j];
+		points[j] = tmp;
+	}
+
+	for (i = 0; i < count; ++i) {
+		if (plan->max_lines && amount >= plan->max_lines) {
+			break;
+		}
+
+		// Skip pixels that were already claimed by a segment
+		if (mask[points[i]] != EDGE_PENDING) {
+			continue;
+		}
+
+		x0 = points[i] % src->width;
+		y0 = points[i] / src->width;
+		best = votes = 0;
+
+		// Vote for all lines through this pixel and remember the strongest
+		for (span = plan->spans; span < last; ++span) {
+			for (th = span->start; th < span->end; ++th) {
+				r = bin(plan, x0 - cx, y0 - cy, th);
+
+				cell = &(acc[(r * columns) + th]);
+				vote(cell, 1);
+
+				if (*cell > votes) {
+					votes = *cell;
+					best = th;
+				}
+			}
+		}
+
+		mask[points[i]] = EDGE_VOTED;
+
+		if (votes < thres) {
+			continue;
+		}
+
+		// The line runs perpendicular to its normal (cos, sin), so walk
+		// along (-sin, cos) in unit steps over the dominant axis
+		dx = -plan->sin[best];
+		dy = plan->cos[best];
+		xflag = abs(dx) > abs(dy);
+
+		if (xflag) {
+			step[0] = dx > 0 ? 1 : -1;
+			step[1] = (int32_t) (((int64_t) dy * (1L << FIXED_SHIFT)) / abs(dx));
+			x = x0;
+			y = (y0 << FIXED_SHIFT) + (1 << (FIXED_SHIFT - 1));
+		} else {
+			step[1] = dy > 0 ? 1 : -1;
+			step[0] = (int32_t) (((int64_t) dx * (1L << FIXED_SHIFT)) / abs(dy));
+			x = (x0 << FIXED_SHIFT) + (1 << (FIXED_SHIFT - 1));
+			y = y0;
+		}
+
+		// Find the furthest edge pixels in both directions,
+		// allowing for gaps of at most max_gap pixels
+		for (k = 0; k < 2; ++k) {
+			px = x;
+			py = y;
+			sx = k ? -step[0] : step[0];
+			sy = k ? -step[1] : step[1];
+
+			ends[k][0] = x0;
+			ends[k][1] = y0;
+			gap = 0;
+
+			while (1) {
+				ex = xflag ? px : px >> FIXED_SHIFT;
+				ey = xflag ? py >> FIXED_SHIFT : py;
+
+				if (ex < 0 || ex >= src->width || ey < 0 || ey >= src->height) {
+					break;
+				}
+
+				if (mask[(ey * src->width) + ex]) {
+					gap = 0;
+					ends[k][0] = ex;
+					ends[k][1] = ey;
+				} else if (++gap > max_gap) {
+					break;
+				}
+
+				px += sx;
+				py += sy;
+			}
+		}
+
+		good = abs(ends[1][0] - ends[0][0]) >= min_length || abs(ends[1][1] - ends[0][1]) >= min_length;
+
+		// Walk the segment again to claim its pixels, and take
+		// back their votes if the segment is long enough
+		for (k = 0; k < 2; ++k) {
+			px = x;
+			py = y;
+			sx = k ? -step[0] : step[0];
+			sy = k ? -step[1] : step[1];
+
+			while (1) {
+				ex = xflag ? px : px >> FIXED_SHIFT;
+				ey = xflag ? py >> FIXED_SHIFT : py;
+				m = &(mask[(ey * src->width) + ex]);
+
+				if (good && *m == EDGE_VOTED) {
+					for (span = plan->spans; span < last; ++span) {
+						for (t = span->start; t < span->end; ++t) {
+							unvote(&(acc[(bin(plan, ex - cx, ey - cy, t) * columns) + t]), 1);
+						}
+					}
+				}
+
+				*m = EDGE_NONE;
+
+				if (ex == ends[k][0] && ey == ends[k][1]) {
+					break;
+				}
+
+				px += sx;
+				py += sy;
+			}
+		}
+
+		if (!good) {
+			continue;
+		}
+
+		if (amount >= alloc) {
+			alloc *= 2;
+			results = realloc(results, alloc * sizeof(lane_hough_resolved_line_t));
 
-/**
- * @internal
- *
- * Extracts lines from the Hough Space/accumulator
- *
- * @param lines		Where the resulting lines will be stored
- * @param space		The accumulator to extract from
- * @param thres		The threshold to apply when extracting lines
- *
- * @return		The amount of lines that were classified
- */
-static inline size_t classify(lane_hough_normal_t **lines, const lane_hough_space_t *const space, uint16_t thres);
+			if (!results) {
+				LANE_LOG_ERROR("Unable to realloc memory for segments; aborting");
 
-/**
- * @internal
- *
- * Checks if the magnitude of a cell in the accumulator is higher than
- * that of the neighboring cells. (i.e. detects a peak in the accumulator)
- *
- * @param space		The accumulator where the cells are stored
- * @param rho		The rho value of the cell
- * @param th		The theta value of the cell
- * 
- * @return		The magnitude of the target cell
- */
-static inline uint32_t magnitude(const lane_hough_space_t *const space, uint16_t rho, uint16_t th);
+				free(acc);
+				free(mask);
+				free(points);
 
-/*
- * @inheritDoc
- */
-size_t lane_hough_apply(const lane_image_t *const src, lane_hough_space_t **rspace, lane_hough_normal_t **rnormals, uint8_t min, uint8_t max, uint16_t thres) {
-	lane_hough_space_t *space;
-	lane_hough_normal_t *lines;
-	double height, rads;
-	size_t lines_amount;//, x, y;
-	
-	rads = max - min;
-	height = (sqrt(HEIGHT_FACTOR) * (double)(src->height>src->width?src->height:src->width)) / HEIGHT_FACTOR;
-	
-	space = malloc(sizeof(lane_hough_space_t));
-	space->width = rads;
-	space->height = height * HEIGHT_FACTOR;
-	space->size = space->width * space->height;
-	space->acc = calloc(space->size, sizeof(uint32_t));
-	
-	if (!space->acc) {
-		LANE_LOG_ERROR("Allocating of accumulator failed; aborting");
+				return 0;
+			}
+		}
 
-		return 0;
+		LANE_LOG_INFO("Detected segment from (%04d, %04d) to (%04d, %04d)", ends[0][0], ends[0][1], ends[1][0], ends[1][1]);
+
+		results[amount++] = (lane_hough_resolved_line_t) {
+			.x1=ends[0][0],
+			.y1=ends[0][1],
+			.x2=ends[1][0],
+			.y2=ends[1][1]
+		};
 	}
 
-	quantize(src, space, height, min, max);
-	lines_amount = classify(&lines, space, thres);
+	free(acc);
+	free(mask);
+	free(points);
 
-	(*rspace) = space;
-	(*rnormals) = lines;
+	(*rsegments) = results;
 
-	return lines_amount;
+	return amount;
 }
 
 #define DegreesToRadians(deg)	RADIANS(deg)
@@ -146,21 +1363,25 @@ size_t lane_hough_apply(const lane_image_t *const src, lane_hough_space_t **rspa
 /*
  * @inheritDoc
  */
-lane_hough_resolved_line_t lane_hough_resolve_line(lane_image_t *image, const lane_hough_space_t *const space, const lane_hough_normal_t line) {
+lane_hough_resolved_line_t lane_hough_resolve_line(lane_image_t *image, const lane_hough_plan_t *const plan, const lane_hough_normal_t line) {
 	lane_hough_resolved_line_t result;
+	double degrees, angle;
 	int x1, y1, x2, y2;
 
+	degrees = line.theta * plan->theta_step / 2.0;
+	angle = RADIANS(degrees);
+
 	// Check from which corner we need to base the line
-	if (IS_LINE_VERTICAL(line)) {
+	if (IS_LINE_VERTICAL(degrees)) {
 		x1 = 0;
-		y1 = POLARIZE(x1, image->width, image->height, line, space, cos, sin);
+		y1 = POLARIZE(x1, image->width, image->height, line, plan, angle, cos, sin);
 		x2 = image->width;
-		y2 = POLARIZE(x2, image->width, image->height, line, space, cos, sin);
+		y2 = POLARIZE(x2, image->width, image->height, line, plan, angle, cos, sin);
 	} else {
 		y1 = 0;
-		x1 = POLARIZE(y1, image->height, image->width, line, space, sin, cos);
+		x1 = POLARIZE(y1, image->height, image->width, line, plan, angle, sin, cos);
 		y2 = image->height;
-		x2 = POLARIZE(y2, image->height, image->width, line, space, sin, cos);
+		x2 = POLARIZE(y2, image->height, image->width, line, plan, angle, sin, cos);
 	}
 
 	result.x1 = x1;
@@ -214,22 +1435,101 @@ void lane_hough_plot_graph(lane_image_t *image, const lane_hough_space_t *const
 /*
  * @inheritDoc
  */
-static inline void quantize(const lane_image_t *const image, lane_hough_space_t *space, double h, uint8_t min, uint8_t max) {
+static inline void quantize(const lane_color_t *data, size_t stride, uint8_t step, const lane_hough_plan_t *const plan, lane_hough_space_t *space, uint32_t first, uint32_t last) {
+	const lane_color_t *row;
+	const uint8_t *roi;
+	lane_hough_span_t spans[plan->spans_amount];
+	int32_t cx, cy, xc, yc, ysin[space->width];
+	uint32_t th;
+	uint16_t x, y;
+	uint8_t amount, s;
+
+	// Center coordinates of the image
+	cx = plan->width / 2;
+	cy = plan->height / 2;
+
+	amount = clip_spans(plan, first, last, spans);
+
+	// Create a Hough Space by quantizing the input
+	for (y = plan->horizon; y < plan->height; ++y) {
+		row = &(data[y * stride]);
+		roi = plan->roi ? &(plan->roi[y * plan->width]) : NULL;
+		yc = y - cy;
+
+		// The vertical term only changes once per row,
+		// so fold it together with the offset beforehand
+		for (th = first; th < last; ++th) {
+			ysin[th] = yc * plan->sin[th] + plan->offset;
+		}
+
+		for (x = 0; x < plan->width; ++x) {
+			if (row[x * step] > WHITE_THRESHOLD && (!roi || roi[x])) {
+				xc = x - cx;
+
+				for (s = 0; s < amount; ++s) {
+					for (th = spans[s].start; th < spans[s].end; ++th) {
+						vote(&(space->acc[th + (space->width * ((xc * plan->cos[th] + ysin[th]) >> FIXED_SHIFT))]), 1);
+					}
+				}
+			}
+		}
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+static void *quantize_slab(void *arg) {
+	lane_hough_slab_t *slab = arg;
+
+	quantize(slab->data, slab->stride, slab->step, slab->plan, slab->space, slab->first, slab->last);
+
+	return NULL;
+}
+
+/*
+ * @inheritDoc
+ */
+static inline void quantize_gradient(const lane_image_t *const image, const double *const directions, const lane_hough_plan_t *const plan, lane_hough_space_t *space, uint8_t window) {
+	const lane_pixel_t *row;
+	int32_t cx, cy, xc, yc, ysin[space->width], th, t, center, steps, turn;
 	uint16_t x, y;
-	uint8_t th;
-	double cx, cy;
 
 	// Center coordinates of the image
 	cx = image->width / 2;
 	cy = image->height / 2;
 
-	// Create a Hough Space by quantizing the input
-	for (y = 0; y < image->height; ++y) {
+	// The window in theta steps, and the steps in half a turn
+	steps = ((2 * window) + plan->theta_step - 1) / plan->theta_step;
+	turn = HALF_TURN / plan->theta_step;
+
+	for (y = plan->horizon; y < image->height; ++y) {
+		row = &(image->data[y * image->width]);
+		yc = y - cy;
+
+		for (th = 0; th < (int) space->width; ++th) {
+			ysin[th] = yc * plan->sin[th] + plan->offset;
+		}
+
 		for (x = 0; x < image->width; ++x) {
-			if (IS_WHITE(image->data[(y*image->width) + x])) {
-				for (th = min; th < max; ++th) {
-					space->acc[(int) (th + (space->width * NORMALIZE(x, y, cx, cy, th, h)))]++;
+			if (!IS_WHITE(row[x]) || (plan->roi && !plan->roi[(y * image->width) + x])) {
+				continue;
+			}
+
+			xc = x - cx;
+
+			center = nearest_step(plan, lane_edge_theta(directions[(y * image->width) + x]));
+
+			for (th = center - steps; th <= center + steps; ++th) {
+				// Lines at th and th+180 are the same line with
+				// a negated rho, so wrap the angle around
+				t = ((th % turn) + turn) % turn - plan->first;
+
+				if (!allowed(plan, t)) {
+					continue;
 				}
+
+				vote(&(space->acc[t + (space->width * ((xc * plan->cos[t] + ysin[t]) >> FIXED_SHIFT))]), 1);
 			}
 		}
 	}
@@ -238,79 +1538,409 @@ static inline void quantize(const lane_image_t *const image, lane_hough_space_t
 /*
  * @inheritDoc
  */
-static inline uint32_t magnitude(const lane_hough_space_t *const space, uint16_t rho, uint16_t th) {
-	uint32_t magnitude;
-	uint16_t x, y;
+static inline void quantize_edges(const lane_edge_list_t *const edges, const lane_hough_plan_t *const plan, lane_hough_space_t *space, uint8_t window, size_t first, size_t step, uint32_t weight) {
+	const lane_edge_point_t *point, *end;
+	const lane_hough_span_t *span, *last;
+	int32_t cx, cy, xc, yc, ysin[space->width], th, t, center, steps, turn, row;
+
+	// Center coordinates of the image
+	cx = edges->width / 2;
+	cy = edges->height / 2;
+	row = -1;
+
+	// The window in theta steps, and the steps in half a turn
+	steps = ((2 * window) + plan->theta_step - 1) / plan->theta_step;
+	turn = HALF_TURN / plan->theta_step;
 
-	// Magnitude of the target pixel
-	magnitude = space->acc[(rho * space->width) + th];
+	last = plan->spans + plan->spans_amount;
 
-	// Get the magnitude of neighboring pixels
-	for (y = -KERNEL_SIZE; y <= KERNEL_SIZE; ++y) {
-		for (x = -KERNEL_SIZE; x <= KERNEL_SIZE; ++x) {
-			if ((y + rho >= 0 && y + rho < space->height) && (x + th >= 0 && x + th < space->width)) {
-				if ((int) space->acc[((rho + y) * space->width) + (th + x)] > (int) magnitude) {
-					magnitude = space->acc[((rho + y) * space->width) + (th + x)];
-					goto found;
+	for (point = edges->points + first, end = edges->points + edges->size; point < end; point += step) {
+		if (!inside(plan, point->x, point->y)) {
+			continue;
+		}
+
+		xc = point->x - cx;
+		yc = point->y - cy;
+
+		if (point->theta != LANE_EDGE_NO_DIRECTION && window < 90) {
+			center = nearest_step(plan, point->theta);
+
+			for (th = center - steps; th <= center + steps; ++th) {
+				// Lines at th and th+180 are the same line with
+				// a negated rho, so wrap the angle around
+				t = ((th % turn) + turn) % turn - plan->first;
+
+				if (!allowed(plan, t)) {
+					continue;
 				}
+
+				vote(&(space->acc[t + (space->width * bin(plan, xc, yc, t))]), weight);
+			}
+
+			continue;
+		}
+
+		// The points are mostly in row-major order, so the
+		// vertical term only has to be recomputed once per row
+		if (point->y != row) {
+			row = point->y;
+
+			for (th = 0; th < (int) space->width; ++th) {
+				ysin[th] = yc * plan->sin[th] + plan->offset;
+			}
+		}
+
+		for (span = plan->spans; span < last; ++span) {
+			for (th = span->start; th < span->end; ++th) {
+				vote(&(space->acc[th + (space->width * ((xc * plan->cos[th] + ysin[th]) >> FIXED_SHIFT))]), weight);
 			}
 		}
 	}
+}
+
+/*
+ * @inheritDoc
+ */
+static inline uint32_t bin(const lane_hough_plan_t *const plan, int32_t xc, int32_t yc, uint32_t th) {
+	return (xc * plan->cos[th] + yc * plan->sin[th] + plan->offset) >> FIXED_SHIFT;
+}
+
+/*
+ * @inheritDoc
+ */
+static inline int32_t nearest_step(const lane_hough_plan_t *const plan, uint8_t degrees) {
+	return (((2 * degrees) + (plan->theta_step / 2)) / plan->theta_step) % (HALF_TURN / plan->theta_step);
+}
+
+/*
+ * @inheritDoc
+ */
+static inline bool allowed(const lane_hough_plan_t *const plan, int32_t column) {
+	uint8_t s;
+
+	for (s = 0; s < plan->spans_amount; ++s) {
+		if (column >= plan->spans[s].start && column < plan->spans[s].end) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * @inheritDoc
+ */
+static inline bool inside(const lane_hough_plan_t *const plan, uint16_t x, uint16_t y) {
+	return y >= plan->horizon && (!plan->roi || plan->roi[(y * plan->width) + x]);
+}
+
+/*
+ * @inheritDoc
+ */
+static inline uint8_t clip_spans(const lane_hough_plan_t *const plan, uint32_t first, uint32_t last, lane_hough_span_t *spans) {
+	uint32_t start, end;
+	uint8_t amount, s;
+
+	for (amount = s = 0; s < plan->spans_amount; ++s) {
+		start = plan->spans[s].start > first ? plan->spans[s].start : first;
+		end = plan->spans[s].end < last ? plan->spans[s].end : last;
+
+		if (start < end) {
+			spans[amount++] = (lane_hough_span_t) {
+				.start=start,
+				.end=end
+			};
+		}
+	}
+
+	return amount;
+}
+
+/*
+ * @inheritDoc
+ */
+static int compare_doubles(const void *a, const void *b) {
+	const double *da = a, *db = b;
+
+	return (*da > *db) - (*da < *db);
+}
+
+/*
+ * @inheritDoc
+ */
+static int compare_spans(const void *a, const void *b) {
+	const lane_hough_span_t *sa = a, *sb = b;
+
+	return sa->start - sb->start;
+}
+
+/*
+ * @inheritDoc
+ */
+static inline void vote(lane_hough_cell_t *cell, uint32_t weight) {
+#ifdef LANE_HOUGH_NARROW
+	*cell = *cell > LANE_HOUGH_CELL_MAX - weight ? LANE_HOUGH_CELL_MAX : *cell + weight;
+#else
+	*cell += weight;
+#endif
+}
+
+/*
+ * @inheritDoc
+ */
+static inline void unvote(lane_hough_cell_t *cell, uint32_t weight) {
+#ifdef LANE_HOUGH_NARROW
+	if (*cell == LANE_HOUGH_CELL_MAX) {
+		return;
+	}
+#endif
+
+	*cell -= weight;
+}
+
+/*
+ * @inheritDoc
+ */
+static inline uint32_t shuffle_next(uint32_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+/*
+ * @inheritDoc
+ */
+static inline lane_hough_space_t *allocate(const lane_hough_plan_t *const plan) {
+	lane_hough_space_t *space;
+
+	space = malloc(sizeof(lane_hough_space_t));
+
+	if (!space) {
+		LANE_LOG_ERROR("Allocating of space failed; aborting");
+
+		return NULL;
+	}
+
+	space->width = plan->columns;
+	space->height = plan->rows;
+	space->size = space->width * space->height;
+	space->acc = calloc(space->size, sizeof(lane_hough_cell_t));
+
+	if (!space->acc) {
+		LANE_LOG_ERROR("Allocating of accumulator failed; aborting");
+		free(space);
+
+		return NULL;
+	}
+
+	return space;
+}
+
+/*
+ * @inheritDoc
+ */
+static inline void dilate(const lane_hough_cell_t *src, lane_hough_cell_t *dest, uint32_t n, uint32_t stride, lane_hough_cell_t *scratch) {
+	const uint32_t window = (2 * KERNEL_SIZE) + 1,
+		       length = n + (2 * KERNEL_SIZE);
+	lane_hough_cell_t *padded, *g, *h;
+	uint32_t i;
+
+	padded = scratch;
+	g = scratch + length;
+	h = scratch + (2 * length);
+
+	// Values outside of the accumulator count as zero,
+	// which can never be larger than any cell
+	for (i = 0; i < length; ++i) {
+		padded[i] = (i >= KERNEL_SIZE && i < n + KERNEL_SIZE) ? src[(i - KERNEL_SIZE) * stride] : 0;
+	}
+
+	// Running maximum from the start of each block...
+	for (i = 0; i < length; ++i) {
+		g[i] = (i % window == 0 || padded[i] > g[i - 1]) ? padded[i] : g[i - 1];
+	}
+
+	// ... and from the end of each block
+	for (i = length; i-- > 0;) {
+		h[i] = (i == length - 1 || (i + 1) % window == 0 || padded[i] > h[i + 1]) ? padded[i] : h[i + 1];
+	}
+
+	// Every window spans the end of one block and the start of the next
+	for (i = 0; i < n; ++i) {
+		dest[i * stride] = h[i] > g[i + (2 * KERNEL_SIZE)] ? h[i] : g[i + (2 * KERNEL_SIZE)];
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+static int compare_candidates(const void *a, const void *b) {
+	const lane_hough_candidate_t *ca = a, *cb = b;
+
+	return weaker(*ca, *cb) ? 1 : (weaker(*cb, *ca) ? -1 : 0);
+}
+
+/*
+ * @inheritDoc
+ */
+static int compare_indices(const void *a, const void *b) {
+	const lane_hough_candidate_t *ca = a, *cb = b;
+
+	return (ca->index > cb->index) - (ca->index < cb->index);
+}
+
+/*
+ * @inheritDoc
+ */
+static inline bool weaker(lane_hough_candidate_t a, lane_hough_candidate_t b) {
+	return a.votes < b.votes || (a.votes == b.votes && a.index > b.index);
+}
+
+/*
+ * @inheritDoc
+ */
+static inline void sift_down(lane_hough_candidate_t *heap, size_t size, size_t i) {
+	lane_hough_candidate_t tmp;
+	size_t smallest, l, r;
+
+	while (1) {
+		smallest = i;
+		l = (2 * i) + 1;
+		r = (2 * i) + 2;
+
+		if (l < size && weaker(heap[l], heap[smallest])) smallest = l;
+		if (r < size && weaker(heap[r], heap[smallest])) smallest = r;
 
-found:	return magnitude;
+		if (smallest == i) {
+			return;
+		}
+
+		tmp = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = tmp;
+		i = smallest;
+	}
 }
 
 /*
  * @inheritDoc
  */
-static inline size_t classify(lane_hough_normal_t **lines, const lane_hough_space_t *const space, uint16_t thres) {
+size_t lane_hough_peaks(const lane_hough_space_t *const space, const lane_hough_plan_t *const plan, uint32_t thres, lane_hough_normal_t **lines) {
 	lane_hough_normal_t *results;
+	lane_hough_candidate_t *heap, next;
+	lane_hough_cell_t *local, *scratch;
+	uint32_t rho, th, i;
 	size_t amount, alloc;
-	uint16_t rho, th;
+
+	amount = 0;
+	alloc = plan->max_lines ? plan->max_lines : INITIAL_ARRAY_SIZE;
+	local = malloc(space->size * sizeof(lane_hough_cell_t));
+	scratch = malloc(3 * ((space->width > space->height ? space->width : space->height) + (2 * KERNEL_SIZE)) * sizeof(lane_hough_cell_t));
+	heap = plan->max_lines ? malloc(plan->max_lines * sizeof(lane_hough_candidate_t)) : NULL;
 
 	// I use calloc here because the struct members will be "initialized"
 	// and Valgrind won't complain anymore...
-	amount = 0;
-	alloc = INITIAL_ARRAY_SIZE;
 	results = calloc(alloc, sizeof(lane_hough_normal_t));
 
-	if (!results) {
+	if (!local || !scratch || !results || (plan->max_lines && !heap)) {
 		LANE_LOG_ERROR("Unable to allocate memory for lines; aborting");
+
+		free(local);
+		free(scratch);
+		free(heap);
+		free(results);
+
 		return 0;
 	}
 
-	// Loop over accumulator to find peaks
-	// And make sure this pixel is higher than all neighbor pixels
+	// The maximum of each (2*KERNEL_SIZE+1)^2 neighbourhood is
+	// separable, so filter all rows and then all columns
 	for (rho = 0; rho < space->height; ++rho) {
-		for (th = 0; th < space->width; ++th) {
-			if ((int) space->acc[(rho * space->width) + th] >= thres) {
-				if (magnitude(space, rho, th) <= space->acc[(rho * space->width) + th]) {
-					
-					// Peak detected!
-					LANE_LOG_INFO("Detected rho=%04d th=%04d", rho, th);
-
-					if (amount >= (alloc - 1)) {
-						alloc *= 2;
-						results = realloc(results, alloc * sizeof(lane_hough_normal_t));
-						
-						if (!results) {
-							LANE_LOG_ERROR("Unable to realloc memory for lines; aborting");
-
-							return 0;
-						}
-					}
+		dilate(&(space->acc[rho * space->width]), &(local[rho * space->width]), space->width, 1, scratch);
+	}
+
+	for (th = 0; th < space->width; ++th) {
+		dilate(&(local[th]), &(local[th]), space->height, space->width, scratch);
+	}
+
+	// A cell is a peak when no cell in its neighbourhood has more votes
+	for (i = 0; i < space->size; ++i) {
+		if (space->acc[i] < thres || space->acc[i] != local[i]) {
+			continue;
+		}
+
+		LANE_LOG_INFO("Detected rho=%04d th=%04d", i / space->width, i % space->width);
+
+		next = (lane_hough_candidate_t) {
+			.votes=space->acc[i],
+			.index=i
+		};
+
+		if (heap) {
+			// Only keep the most voted peaks in a bounded min-heap
+			if (amount < plan->max_lines) {
+				heap[amount++] = next;
 
-					results[amount++] = (lane_hough_normal_t) {
-						.rho=rho,
-						.theta=th
-					};
+				if (amount == plan->max_lines) {
+					for (th = amount / 2; th-- > 0;) {
+						sift_down(heap, amount, th);
+					}
 				}
+			} else if (weaker(heap[0], next)) {
+				heap[0] = next;
+				sift_down(heap, amount, 0);
+			}
+
+			continue;
+		}
+
+		if (amount >= (alloc - 1)) {
+			alloc *= 2;
+			results = realloc(results, alloc * sizeof(lane_hough_normal_t));
+
+			if (!results) {
+				LANE_LOG_ERROR("Unable to realloc memory for lines; aborting");
+
+				free(local);
+				free(scratch);
+
+				return 0;
 			}
 		}
+
+		results[amount++] = (lane_hough_normal_t) {
+			.rho=i / space->width,
+			.theta=plan->first + (i % space->width)
+		};
 	}
-	
+
+	if (heap) {
+		// The heap may not have been filled up completely
+		if (amount < plan->max_lines) {
+			for (th = amount / 2; th-- > 0;) {
+				sift_down(heap, amount, th);
+			}
+		}
+
+		// Pop the weakest peaks first so the most voted ones end up in front
+		for (i = amount; i-- > 0;) {
+			results[i] = (lane_hough_normal_t) {
+				.rho=heap[0].index / space->width,
+				.theta=plan->first + (heap[0].index % space->width)
+			};
+
+			heap[0] = heap[i];
+			sift_down(heap, i, 0);
+		}
+	}
+
+	free(local);
+	free(scratch);
+	free(heap);
+
 	(*lines) = results;
 
 	return amount;
 }
-
@@ -12,7 +12,26 @@
 #ifndef LANE_HOUGH_H
 #define LANE_HOUGH_H
 
+#include <stdint.h>
+
+#include "lane_edge.h"
 #include "lane_image.h"
+#include "lane_plane.h"
+
+/**
+ * @brief A cell of the Hough accumulator
+ *
+ * Define LANE_HOUGH_NARROW to use 16-bit cells, which halves the
+ * size of the accumulator. Votes into these cells saturate at
+ * LANE_HOUGH_CELL_MAX instead of wrapping around.
+ */
+#ifdef LANE_HOUGH_NARROW
+typedef uint16_t		lane_hough_cell_t;
+#define LANE_HOUGH_CELL_MAX	(UINT16_MAX)
+#else
+typedef uint32_t		lane_hough_cell_t;
+#define LANE_HOUGH_CELL_MAX	(UINT32_MAX)
+#endif
 
 /**
  * @copydoc normal
@@ -29,6 +48,31 @@ typedef struct space		lane_hough_space_t;
  */
 typedef struct resolved_line	lane_hough_resolved_line_t;
 
+/**
+ * @copydoc plan
+ */
+typedef struct plan		lane_hough_plan_t;
+
+/**
+ * @copydoc stream
+ */
+typedef struct stream		lane_hough_stream_t;
+
+/**
+ * @copydoc span
+ */
+typedef struct span		lane_hough_span_t;
+
+/**
+ * @copydoc band
+ */
+typedef struct band		lane_hough_band_t;
+
+/**
+ * @copydoc vertex
+ */
+typedef struct vertex		lane_hough_vertex_t;
+
 /**
  * @brief A line represented by rho, theta values
  *
@@ -37,7 +81,11 @@ typedef struct resolved_line	lane_hough_resolved_line_t;
  * rho = x * cos(th) + y * sin(th)<br />
  * <br />
  * where rho is the distance from the origin and
- * th is the angle between the line and the x axis.
+ * th is the angle between the line and the x axis.<br />
+ * <br />
+ * Both are expressed in the steps of the plan which the line
+ * was detected with: rho is the row of the accumulator and th
+ * is the amount of theta steps from 0 degrees.
  */
 struct normal {
 	int rho, theta;
@@ -51,7 +99,8 @@ struct normal {
  * The size is dependent on the input image size.
  */
 struct space {
-	uint32_t *acc, width, height, size;
+	lane_hough_cell_t *acc;
+	uint32_t width, height, size;
 };
 
 /**
@@ -65,23 +114,409 @@ struct resolved_line {
 	int x1, y1, x2, y2;
 };
 
+/**
+ * @brief A range of accumulator columns that may be voted for
+ *
+ * The columns from <i>start</i> up to (but excluding) <i>end</i>.
+ */
+struct span {
+	uint16_t start, end;
+};
+
+/**
+ * @brief A range of angles in which lines are expected
+ *
+ * The angles in degrees from <i>min</i> up to (but excluding)
+ * <i>max</i>, like the range of a plan.
+ */
+struct band {
+	uint8_t min, max;
+};
+
+/**
+ * @brief A corner of a region of interest
+ *
+ * A point in pixel coordinates, which may lie outside of the image.
+ */
+struct vertex {
+	int x, y;
+};
+
+/**
+ * @brief Precomputed parameters for the Hough Transform
+ *
+ * The trigonometry tables and accumulator geometry for a
+ * specific image size and range of theta.<br />
+ * <br />
+ * The sine and cosine of each theta step are stored as
+ * fixed-point integers, so voting only needs integer
+ * multiply-adds. A plan can be reused for every frame
+ * that has the same dimensions.<br />
+ * <br />
+ * The accumulator has a row per <i>rho_step</i> pixels and a
+ * column per <i>theta_step</i>, where theta_step is written in
+ * Q6.1 form (half degrees) like VPU_FX_HOUGH_RES. The columns
+ * start at step <i>first</i>, which is the first step within
+ * [min, max).<br />
+ * <br />
+ * The amount of extracted lines can be capped by setting
+ * <i>max_lines</i>, similar to VPU_IMAGE_MAX_HOUGH in the
+ * hardware implementation. It is zero (unlimited) by default.<br />
+ * <br />
+ * Pixels above the <i>horizon</i> row, or outside of the <i>roi</i>
+ * mask if there is one, do not vote. Votes are only cast for the
+ * columns within the <i>spans</i>, which cover all columns unless
+ * lane_hough_plan_set_bands was used.
+ */
+struct plan {
+	uint16_t width, height, max_lines, first, columns, horizon;
+	uint8_t min, max, rho_step, theta_step, spans_amount, *roi;
+	int32_t *cos, *sin, offset;
+	uint32_t rows;
+	lane_hough_span_t *spans;
+};
+
+/**
+ * @brief Accumulator which is kept across the frames of a video
+ *
+ * Instead of clearing the accumulator for every frame, the votes
+ * of earlier frames fade out: each frame, every cell loses
+ * 1/2^<i>decay</i> of its value. A line that is visible in
+ * consecutive frames keeps its peak, while noise averages out.<br />
+ * <br />
+ * Only one in <i>subsample</i> edge pixels votes per frame, and a
+ * different subset is picked every frame.<br />
+ * <br />
+ * The votes are stored with fractional bits, so the values in the
+ * accumulator are not plain vote counts. With narrow cells, keep
+ * the decay low to avoid saturating the peaks.
+ */
+struct stream {
+	lane_hough_space_t *space;
+	const lane_hough_plan_t *plan;
+	uint8_t decay, subsample, phase;
+};
+
+/**
+ * @brief Create a plan for the Hough Transform
+ *
+ * Allocates a plan and precomputes the trigonometry tables
+ * for images of the given size.
+ *
+ * @param width		The width in pixels of the input images
+ * @param height	The height in pixels of the input images
+ * @param min		Minimum value of theta to compute rho for
+ * @param max		Maximum value of theta to compute rho for
+ * @return		A pointer to the plan, or NULL on failure
+ */
+lane_hough_plan_t *lane_hough_plan_new(uint16_t width, uint16_t height, uint8_t min, uint8_t max);
+
+/**
+ * @brief Create a plan for the Hough Transform with a custom resolution
+ *
+ * Like lane_hough_plan_new, which uses steps of 1 pixel and
+ * 1 degree, but with a configurable size of the steps.<br />
+ * <br />
+ * To match the hardware implementation, use VPU_FX_HOUGH_RHO
+ * and VPU_FX_HOUGH_RES.
+ *
+ * @param width		The width in pixels of the input images
+ * @param height	The height in pixels of the input images
+ * @param min		Minimum value of theta to compute rho for
+ * @param max		Maximum value of theta to compute rho for
+ * @param rho_step	The distance in pixels between two rows
+ * @param theta_step	The angle between two columns in half degrees,
+ * 			which must divide 360
+ * @return		A pointer to the plan, or NULL on failure
+ */
+lane_hough_plan_t *lane_hough_plan_new_steps(uint16_t width, uint16_t height, uint8_t min, uint8_t max, uint8_t rho_step, uint8_t theta_step);
+
+/**
+ * @brief Only let pixels at or below a row vote
+ *
+ * Skip the sky and other parts of the image above the horizon.
+ *
+ * @param plan		The plan to restrict
+ * @param horizon	The first row of the image that votes
+ */
+void lane_hough_plan_set_horizon(lane_hough_plan_t *plan, uint16_t horizon);
+
+/**
+ * @brief Only let pixels within a polygon vote
+ *
+ * Rasterizes the polygon into a mask of the image size, using the
+ * even-odd rule. The polygon replaces an earlier one, and passing
+ * no vertices removes it.
+ *
+ * @param plan		The plan to restrict
+ * @param vertices	The corners of the polygon, in order
+ * @param amount	The amount of corners
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_hough_plan_set_roi(lane_hough_plan_t *plan, const lane_hough_vertex_t *const vertices, size_t amount);
+
+/**
+ * @brief Only vote for angles within some bands
+ *
+ * Restricts voting to the columns of the plan which lie in one
+ * of the bands. Overlapping bands are merged, and passing no
+ * bands allows all angles of the plan again.
+ *
+ * @param plan		The plan to restrict
+ * @param bands		The ranges of allowed angles
+ * @param amount	The amount of bands
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_hough_plan_set_bands(lane_hough_plan_t *plan, const lane_hough_band_t *const bands, size_t amount);
+
+/**
+ * Deallocates a plan and its trigonometry tables.
+ *
+ * @param plan		The plan to be deallocated
+ */
+void lane_hough_plan_free(lane_hough_plan_t *plan);
+
 /**
  * @brief Use the Hough Transform to isolate lines
  *
  * Isolate lines within an image by using Classical Hough Transform.<br />
  * <br />
- * This function returns the accumulator and the resulting lines.
+ * This function returns the accumulator and the resulting lines.<br />
+ * <br />
+ * <b>Note:</b> The dimensions of the input image must match
+ * the dimensions that the plan was created for.
  *
  * @param src		The input image, which data will be read
+ * @param plan		The precomputed plan for this image size
  * @param space		The resulting accumulator / Hough space
  * @param rnormals	Output for the normals array
- * @param min		Minimum value of theta to compute rho for
- * @param max		Maximum value of theta to compute rho for
  * @param thres		Threshold for accumulator values
  * @return		Zero or higher, indicating the amount of
  * 			lines that were detected
  */
-size_t lane_hough_apply(const lane_image_t *const src, lane_hough_space_t **space, lane_hough_normal_t **rnormals, uint8_t min, uint8_t max, uint16_t thres);
+size_t lane_hough_apply(const lane_image_t *const src, const lane_hough_plan_t *const plan, lane_hough_space_t **space, lane_hough_normal_t **rnormals, uint16_t thres);
+
+/**
+ * @brief Use the Hough Transform to isolate lines within a plane
+ *
+ * Like lane_hough_apply, but for a LANE_PLANE_U8 plane, which
+ * only has a third of the data of an image to read.
+ *
+ * @param src		The input plane, which data will be read
+ * @param plan		The precomputed plan for this plane size
+ * @param space		The resulting accumulator / Hough space
+ * @param rnormals	Output for the normals array
+ * @param thres		Threshold for accumulator values
+ * @return		Zero or higher, indicating the amount of
+ * 			lines that were detected
+ */
+size_t lane_hough_apply_plane(const lane_plane_t *const src, const lane_hough_plan_t *const plan, lane_hough_space_t **space, lane_hough_normal_t **rnormals, uint16_t thres);
+
+/**
+ * @brief Use the Hough Transform to isolate lines, using multiple threads
+ *
+ * Isolate lines within an image like lane_hough_apply, but divide
+ * the voting over a number of worker threads.<br />
+ * <br />
+ * Each thread is given a disjoint slab of theta values, so the
+ * threads never write to the same accumulator cell and no merging
+ * is needed afterwards. The resulting accumulator is identical to
+ * the one produced by lane_hough_apply.
+ *
+ * @param src		The input image, which data will be read
+ * @param plan		The precomputed plan for this image size
+ * @param threads	The amount of worker threads to vote with
+ * @param space		The resulting accumulator / Hough space
+ * @param rnormals	Output for the normals array
+ * @param thres		Threshold for accumulator values
+ * @return		Zero or higher, indicating the amount of
+ * 			lines that were detected
+ */
+size_t lane_hough_apply_parallel(const lane_image_t *const src, const lane_hough_plan_t *const plan, uint8_t threads, lane_hough_space_t **space, lane_hough_normal_t **rnormals, uint16_t thres);
+
+/**
+ * @brief Use the gradient-directed Hough Transform to isolate lines
+ *
+ * Isolate lines within an image like lane_hough_apply, but only
+ * vote for the angles close to the gradient direction of each
+ * edge pixel.<br />
+ * <br />
+ * An edge pixel can only be part of a line which is perpendicular
+ * to its gradient, so the other angles can be skipped. This casts
+ * (2*window+1) votes per pixel instead of (max-min) votes.<br />
+ * <br />
+ * <b>Note:</b> The directions must be in the format that is
+ * produced by lane_sobel_apply and must have the same dimensions
+ * as the input image.
+ *
+ * @param src		The input image, which data will be read
+ * @param directions	The gradient directions for each pixel
+ * 			encoded in a row-major array
+ * @param plan		The precomputed plan for this image size
+ * @param window	How many degrees to vote for on each side
+ * 			of the gradient direction
+ * @param space		The resulting accumulator / Hough space
+ * @param rnormals	Output for the normals array
+ * @param thres		Threshold for accumulator values
+ * @return		Zero or higher, indicating the amount of
+ * 			lines that were detected
+ */
+size_t lane_hough_apply_gradient(const lane_image_t *const src, const double *const directions, const lane_hough_plan_t *const plan, uint8_t window, lane_hough_space_t **space, lane_hough_normal_t **rnormals, uint16_t thres);
+
+/**
+ * @brief Use the Hough Transform to isolate lines from a list of edges
+ *
+ * Isolate lines like lane_hough_apply, but only vote for the
+ * pixels in a list of edges instead of scanning a whole image.<br />
+ * <br />
+ * Points that have a direction only vote within <i>window</i>
+ * degrees of it, like lane_hough_apply_gradient. Points without
+ * a direction, or any point if the window is 90 degrees or more,
+ * vote for all angles.<br />
+ * <br />
+ * <b>Note:</b> The dimensions of the list must match the
+ * dimensions that the plan was created for.
+ *
+ * @param edges		The edge pixels to vote for
+ * @param plan		The precomputed plan for this image size
+ * @param window	How many degrees to vote for on each side
+ * 			of the gradient direction
+ * @param space		The resulting accumulator / Hough space
+ * @param rnormals	Output for the normals array
+ * @param thres		Threshold for accumulator values
+ * @return		Zero or higher, indicating the amount of
+ * 			lines that were detected
+ */
+size_t lane_hough_apply_edges(const lane_edge_list_t *const edges, const lane_hough_plan_t *const plan, uint8_t window, lane_hough_space_t **space, lane_hough_normal_t **rnormals, uint16_t thres);
+
+/**
+ * @brief Create an accumulator for a stream of frames
+ *
+ * Allocates an empty accumulator which can be filled by
+ * lane_hough_stream_apply. The plan must outlive the stream.
+ *
+ * @param plan		The precomputed plan for the size of the frames
+ * @param decay		How fast old votes fade out, from 0 (every frame
+ * 			is on its own) to 8 (slowest)
+ * @param subsample	Only one in this many edge pixels votes per frame
+ * @return		A pointer to the stream, or NULL on failure
+ */
+lane_hough_stream_t *lane_hough_stream_new(const lane_hough_plan_t *const plan, uint8_t decay, uint8_t subsample);
+
+/**
+ * @brief Use the Hough Transform to isolate lines from a frame of a stream
+ *
+ * Decay the accumulator of the stream, let a subset of the edge
+ * pixels vote like lane_hough_apply_edges and extract the peaks.<br />
+ * <br />
+ * The threshold is in votes per frame as if all pixels voted,
+ * and is scaled to the values that the accumulator settles at.
+ * Hence, a new line needs a couple of frames before it
+ * crosses the threshold.
+ *
+ * @param stream	The stream whose accumulator to vote into
+ * @param edges		The edge pixels of the frame
+ * @param window	How many degrees to vote for on each side
+ * 			of the gradient direction
+ * @param rnormals	Output for the normals array
+ * @param thres		Threshold for the votes of a single frame
+ * @return		Zero or higher, indicating the amount of
+ * 			lines that were detected
+ */
+size_t lane_hough_stream_apply(lane_hough_stream_t *stream, const lane_edge_list_t *const edges, uint8_t window, lane_hough_normal_t **rnormals, uint16_t thres);
+
+/**
+ * Forget all votes of a stream, e.g. after a scene cut.
+ *
+ * @param stream	The stream to be cleared
+ */
+void lane_hough_stream_reset(lane_hough_stream_t *stream);
+
+/**
+ * Deallocates a stream and its accumulator.
+ *
+ * @param stream	The stream to be deallocated
+ */
+void lane_hough_stream_free(lane_hough_stream_t *stream);
+
+/**
+ * @brief Use a coarse-to-fine Hough Transform to isolate lines from a list of edges
+ *
+ * Isolate lines like lane_hough_apply_edges, but without filling
+ * the full resolution accumulator.<br />
+ * <br />
+ * First, every <i>decimation</i>-th pixel votes into a coarse grid
+ * where each cell spans <i>rho_factor</i> by <i>theta_factor</i>
+ * cells of the plan. Then only the neighbourhoods of the coarse
+ * peaks are filled at the resolution of the plan, using all pixels,
+ * and their peaks are reported.<br />
+ * <br />
+ * The directions of the points are not used. The lines are ordered
+ * like those of lane_hough_peaks, but peaks which are too weak to
+ * stand out at the coarse level are missed.
+ *
+ * @param edges		The edge pixels to vote for
+ * @param plan		The precomputed plan for the fine resolution
+ * @param rho_factor	How many rows of the plan form a coarse row
+ * @param theta_factor	How many columns of the plan form a coarse column
+ * @param decimation	Only every n-th pixel votes at the coarse level
+ * @param rnormals	Output for the normals array
+ * @param thres		Threshold for accumulator values
+ * @return		Zero or higher, indicating the amount of
+ * 			lines that were detected
+ */
+size_t lane_hough_apply_hierarchical(const lane_edge_list_t *const edges, const lane_hough_plan_t *const plan, uint8_t rho_factor, uint8_t theta_factor, uint8_t decimation, lane_hough_normal_t **rnormals, uint16_t thres);
+
+/**
+ * @brief Use the Progressive Probabilistic Hough Transform to find segments
+ *
+ * Isolate line segments within an image by voting for randomly
+ * picked edge pixels one at a time.<br />
+ * <br />
+ * As soon as a line has received <i>thres</i> votes, it is followed
+ * through the image to find the end points of the segment. The
+ * pixels of the segment are removed from the image and their votes
+ * are taken back, so they will not be picked again. This needs far
+ * fewer votes than the classical transform and results in the real
+ * extents of the lines instead of lines spanning the whole image.<br />
+ * <br />
+ * With LANE_HOUGH_NARROW, cells that reached LANE_HOUGH_CELL_MAX
+ * keep that value when votes are taken back, as their real count
+ * is unknown. So taking votes back is only exact below the maximum.<br />
+ * <br />
+ * If the plan has a <i>max_lines</i> cap, the transform stops after
+ * finding that many segments.
+ *
+ * @param src		The input image, which data will be read
+ * @param plan		The precomputed plan for this image size
+ * @param thres		Threshold for accumulator values
+ * @param min_length	The minimum length in pixels of a segment
+ * @param max_gap	The maximum amount of missing pixels within a segment
+ * @param rsegments	Output for the segments array
+ * @return		Zero or higher, indicating the amount of
+ * 			segments that were detected
+ */
+size_t lane_hough_apply_probabilistic(const lane_image_t *const src, const lane_hough_plan_t *const plan, uint16_t thres, uint16_t min_length, uint16_t max_gap, lane_hough_resolved_line_t **rsegments);
+
+/**
+ * @brief Extract the peaks from a Hough accumulator
+ *
+ * Find the cells which have at least <i>thres</i> votes and have
+ * the most votes within their neighbourhood (non-maximum
+ * suppression).<br />
+ * <br />
+ * If the plan has a <i>max_lines</i> cap, only the most voted
+ * peaks are returned, in descending order of votes. Otherwise
+ * all peaks are returned in the order of the accumulator.
+ *
+ * @param space		The accumulator to extract the peaks from
+ * @param plan		The plan which was used to fill the accumulator
+ * @param thres		Threshold for accumulator values
+ * @param lines		Output for the normals array
+ * @return		Zero or higher, indicating the amount of
+ * 			lines that were detected
+ */
+size_t lane_hough_peaks(const lane_hough_space_t *const space, const lane_hough_plan_t *const plan, uint32_t thres, lane_hough_normal_t **lines);
 
 /**
  * @brief Resolve a line from polar coordinates to Cartesian coordinates
@@ -92,11 +527,11 @@ size_t lane_hough_apply(const lane_image_t *const src, lane_hough_space_t **spac
  * Note that the start and end values will also be tried to match.
  * 
  * @param image		The image with the sizes of the Cartesian space
- * @param space		The Hough space
+ * @param plan		The plan which the line was detected with
  * @param line		The line to resolve
  * @return		A resolved line structure with the {start,end}-{x,y}
  */
-lane_hough_resolved_line_t lane_hough_resolve_line(lane_image_t *image, const lane_hough_space_t *const space, const lane_hough_normal_t line);
+lane_hough_resolved_line_t lane_hough_resolve_line(lane_image_t *image, const lane_hough_plan_t *const plan, const lane_hough_normal_t line);
 
 /**
  * Draw a line on an image
@@ -14,6 +14,7 @@
 #include <string.h>
 
 #include "lane_log.h"
+#include "lane_simd.h"
 
 /*
  * @inheritDoc
@@ -45,15 +46,7 @@ lane_image_t *lane_image_copy(const lane_image_t *const image) {
  * @inheritDoc
  */
 void lane_image_fill_solid(lane_image_t *image, lane_pixel_t color) {
-	int x, y;
-
-	// Imagine using memcpy....
-	// we're doing it the manly way!
-	for (y = 0; y < image->height; ++y) {
-		for (x = 0; x < image->width; ++x) {
-			image->data[(y * image->width) + x] = color;
-		}
-	}
+	lane_simd_fill(&(image->data[0].r), (size_t) image->width * image->height, color);
 }
 
 /*
@@ -107,24 +100,9 @@ void lane_image_draw_line(lane_image_t *image, lane_pixel_t color, uint16_t x1,
 /*
  * @inheritDoc
  */
-// FIXME at the moment this only works for grayscale images
 void lane_image_add(lane_image_t *image, const lane_image_t *const additions) {
-	size_t x, y, i;
-	uint16_t v;
-
-	for (y = 0; y < image->height; ++y) {
-		for (x = 0; x < image->width; ++x) {
-			// Index of the current pixel in the 2d array
-			i = (y * image->width) + x;
-
-			// If the sum of the input and output pixel > bpp, cap it.
-			v = image->data[i].r + additions->data[i].r;
-			if (v > 255) v = 255;
-
-			// Replace the pixel with the new value in the source image
-			image->data[i].r = image->data[i].g = image->data[i].b = v;
-		}
-	}
+	// Each channel is capped at 255 separately
+	lane_simd_add(&(image->data[0].r), &(additions->data[0].r), (size_t) image->width * image->height * 3);
 }
 
 /*
@@ -0,0 +1,210 @@
+/**
+ * @file lane_image_jpeg.c
+ * @author Matthijs Bakker
+ * @brief Load images in JPEG format
+ *
+ * This code unit provides the loading of JPEG images, such as
+ * those of the BDD100K dataset, without converting them to PPM
+ * first. The decoder can downscale while decoding, so smaller
+ * images never need the pixels of the full resolution.<br />
+ * <br />
+ * It needs libjpeg and is only available if compiled with
+ * LANE_JPEG_ENABLE, otherwise every function fails.
+ */
+
+#include "lane_image_jpeg.h"
+
+#include "lane_log.h"
+
+#ifdef LANE_JPEG_ENABLE
+
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <stdbool.h>
+
+/**
+ * @internal
+ *
+ * @copydoc error_manager
+ */
+typedef struct error_manager	lane_jpeg_error_manager_t;
+
+/**
+ * @internal
+ *
+ * @brief Handler of the errors of the decoder
+ *
+ * libjpeg exits the process on errors by default,
+ * so this jumps back to the loader instead.
+ */
+struct error_manager {
+	struct jpeg_error_mgr base;
+	jmp_buf jump;
+};
+
+/**
+ * @internal
+ *
+ * Logs an error of the decoder and returns to the loader.
+ *
+ * @param info		The decoder that failed
+ */
+static void error_exit(j_common_ptr info);
+
+/**
+ * @internal
+ *
+ * Decodes a JPEG file row by row into memory.
+ *
+ * @param file		File in JPEG format
+ * @param scale		The divisor of the dimensions; 1, 2, 4 or 8
+ * @param gray		Decode only the luminance instead of RGB
+ * @param image		Output for the image, if not gray
+ * @param plane		Output for the plane, if gray
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+static int decode(FILE *file, uint8_t scale, bool gray, lane_image_t **image, lane_plane_t **plane);
+
+#endif
+
+/*
+ * @inheritDoc
+ */
+int lane_image_jpeg_from_file(FILE *file, lane_image_t **image, uint8_t scale) {
+#ifdef LANE_JPEG_ENABLE
+	return decode(file, scale, false, image, NULL);
+#else
+	(void) file;
+	(void) image;
+	(void) scale;
+
+	LANE_LOG_ERROR("JPEG support was not compiled in");
+
+	return 1;
+#endif
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_image_jpeg_gray_from_file(FILE *file, lane_plane_t **plane, uint8_t scale) {
+#ifdef LANE_JPEG_ENABLE
+	return decode(file, scale, true, NULL, plane);
+#else
+	(void) file;
+	(void) plane;
+	(void) scale;
+
+	LANE_LOG_ERROR("JPEG support was not compiled in");
+
+	return 1;
+#endif
+}
+
+#ifdef LANE_JPEG_ENABLE
+
+/*
+ * @inheritDoc
+ */
+static void error_exit(j_common_ptr info) {
+	lane_jpeg_error_manager_t *errors = (lane_jpeg_error_manager_t *) info->err;
+	char message[JMSG_LENGTH_MAX];
+
+	errors->base.format_message(info, message);
+	LANE_LOG_ERROR("Error while decoding JPEG: %s", message);
+
+	longjmp(errors->jump, 1);
+}
+
+/*
+ * @inheritDoc
+ */
+static int decode(FILE *file, uint8_t scale, bool gray, lane_image_t **image, lane_plane_t **plane) {
+	struct jpeg_decompress_struct info;
+	lane_jpeg_error_manager_t errors;
+	// Volatile, because they are used after returning from an error
+	lane_image_t *volatile out_image = NULL;
+	lane_plane_t *volatile out_plane = NULL;
+	JSAMPROW row;
+
+	if (!file) {
+		LANE_LOG_ERROR("No file specified");
+		return 1;
+	}
+
+	if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+		LANE_LOG_ERROR("Scale must be 1, 2, 4 or 8 instead of %d", scale);
+		return 2;
+	}
+
+	info.err = jpeg_std_error(&(errors.base));
+	errors.base.error_exit = error_exit;
+
+	if (setjmp(errors.jump)) {
+		jpeg_destroy_decompress(&info);
+
+		if (out_image) lane_image_free(out_image);
+		if (out_plane) lane_plane_free(out_plane);
+
+		return 3;
+	}
+
+	jpeg_create_decompress(&info);
+	jpeg_stdio_src(&info, file);
+	jpeg_read_header(&info, TRUE);
+
+	// Let the inverse DCT produce the smaller image directly;
+	// the chroma is not even decoded for grayscale output
+	info.scale_num = 1;
+	info.scale_denom = scale;
+	info.out_color_space = gray ? JCS_GRAYSCALE : JCS_RGB;
+
+	jpeg_start_decompress(&info);
+
+	if (info.output_width > UINT16_MAX || info.output_height > UINT16_MAX) {
+		LANE_LOG_ERROR("Image (%u x %u px) is too large", info.output_width, info.output_height);
+		jpeg_destroy_decompress(&info);
+
+		return 4;
+	}
+
+	LANE_LOG_INFO("Decoding JPEG of %u x %u at %u x %u", info.image_width, info.image_height, info.output_width, info.output_height);
+
+	if (gray) {
+		out_plane = lane_plane_new(info.output_width, info.output_height, LANE_PLANE_U8);
+	} else {
+		out_image = lane_image_new(info.output_width, info.output_height);
+	}
+
+	if (!out_plane && !out_image) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		jpeg_destroy_decompress(&info);
+
+		return 5;
+	}
+
+	// The decoded rows have the layout of the rows of the
+	// plane or of the pixels, so they are written in place
+	while (info.output_scanline < info.output_height) {
+		if (gray) {
+			row = LANE_PLANE_ROW(out_plane, uint8_t, info.output_scanline);
+		} else {
+			row = &(out_image->data[info.output_scanline * out_image->width].r);
+		}
+
+		jpeg_read_scanlines(&info, &row, 1);
+	}
+
+	jpeg_finish_decompress(&info);
+	jpeg_destroy_decompress(&info);
+
+	if (gray) {
+		(*plane) = out_plane;
+	} else {
+		(*image) = out_image;
+	}
+
+	return 0;
+}
+
+#endif /* LANE_JPEG_ENABLE */
@@ -0,0 +1,57 @@
+/**
+ * @file lane_image_jpeg.h
+ * @author Matthijs Bakker
+ * @brief Load images in JPEG format
+ *
+ * This code unit provides the loading of JPEG images, such as
+ * those of the BDD100K dataset, without converting them to PPM
+ * first. The decoder can downscale while decoding, so smaller
+ * images never need the pixels of the full resolution.<br />
+ * <br />
+ * It needs libjpeg and is only available if compiled with
+ * LANE_JPEG_ENABLE, otherwise every function fails.
+ */
+
+#ifndef LANE_IMAGE_JPEG_H
+#define LANE_IMAGE_JPEG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lane_image.h"
+#include "lane_plane.h"
+
+/**
+ * @brief Load an image from a JPEG file
+ *
+ * Allocates a new image and decodes a JPEG file into it.<br />
+ * <br />
+ * The image can be downscaled by 2, 4 or 8 in the DCT domain of
+ * the decoder, which is much faster than decoding all pixels. The
+ * dimensions are then divided by the scale and rounded up.
+ *
+ * @param file	File in JPEG format to read the image from
+ * @param image	The destination for the image
+ * @param scale	The divisor of the dimensions; 1, 2, 4 or 8
+ *
+ * @return	Zero if the operation succeeds, otherwise an error code
+ */
+int lane_image_jpeg_from_file(FILE *file, lane_image_t **image, uint8_t scale);
+
+/**
+ * @brief Load a grayscale plane from a JPEG file
+ *
+ * Like lane_image_jpeg_from_file, but allocates a LANE_PLANE_U8
+ * plane and only decodes the luminance of the image, so the color
+ * channels are skipped entirely. JPEG stores the BT.601 luminance,
+ * so the values are close to those of lane_grayscale_apply.
+ *
+ * @param file	File in JPEG format to read the image from
+ * @param plane	The destination for the plane
+ * @param scale	The divisor of the dimensions; 1, 2, 4 or 8
+ *
+ * @return	Zero if the operation succeeds, otherwise an error code
+ */
+int lane_image_jpeg_gray_from_file(FILE *file, lane_plane_t **plane, uint8_t scale);
+
+#endif /* LANE_IMAGE_JPEG_H */
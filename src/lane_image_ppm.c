@@ -6,12 +6,20 @@
  * This code unit provides the loading and saving of
  * images in the Portable Pixmap format.<br />
  * <br />
- * It only supports the P6 (binary colored images) standard.
+ * It supports the P6 (binary colored images) standard, and
+ * the P5 (binary grayscale images) standard for planes.
  */
 
 #include "lane_image_ppm.h"
 
+#include <ctype.h>
 #include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "lane_log.h"
 
@@ -26,76 +34,128 @@
 /**
  * @internal
  *
- * Macro for reading a line into a buffer.
+ * Prevent loading big images into memory by setting a limit.<br />
+ * <br />
+ * Without setting a limit, because of the data types, the
+ * maximum would be around 65535²; approx 4 GB
  */
-#define READ_LINE		\
-	if (!fgets(line_buffer, LINE_BUFFER_SIZE, file)) { \
-		return 2; \
-	}
+#define MAX_IMAGE_DIMENSIONS	4096
 
 /**
  * @internal
  *
- * Prevent loading big images into memory by setting a limit.<br />
+ * Amount of buffers that are written at once, which is IOV_MAX on Linux
+ */
+#define MAX_WRITE_BUFFERS	(1024)
+
+/**
+ * @internal
+ *
+ * Amount of fractional bits of the grayscale weights of the loader
+ */
+#define GRAY_SHIFT		(16)
+
+/**
+ * @internal
+ *
+ * Weight of the red channel, 0.2989 * 2^16 rounded
+ */
+#define GRAY_R			(19589)
+
+/**
+ * @internal
+ *
+ * Weight of the green channel, 0.5870 * 2^16 rounded
+ */
+#define GRAY_G			(38470)
+
+/**
+ * @internal
+ *
+ * Weight of the blue channel, 0.1140 * 2^16 rounded
+ */
+#define GRAY_B			(7471)
+
+/**
+ * @internal
+ *
+ * Reads the header of a P6 file, up to the start of the pixel data.<br />
  * <br />
- * Without setting a limit, because of the data types, the
- * maximum would be around 65535²; approx 4 GB
+ * It is read character by character, so that the position of the
+ * file is exactly at the pixels, which a stream of frames relies on.
+ *
+ * @param file		File in PPM format
+ * @param width		Output for the width of the image
+ * @param height	Output for the height of the image
+ * @return		Zero if the operation succeeds, otherwise an error code
  */
-#define MAX_IMAGE_DIMENSIONS	4096
+static int read_header(FILE *file, uint16_t *width, uint16_t *height);
+
+/**
+ * @internal
+ *
+ * Parses the header of a P5 or P6 file that is in memory.
+ *
+ * @param data		The contents of the file
+ * @param length	The length of the contents
+ * @param channels	Output for the amount of values per pixel
+ * @param width		Output for the width of the image
+ * @param height	Output for the height of the image
+ * @param offset	Output for the position of the pixel data
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+static int parse_header(const uint8_t *data, size_t length, uint8_t *channels, uint16_t *width, uint16_t *height, size_t *offset);
+
+/**
+ * @internal
+ *
+ * Reads one P5 or P6 image of a stream into a new buffer, with
+ * its header. Nothing after the image is read, so the stream is
+ * positioned at the next image, if there is any.<br />
+ * <br />
+ * The header may be at most LINE_BUFFER_SIZE bytes long, and
+ * the contents are shorter than the image if the stream ends.
+ *
+ * @param file		The stream
+ * @param data		Output for the buffer
+ * @param length	Output for the length of the contents
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+static int read_image(FILE *file, uint8_t **data, size_t *length);
+
+/**
+ * @internal
+ *
+ * Writes buffers to a file with as few system calls as possible.<br />
+ * <br />
+ * The buffered data of the file is flushed first, after which the
+ * buffers are gathered by writev. Streams without a descriptor are
+ * written with fwrite instead.
+ *
+ * @param file		The file
+ * @param buffers	The buffers, which are modified while writing
+ * @param count		The amount of buffers
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+static int write_all(FILE *file, struct iovec *buffers, int count);
 
 /*
  * @inheritDoc
  */
 int lane_image_ppm_from_file(FILE *file, lane_image_t **image) {
 	lane_image_t *out;
-	char line_buffer[LINE_BUFFER_SIZE];
 	uint16_t width, height;
 	uint8_t *raw;
 	int result, acc;
 
-	if (!file) {
-		LANE_LOG_ERROR("No file specified");
-		return 1;
-	}
-
-	// Read the first line with the magic code (should be 'PX\n')
-	// where X is the PPM version number.
-
-	READ_LINE;
+	result = read_header(file, &width, &height);
 
-	LANE_LOG_INFO("Reading PPM with format %s", line_buffer);
-
-	// P3 image format is ASCII-padded
-	// P6 is in binary, which is what we want
-	if (line_buffer[1] != '6') {
-		return 3;
-	}
-	
-	// Skip comments
-	while (line_buffer[0] == '#' || line_buffer[0] == 'P') {
-		READ_LINE;
+	if (result) {
+		return result;
 	}
 
-	// Read image dimensions
-	result = sscanf(line_buffer, "%hu %hu", &width, &height);	
-	if (result < 2) {
-		LANE_LOG_ERROR("Error while reading image dimensions");
-		return 5;
-	}
-	
 	out = lane_image_new(width, height);
 	(*image) = out;	
-	
-	LANE_LOG_INFO("Input image is %u x %u", width, height);
-
-	if (width > MAX_IMAGE_DIMENSIONS || height > MAX_IMAGE_DIMENSIONS) {
-		LANE_LOG_ERROR("Image (%1$hu x %2$hu px) is larger than allowed (%3$d x %3$d px)",
-				width, height, MAX_IMAGE_DIMENSIONS);
-		return 6;
-	}
-
-	READ_LINE; // skip bpp value
-	//fseek(file, 1, SEEK_CUR); // skip newline symbol
 
 	// read from file into raw
 	raw = malloc(width * height * sizeof(lane_pixel_t));
@@ -123,37 +183,608 @@ int lane_image_ppm_from_file(FILE *file, lane_image_t **image) {
 /*
  * @inheritDoc
  */
-// TODO we probably should use a bigger write buffer for better performance
+int lane_image_ppm_gray_from_file(FILE *file, lane_plane_t **plane) {
+	lane_plane_t *out;
+	uint16_t width, height, x, y;
+	uint8_t *raw, *row;
+	int result;
+
+	result = read_header(file, &width, &height);
+
+	if (result) {
+		return result;
+	}
+
+	out = lane_plane_new(width, height, LANE_PLANE_U8);
+
+	// Only one row of the payload is kept at a time
+	raw = malloc(width * sizeof(lane_pixel_t));
+
+	if (!out || !raw) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+
+		if (out) lane_plane_free(out);
+		free(raw);
+
+		return 8;
+	}
+
+	for (y = 0; y < height; ++y) {
+		if (fread(raw, sizeof(lane_pixel_t), width, file) < width) {
+			LANE_LOG_ERROR("Expected %d rows, only %d rows read", height, y);
+
+			lane_plane_free(out);
+			free(raw);
+
+			return 7;
+		}
+
+		row = LANE_PLANE_ROW(out, uint8_t, y);
+
+		// The same weights as lane_grayscale_apply, but rounded like rgb2gray
+		for (x = 0; x < width; ++x) {
+			row[x] = ((GRAY_R * raw[3 * x]) + (GRAY_G * raw[(3 * x) + 1]) + (GRAY_B * raw[(3 * x) + 2])
+					+ (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT;
+		}
+	}
+
+	LANE_LOG_INFO("Image data converted into plane");
+
+	free(raw);
+
+	(*plane) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_image_ppm_map(FILE *file, lane_image_map_t **map) {
+	lane_image_map_t *out;
+	struct stat info;
+	uint8_t *data = NULL, channels;
+	uint16_t width, height;
+	size_t length = 0, offset, size;
+	off_t start;
+	int result;
+
+	if (!file) {
+		LANE_LOG_ERROR("No file specified");
+		return 1;
+	}
+
+	out = calloc(1, sizeof(lane_image_map_t));
+
+	if (!out) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		return 8;
+	}
+
+	start = ftello(file);
+
+	// Only regular files can be mapped, and a mapping starts at a page,
+	// so the whole file is mapped and the image starts at the position
+	if (start >= 0 && !fstat(fileno(file), &info) && S_ISREG(info.st_mode) && info.st_size > start) {
+		out->base = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0);
+
+		if (out->base != MAP_FAILED) {
+			out->length = info.st_size;
+			out->mapped = true;
+
+			data = ((uint8_t *) out->base) + start;
+			length = info.st_size - start;
+
+			madvise(out->base, out->length, MADV_WILLNEED);
+		} else {
+			out->base = NULL;
+		}
+	}
+
+	if (!out->mapped) {
+		result = read_image(file, &data, &length);
+
+		if (result) {
+			lane_image_ppm_unmap(out);
+			return result;
+		}
+
+		out->base = data;
+		out->length = length;
+	}
+
+	result = parse_header(data, length, &channels, &width, &height, &offset);
+
+	if (result) {
+		lane_image_ppm_unmap(out);
+		return result;
+	}
+
+	size = (size_t) width * height * channels;
+
+	if (length - offset < size) {
+		LANE_LOG_ERROR("Expected %zu bytes, only %zu bytes available", size, length - offset);
+		lane_image_ppm_unmap(out);
+
+		return 7;
+	}
+
+	if (out->mapped) {
+		fseeko(file, start + offset + size, SEEK_SET);
+	}
+
+	if (channels == 3) {
+		out->image = malloc(sizeof(lane_image_t));
+
+		if (out->image) {
+			out->image->width = width;
+			out->image->height = height;
+			out->image->data = (lane_pixel_t *) &(data[offset]);
+		}
+	} else {
+		out->plane = malloc(sizeof(lane_plane_t));
+
+		if (out->plane) {
+			out->plane->width = width;
+			out->plane->height = height;
+			out->plane->type = LANE_PLANE_U8;
+			out->plane->stride = width;
+			out->plane->data = &(data[offset]);
+		}
+	}
+
+	if (!out->image && !out->plane) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		lane_image_ppm_unmap(out);
+
+		return 8;
+	}
+
+	LANE_LOG_INFO("Image of %u x %u %s", width, height, out->mapped ? "mapped" : "read into buffer");
+
+	(*map) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_image_ppm_unmap(lane_image_map_t *map) {
+	if (map->mapped) {
+		munmap(map->base, map->length);
+	} else {
+		free(map->base);
+	}
+
+	// Only the structs, as their data is part of the map
+	free(map->image);
+	free(map->plane);
+	free(map);
+}
+
+/*
+ * @inheritDoc
+ */
 int lane_image_ppm_to_file(FILE *file, lane_image_t *image) {
-	size_t acc = 0;
-	uint8_t write_buffer[3];
-	lane_pixel_t current_pixel;
-	
+	char header[LINE_BUFFER_SIZE];
+	struct iovec buffers[2];
+
 	// Check if file stream is valid
 	if (!file) {
 		LANE_LOG_ERROR("No file specified");
 		return 1;
 	}
 
-	// write magic and header
-	fprintf(file, "P6\n%d %d\n255\n", image->width, image->height);
+	// The pixels already have the layout of the payload,
+	// so the header and the whole frame are written at once
+	buffers[0].iov_base = header;
+	buffers[0].iov_len = snprintf(header, LINE_BUFFER_SIZE, "P6\n%d %d\n255\n", image->width, image->height);
+	buffers[1].iov_base = image->data;
+	buffers[1].iov_len = (size_t) image->width * image->height * sizeof(lane_pixel_t);
 
-	// Loop horizontally over the image, 
-	for (size_t col = 0; col < image->height; ++col) {
-		for (size_t row = 0; row < image->width; ++row) {
+	return write_all(file, buffers, 2);
+}
 
-			// Write all three color bytes at once
-			// by first loading them into a buffer
-			current_pixel = image->data[acc++];
+/*
+ * @inheritDoc
+ */
+int lane_image_ppm_plane_to_file(FILE *file, const lane_plane_t *const plane) {
+	char header[LINE_BUFFER_SIZE];
+	lane_plane_t *gray = NULL;
+	struct iovec *buffers;
+	uint16_t y, rows;
+	int result;
 
-			write_buffer[0] = current_pixel.r;
-			write_buffer[1] = current_pixel.g;
-			write_buffer[2] = current_pixel.b;
+	if (!file) {
+		LANE_LOG_ERROR("No file specified");
+		return 1;
+	}
 
-			fwrite(write_buffer, 1, 3, file);
+	if (plane->type != LANE_PLANE_U8) {
+		if (lane_plane_convert(plane, LANE_PLANE_U8, &gray)) {
+			return 8;
 		}
+
+		result = lane_image_ppm_plane_to_file(file, gray);
+		lane_plane_free(gray);
+
+		return result;
+	}
+
+	// The rows are contiguous if they are not padded
+	rows = plane->stride == plane->width ? 1 : plane->height;
+	buffers = malloc((1 + rows) * sizeof(struct iovec));
+
+	if (!buffers) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		return 8;
+	}
+
+	buffers[0].iov_base = header;
+	buffers[0].iov_len = snprintf(header, LINE_BUFFER_SIZE, "P5\n%d %d\n255\n", plane->width, plane->height);
+
+	for (y = 0; y < rows; ++y) {
+		buffers[1 + y].iov_base = LANE_PLANE_ROW(plane, uint8_t, y);
+		buffers[1 + y].iov_len = rows == 1 ? (size_t) plane->width * plane->height : plane->width;
 	}
 
+	result = write_all(file, buffers, 1 + rows);
+	free(buffers);
+
+	return result;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_image_ppm_stream_open(FILE *file, lane_image_ppm_stream_t **stream) {
+	lane_image_ppm_stream_t *out;
+
+	if (!file) {
+		LANE_LOG_ERROR("No file specified");
+		return 1;
+	}
+
+	out = calloc(1, sizeof(lane_image_ppm_stream_t));
+
+	if (!out) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		return 8;
+	}
+
+	out->file = file;
+
+	(*stream) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_image_ppm_stream_read(lane_image_ppm_stream_t *stream, lane_image_t **image) {
+	uint16_t width, height;
+	size_t amount;
+	int c, result;
+
+	// The stream may only end between frames
+	c = getc(stream->file);
+
+	if (c == EOF) {
+		return ferror(stream->file) ? 2 : LANE_IMAGE_PPM_END;
+	}
+
+	ungetc(c, stream->file);
+
+	result = read_header(stream->file, &width, &height);
+
+	if (result) {
+		return result;
+	}
+
+	// The pixels of the previous frame are overwritten,
+	// unless the new one has other dimensions
+	if (!stream->image || stream->image->width != width || stream->image->height != height) {
+		if (stream->image) {
+			lane_image_free(stream->image);
+		}
+
+		stream->image = lane_image_new(width, height);
+
+		if (!stream->image || !stream->image->data) {
+			LANE_LOG_ERROR("Unable to initialize memory");
+			stream->image = NULL;
+
+			return 8;
+		}
+	}
+
+	// The pixels have the layout of the payload, so they are read in place
+	amount = (size_t) width * height;
+
+	if (fread(stream->image->data, sizeof(lane_pixel_t), amount, stream->file) < amount) {
+		LANE_LOG_ERROR("Frame %zu ends before all of its pixels", stream->frames);
+		return 7;
+	}
+
+	++(stream->frames);
+
+	(*image) = stream->image;
+
 	return 0;
 }
 
+/*
+ * @inheritDoc
+ */
+int lane_image_ppm_stream_write(lane_image_ppm_stream_t *stream, lane_image_t *image) {
+	int result;
+
+	// Frames are simply written after each other
+	result = lane_image_ppm_to_file(stream->file, image);
+
+	if (!result) {
+		++(stream->frames);
+	}
+
+	return result;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_image_ppm_stream_close(lane_image_ppm_stream_t *stream) {
+	if (stream->image) {
+		lane_image_free(stream->image);
+	}
+
+	free(stream);
+}
+
+/*
+ * @inheritDoc
+ */
+static int read_header(FILE *file, uint16_t *width, uint16_t *height) {
+	unsigned long values[3];
+	int c, v;
+
+	if (!file) {
+		LANE_LOG_ERROR("No file specified");
+		return 1;
+	}
+
+	// P3 image format is ASCII-padded
+	// P6 is in binary, which is what we want
+	if (getc(file) != 'P' || getc(file) != '6') {
+		LANE_LOG_ERROR("Only P6 images are supported");
+		return 3;
+	}
+
+	// The width, height and maximum value, which may be on
+	// one line or on several, with comments in between
+	for (v = 0; v < 3; ++v) {
+		while ((c = getc(file)) != EOF && (isspace(c) || c == '#')) {
+			if (c == '#') {
+				while ((c = getc(file)) != EOF && c != '\n');
+			}
+		}
+
+		if (c == EOF || !isdigit(c)) {
+			LANE_LOG_ERROR("Error while reading image dimensions");
+			return 5;
+		}
+
+		for (values[v] = 0; c != EOF && isdigit(c) && values[v] <= UINT16_MAX; c = getc(file)) {
+			values[v] = (values[v] * 10) + (c - '0');
+		}
+
+		// Which also consumes the single whitespace before the pixels
+		if (c == EOF || !isspace(c)) {
+			LANE_LOG_ERROR("Error while reading image dimensions");
+			return 5;
+		}
+	}
+
+	LANE_LOG_INFO("Input image is %lu x %lu", values[0], values[1]);
+
+	if (values[0] > MAX_IMAGE_DIMENSIONS || values[1] > MAX_IMAGE_DIMENSIONS) {
+		LANE_LOG_ERROR("Image (%1$lu x %2$lu px) is larger than allowed (%3$d x %3$d px)",
+				values[0], values[1], MAX_IMAGE_DIMENSIONS);
+		return 6;
+	}
+
+	if (!values[2] || values[2] > UINT8_MAX) {
+		LANE_LOG_ERROR("Only images with 8-bit values are supported");
+		return 5;
+	}
+
+	(*width) = values[0];
+	(*height) = values[1];
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+static int parse_header(const uint8_t *data, size_t length, uint8_t *channels, uint16_t *width, uint16_t *height, size_t *offset) {
+	unsigned long values[3];
+	size_t i = 2;
+	uint8_t v;
+
+	if (length < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6')) {
+		LANE_LOG_ERROR("Only P5 and P6 images can be mapped");
+		return 3;
+	}
+
+	(*channels) = data[1] == '6' ? 3 : 1;
+
+	// The width, height and maximum value
+	for (v = 0; v < 3; ++v) {
+		// Skip whitespace and comments before each value
+		while (i < length && (isspace(data[i]) || data[i] == '#')) {
+			if (data[i] == '#') {
+				while (i < length && data[i] != '\n') ++i;
+			} else {
+				++i;
+			}
+		}
+
+		if (i >= length || !isdigit(data[i])) {
+			LANE_LOG_ERROR("Error while reading image dimensions");
+			return 5;
+		}
+
+		for (values[v] = 0; i < length && isdigit(data[i]) && values[v] <= UINT16_MAX; ++i) {
+			values[v] = (values[v] * 10) + (data[i] - '0');
+		}
+	}
+
+	// A single whitespace character separates the header from the pixels
+	if (i >= length || !isspace(data[i])) {
+		LANE_LOG_ERROR("Error while reading image header");
+		return 5;
+	}
+
+	if (!values[2] || values[2] > UINT8_MAX) {
+		LANE_LOG_ERROR("Only images with 8-bit values are supported");
+		return 5;
+	}
+
+	if (values[0] > MAX_IMAGE_DIMENSIONS || values[1] > MAX_IMAGE_DIMENSIONS) {
+		LANE_LOG_ERROR("Image (%1$lu x %2$lu px) is larger than allowed (%3$d x %3$d px)",
+				values[0], values[1], MAX_IMAGE_DIMENSIONS);
+		return 6;
+	}
+
+	(*width) = values[0];
+	(*height) = values[1];
+	(*offset) = i + 1;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+static int read_image(FILE *file, uint8_t **data, size_t *length) {
+	uint8_t header[LINE_BUFFER_SIZE], *buffer, channels;
+	uint16_t width, height;
+	size_t amount = 0, offset, size;
+	bool comment = false, digits = false;
+	int c, values = 0, result;
+
+	// Copy the header up to the whitespace after the maximum value,
+	// which is the last character that belongs to the header
+	while (amount < LINE_BUFFER_SIZE && (c = getc(file)) != EOF) {
+		header[amount++] = c;
+
+		// The magic number has a digit, but is not a value
+		if (amount <= 2) {
+			continue;
+		}
+
+		if (comment) {
+			comment = c != '\n';
+			continue;
+		}
+
+		if (isdigit(c)) {
+			digits = true;
+			continue;
+		}
+
+		if (digits) {
+			digits = false;
+
+			if (++values == 3) {
+				break;
+			}
+		}
+
+		comment = c == '#';
+	}
+
+	result = parse_header(header, amount, &channels, &width, &height, &offset);
+
+	if (result) {
+		return result;
+	}
+
+	size = (size_t) width * height * channels;
+	buffer = malloc(offset + size);
+
+	if (!buffer) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		return 8;
+	}
+
+	memcpy(buffer, header, offset);
+
+	size = fread(&(buffer[offset]), 1, size, file);
+
+	if (ferror(file)) {
+		LANE_LOG_ERROR("Error while reading from stream");
+		free(buffer);
+
+		return 2;
+	}
+
+	(*data) = buffer;
+	(*length) = offset + size;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+static int write_all(FILE *file, struct iovec *buffers, int count) {
+	ssize_t written;
+	int fd, i;
+
+	if (fflush(file)) {
+		LANE_LOG_ERROR("Error while flushing file");
+		return 2;
+	}
+
+	fd = fileno(file);
+
+	if (fd < 0) {
+		for (i = 0; i < count; ++i) {
+			if (fwrite(buffers[i].iov_base, 1, buffers[i].iov_len, file) < buffers[i].iov_len) {
+				LANE_LOG_ERROR("Error while writing to file");
+				return 2;
+			}
+		}
+
+		return 0;
+	}
+
+	while (count > 0) {
+		written = writev(fd, buffers, count < MAX_WRITE_BUFFERS ? count : MAX_WRITE_BUFFERS);
+
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			LANE_LOG_ERROR("Error while writing to file");
+			return 2;
+		}
+
+		// Skip the buffers that were written completely,
+		// and continue with the rest of a partial one
+		for (; count > 0 && (size_t) written >= buffers->iov_len; --count, ++buffers) {
+			written -= buffers->iov_len;
+		}
+
+		if (count > 0) {
+			buffers->iov_base = ((uint8_t *) buffers->iov_base) + written;
+			buffers->iov_len -= written;
+		}
+	}
+
+	return 0;
+}
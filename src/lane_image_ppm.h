@@ -6,13 +6,64 @@
  * This code unit provides the loading and saving of
  * images in the Portable Pixmap format.<br />
  * <br />
- * It only supports the P6 (binary colored images) standard.
+ * It supports the P6 (binary colored images) standard, and
+ * the P5 (binary grayscale images) standard for planes.
  */
 
 #ifndef LANE_IMAGE_PPM_H
 #define LANE_IMAGE_PPM_H
 
+#include <stdbool.h>
+
 #include "lane_image.h"
+#include "lane_plane.h"
+
+/**
+ * Returned by lane_image_ppm_stream_read when the stream has no more frames.
+ */
+#define LANE_IMAGE_PPM_END	(1)
+
+/**
+ * @copydoc image_map
+ */
+typedef struct image_map	lane_image_map_t;
+
+/**
+ * @brief An image that is a view of a file
+ *
+ * The pixels of a P6 file already have the layout of lane_pixel_t,
+ * and those of a P5 file that of a LANE_PLANE_U8 plane. So the image
+ * or plane of a map points directly into the mapped file, without
+ * copying it. Only one of both is set, depending on the format.<br />
+ * <br />
+ * The pixels can be modified, but this does not change the file.
+ * The rows of the plane are not aligned, as its stride is its width.
+ */
+struct image_map {
+	lane_image_t *image;
+	lane_plane_t *plane;
+	void *base;
+	size_t length;
+	bool mapped;
+};
+
+/**
+ * @copydoc ppm_stream
+ */
+typedef struct ppm_stream	lane_image_ppm_stream_t;
+
+/**
+ * @brief A stream of PPM frames
+ *
+ * Frames that are written back to back into one file or pipe, such
+ * as those of ffmpeg with -f image2pipe -c:v ppm. The image of a
+ * stream is reused for every frame that has the same dimensions.
+ */
+struct ppm_stream {
+	FILE *file;
+	lane_image_t *image;
+	size_t frames;
+};
 
 /**
  * @brief Load an image from a PPM file
@@ -26,11 +77,58 @@
  */
 int lane_image_ppm_from_file(FILE *file, lane_image_t **image);
 
+/**
+ * @brief Load a grayscale plane from a PPM file
+ *
+ * Allocates a new LANE_PLANE_U8 plane and fills it with the gray
+ * values of the pixels of a PPM file, converting them while they
+ * are read. This replaces lane_image_ppm_from_file followed by
+ * lane_grayscale_apply, without floating-point math. The values
+ * are rounded instead of truncated, so they can be one above those
+ * of lane_grayscale_apply, like those of MATLAB rgb2gray.
+ *
+ * @param file	File in PPM format to read the image from
+ * @param plane	The destination for the plane
+ *
+ * @return	Zero if the operation succeeds, otherwise an error code
+ */
+int lane_image_ppm_gray_from_file(FILE *file, lane_plane_t **plane);
+
+/**
+ * @brief Map an image from a PPM or PGM file
+ *
+ * Maps the rest of a file into memory and parses the header in
+ * place, after which the image or plane of the map points to the
+ * pixels in the mapped file. The position of the file is moved to
+ * the end of the image.<br />
+ * <br />
+ * Streams that cannot be mapped, such as pipes, are read into a
+ * buffer instead, which the map then points to. Only the header
+ * and the pixels of one image are read, so the stream is left at
+ * the next image, like a mapped file.
+ *
+ * @param file	File in PPM (P6) or PGM (P5) format to map the image from
+ * @param map	The destination for the map
+ *
+ * @return	Zero if the operation succeeds, otherwise an error code
+ */
+int lane_image_ppm_map(FILE *file, lane_image_map_t **map);
+
+/**
+ * Unmaps an image and deallocates its map. The image or plane of
+ * the map should not be deallocated with lane_image_free or
+ * lane_plane_free.
+ *
+ * @param map	The map to be deallocated
+ */
+void lane_image_ppm_unmap(lane_image_map_t *map);
+
 /**
  * @brief Write an image to a PPM file
  *
  * Writes an image to a file in PPM format.
  * If the destination file exists, it will be overwritten.
+ * The header and the pixels are written with a single system call.
  *
  * @param file	File destination
  * @param image	The image that needs to be written
@@ -39,5 +137,67 @@ int lane_image_ppm_from_file(FILE *file, lane_image_t **image);
  */
 int lane_image_ppm_to_file(FILE *file, lane_image_t *image);
 
+/**
+ * @brief Write a plane to a PGM file
+ *
+ * Writes a plane to a file in PGM (P5) format, with one byte per
+ * pixel instead of three. Planes of other types than LANE_PLANE_U8
+ * are clamped to 0-255 like lane_plane_convert.
+ *
+ * @param file	File destination
+ * @param plane	The plane that needs to be written
+ *
+ * @return	Zero if the operation succeeds, otherwise an error code
+ */
+int lane_image_ppm_plane_to_file(FILE *file, const lane_plane_t *const plane);
+
+/**
+ * @brief Open a stream of PPM frames
+ *
+ * Starts reading frames from, or writing frames to, a file or pipe.
+ *
+ * @param file		The file, which is not closed by lane_image_ppm_stream_close
+ * @param stream	Where the new stream should be placed
+ *
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_image_ppm_stream_open(FILE *file, lane_image_ppm_stream_t **stream);
+
+/**
+ * @brief Read the next frame of a stream
+ *
+ * Reads the next frame into the image of the stream, which is only
+ * allocated again if the dimensions of the frame have changed. So
+ * the image is overwritten by the next frame, and should not be
+ * deallocated by the caller.
+ *
+ * @param stream	The stream
+ * @param image		Where the image of the frame should be placed
+ *
+ * @return		Zero if the operation succeeds, LANE_IMAGE_PPM_END
+ * 			at the end of the stream, otherwise an error code
+ */
+int lane_image_ppm_stream_read(lane_image_ppm_stream_t *stream, lane_image_t **image);
+
+/**
+ * @brief Append a frame to a stream
+ *
+ * Writes an image after the frames that were written before,
+ * like lane_image_ppm_to_file.
+ *
+ * @param stream	The stream
+ * @param image		The image that needs to be written
+ *
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_image_ppm_stream_write(lane_image_ppm_stream_t *stream, lane_image_t *image);
+
+/**
+ * Deallocates a stream and the image of its frames.
+ *
+ * @param stream	The stream to be deallocated
+ */
+void lane_image_ppm_stream_close(lane_image_ppm_stream_t *stream);
+
 #endif /* LANE_IMAGE_PPM_H */
 
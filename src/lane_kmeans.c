@@ -15,73 +15,86 @@
 
 #include "lane_log.h"
 
+/**
+ * @internal
+ *
+ * Groups luminance values into <i>k</i> clusters using Lloyd's algorithm.<br />
+ * <br />
+ * Afterwards, the cluster of each pixel is the one with the nearest centroid.
+ *
+ * @param pixels	The luminance of each pixel, which clusters will be set
+ * @param size		The amount of pixels
+ * @param iterations	The amount of iterations through Lloyd's algorithm
+ * @param clusters	How many clusters should be used for grouping
+ * @param centroids	Output for the luminance of each cluster
+ */
+static void segment(lane_kmeans_mapped_pixel_t *pixels, int size, uint8_t iterations, uint8_t clusters, int *centroids);
+
 /*
  * @inheritDoc
  */
 void lane_kmeans_segment(lane_image_t *image, uint8_t iterations, uint8_t clusters) {
 	lane_kmeans_mapped_pixel_t *pixels;
 	const int size = image->width * image->height;
-	int i, j, k, diff, sl[clusters], total[clusters], centroids[clusters];
+	int i, centroids[clusters];
 
-	memset(sl, 0, sizeof(sl));
-	memset(total, 0, sizeof(total));
-	memset(centroids, 0, sizeof(centroids));
 	pixels = calloc(size, sizeof(lane_kmeans_mapped_pixel_t));
-	diff = j = 0;
 
 	for (i = 0; i < size; ++i) {
 		pixels[i].luminance = image->data[i].r;
-		pixels[i].cluster = 0;
-		pixels[i].nearest = UINT16_MAX;
 	}
 
-	// We could use random initialization or km++,
-	// but this hack works perfectly for our use case, so...
-	if (clusters == 2) {
-		centroids[0] = 0;
-		centroids[1] = 255;
-	} else {
-		for (i = 0; i < clusters; ++i) {
-			centroids[i] = image->data[j].r;
-			j += (size / clusters) - 1;
-		}
+	segment(pixels, size, iterations, clusters, centroids);
+
+	for (i = 0; i < size; ++i) {
+		image->data[i].r = image->data[i].g = image->data[i].b = (uint16_t) centroids[pixels[i].cluster];
 	}
 
-	for (i = 0; i < iterations; ++i) {
-		for (j = 0; j < clusters; ++j) {
-			for (k = 0; k < size; ++k) {
-				diff = abs((int) (centroids[j] - ((int) pixels[k].luminance)));
+	free(pixels);
+}
 
-				if (diff < pixels[k].nearest) {
-					pixels[k].nearest = (uint16_t) diff;
-					pixels[k].cluster = (uint8_t) j;
-				}
-			}
-		}
+/*
+ * @inheritDoc
+ */
+int lane_kmeans_segment_plane(lane_plane_t *plane, uint8_t iterations, uint8_t clusters) {
+	lane_kmeans_mapped_pixel_t *pixels;
+	const int size = plane->width * plane->height;
+	int x, y, centroids[clusters];
+	uint8_t *row;
 
-		for (j = 0; j < size; ++j) {
-			sl[pixels[j].cluster] += pixels[j].luminance;
-			(void) ++total[pixels[j].cluster];
-			pixels[j].nearest = UINT16_MAX;
-		}
+	if (plane->type != LANE_PLANE_U8) {
+		LANE_LOG_ERROR("Only planes of type LANE_PLANE_U8 can be segmented; aborting");
+		return 1;
+	}
 
-		for (j = 0; j < clusters; ++j) {
-			centroids[j] = sl[j] / total[j];
+	pixels = calloc(size, sizeof(lane_kmeans_mapped_pixel_t));
+
+	if (!pixels) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		return 2;
+	}
+
+	for (y = 0; y < plane->height; ++y) {
+		row = LANE_PLANE_ROW(plane, uint8_t, y);
+
+		for (x = 0; x < plane->width; ++x) {
+			pixels[(y * plane->width) + x].luminance = row[x];
 		}
 	}
 
-	for (i = 0; i < size; ++i) {
-		for (j = 0; j < clusters; ++j) {
-			diff = abs((int) (centroids[j] - ((int) pixels[i].luminance)));
+	segment(pixels, size, iterations, clusters, centroids);
 
-			if (diff < pixels[i].nearest) {
-				pixels[i].nearest = (uint16_t) diff;
-				image->data[i].r = image->data[i].g = image->data[i].b = (uint16_t) centroids[j];
-			}
+	for (y = 0; y < plane->height; ++y) {
+		row = LANE_PLANE_ROW(plane, uint8_t, y);
+
+		for (x = 0; x < plane->width; ++x) {
+			row[x] = centroids[pixels[(y * plane->width) + x].cluster];
 		}
 	}
 
 	free(pixels);
+
+	return 0;
 }
 
 /*
@@ -148,12 +161,74 @@ void lane_kmeans_apply(const lane_hough_normal_t *const lines, uint16_t lines_am
 /*
  * @inheritDoc
  */
-void lane_kmeans_medoid_plot(lane_image_t *image, const lane_hough_space_t *const space, const lane_kmeans_medoid_t medoid) {
+void lane_kmeans_medoid_plot(lane_image_t *image, const lane_hough_plan_t *const plan, const lane_kmeans_medoid_t medoid) {
 	// we can just use the trigonometry functions from the Hough code
 	lane_hough_resolved_line_t line;
 	lane_hough_normal_t normal = {.rho=medoid.rho, .theta=medoid.theta};
 
-	line = lane_hough_resolve_line(image, space, normal);
+	line = lane_hough_resolve_line(image, plan, normal);
 	lane_hough_plot_line(image, &line);
 }
 
+/*
+ * @inheritDoc
+ */
+static void segment(lane_kmeans_mapped_pixel_t *pixels, int size, uint8_t iterations, uint8_t clusters, int *centroids) {
+	int i, j, k, diff, sl[clusters], total[clusters];
+
+	memset(sl, 0, sizeof(sl));
+	memset(total, 0, sizeof(total));
+	memset(centroids, 0, clusters * sizeof(int));
+	diff = j = 0;
+
+	for (i = 0; i < size; ++i) {
+		pixels[i].cluster = 0;
+		pixels[i].nearest = UINT16_MAX;
+	}
+
+	// We could use random initialization or km++,
+	// but this hack works perfectly for our use case, so...
+	if (clusters == 2) {
+		centroids[0] = 0;
+		centroids[1] = 255;
+	} else {
+		for (i = 0; i < clusters; ++i) {
+			centroids[i] = pixels[j].luminance;
+			j += (size / clusters) - 1;
+		}
+	}
+
+	for (i = 0; i < iterations; ++i) {
+		for (j = 0; j < clusters; ++j) {
+			for (k = 0; k < size; ++k) {
+				diff = abs((int) (centroids[j] - ((int) pixels[k].luminance)));
+
+				if (diff < pixels[k].nearest) {
+					pixels[k].nearest = (uint16_t) diff;
+					pixels[k].cluster = (uint8_t) j;
+				}
+			}
+		}
+
+		for (j = 0; j < size; ++j) {
+			sl[pixels[j].cluster] += pixels[j].luminance;
+			(void) ++total[pixels[j].cluster];
+			pixels[j].nearest = UINT16_MAX;
+		}
+
+		for (j = 0; j < clusters; ++j) {
+			centroids[j] = sl[j] / total[j];
+		}
+	}
+
+	for (i = 0; i < size; ++i) {
+		for (j = 0; j < clusters; ++j) {
+			diff = abs((int) (centroids[j] - ((int) pixels[i].luminance)));
+
+			if (diff < pixels[i].nearest) {
+				pixels[i].nearest = (uint16_t) diff;
+				pixels[i].cluster = (uint8_t) j;
+			}
+		}
+	}
+}
@@ -15,6 +15,7 @@
 #include <stdlib.h>
 
 #include "lane_hough.h"
+#include "lane_plane.h"
 
 /**
  * @copydoc mapped_value
@@ -91,10 +92,10 @@ void lane_kmeans_apply(const lane_hough_normal_t *const lines, uint16_t lines_am
  * Plot the average result of a line cluster on an image
  *
  * @param image		The image that will be plotted upon
- * @param space		The Hough space where the line exists
+ * @param plan		The plan of the Hough space where the line exists
  * @param medoid	The medoid which needs to be plotted
  */
-void lane_kmeans_medoid_plot(lane_image_t *image, const lane_hough_space_t *const space, const lane_kmeans_medoid_t medoid);
+void lane_kmeans_medoid_plot(lane_image_t *image, const lane_hough_plan_t *const plan, const lane_kmeans_medoid_t medoid);
 
 /**
  * Segment an image into <i>k</i> amount of clusters
@@ -105,4 +106,14 @@ void lane_kmeans_medoid_plot(lane_image_t *image, const lane_hough_space_t *cons
  */
 void lane_kmeans_segment(lane_image_t *image, uint8_t iterations, uint8_t clusters);
 
+/**
+ * Segment a LANE_PLANE_U8 plane into <i>k</i> amount of clusters
+ *
+ * @param plane		The plane that will be segmented (and thus modified)
+ * @param iterations	The amount of iterations through Lloyd's algorithm
+ * @param clusters	How many clusters should be used for grouping
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_kmeans_segment_plane(lane_plane_t *plane, uint8_t iterations, uint8_t clusters);
+
 #endif /* LANE_KMEANS_H */
@@ -12,6 +12,9 @@
 
 #include <math.h>
 
+#include "lane_log.h"
+#include "lane_simd.h"
+
 /**
  * @internal
  *
@@ -42,42 +45,95 @@ const int kernel[KERNEL_DIAMETER][KERNEL_DIAMETER] = {
  */
 void lane_laplace_apply(const lane_image_t *const src, lane_image_t **dest) {
 	lane_image_t *out;
-	int x, y, m, i, j, si, ci;
+	uint8_t *rows, *line;
+	int y;
 
 	// Because the kernel cannot be convoluted with the 1 pixel
 	// border of the input image (there are no neighbor pixels)
 	// we have to cut off a part of the image and correct for it.
 	out = lane_image_new(src->width - KERNEL_RADIUS * 2, src->height - KERNEL_RADIUS * 2);
 
-	// For each pixel
+	// The last rows of the input as gray values, and an output row
+	rows = malloc(KERNEL_DIAMETER * src->width * sizeof(uint8_t));
+	line = out ? malloc(out->width * sizeof(uint8_t)) : NULL;
+
+	if (!out || !out->data || !rows || !line) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+
+		if (out) {
+			lane_image_free(out);
+		}
+
+		free(rows);
+		free(line);
+
+		(*dest) = NULL;
+
+		return;
+	}
+
+	for (y = 0; y < src->height; ++y) {
+		lane_simd_extract(&(src->data[y * src->width].r), &(rows[(y % KERNEL_DIAMETER) * src->width]), src->width);
+
+		if (y < KERNEL_DIAMETER - 1) {
+			continue;
+		}
+
+		// Convolve the kernel with the rows above, at and below
+		// the output row, which is clipped to 0-255
+		lane_simd_laplace(&(rows[((y - 2) % KERNEL_DIAMETER) * src->width]),
+				  &(rows[((y - 1) % KERNEL_DIAMETER) * src->width]),
+				  &(rows[(y % KERNEL_DIAMETER) * src->width]),
+				  line, out->width);
+
+		lane_simd_expand(line, &(out->data[(y - 2) * out->width].r), out->width);
+	}
+
+	free(rows);
+	free(line);
+
+	(*dest) = out;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_laplace_apply_plane(const lane_plane_t *const src, lane_plane_t **dest) {
+	const uint8_t *in;
+	lane_plane_t *out;
+	int16_t *o;
+	int x, y, m, i, j;
+
+	if (src->type != LANE_PLANE_U8) {
+		LANE_LOG_ERROR("Only planes of type LANE_PLANE_U8 are supported; aborting");
+		return 1;
+	}
+
+	out = lane_plane_new(src->width - KERNEL_RADIUS * 2, src->height - KERNEL_RADIUS * 2, LANE_PLANE_S16);
+
+	if (!out) {
+		return 2;
+	}
+
 	for (y = KERNEL_RADIUS; y < src->height - KERNEL_RADIUS; ++y) {
+		o = LANE_PLANE_ROW(out, int16_t, y - KERNEL_RADIUS);
+
 		for (x = KERNEL_RADIUS; x < src->width - KERNEL_RADIUS; ++x) {
 			m = 0;
-			
-			// Convolve the kernel with the original image
-			// on neighbor pixels to get the pixel magnitude
+
 			for (i = 0; i < KERNEL_DIAMETER; ++i) {
+				in = LANE_PLANE_ROW(src, uint8_t, y - KERNEL_RADIUS + i);
+
 				for (j = 0; j < KERNEL_DIAMETER; ++j) {
-					si = (y - KERNEL_RADIUS + i) * src->width + x - KERNEL_RADIUS + j;
-					m += src->data[si].r * kernel[i][j];
+					m += in[x - KERNEL_RADIUS + j] * kernel[i][j];
 				}
 			}
 
-			// Restrict the gradient magnitude within bounds
-			if (m < 0) m = 0;
-			if (m > 255) m = 255;
-	
-			// Calculate the corrected index of the target image
-			// (this takes into consideration the cropping)
-			ci = ((y - KERNEL_RADIUS) * out->width) + (x - KERNEL_RADIUS);
-
-			// Update the output pixel
-        		out->data[ci].r = m;
-        		out->data[ci].g = m;
-        		out->data[ci].b = m;
+			o[x - KERNEL_RADIUS] = m;
 		}
 	}
 
 	(*dest) = out;
-}
 
+	return 0;
+}
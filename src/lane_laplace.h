@@ -12,6 +12,7 @@
 #define LANE_LAPLACE_H
 
 #include "lane_image.h"
+#include "lane_plane.h"
 
 /**
  * @brief Convolute the Laplacian kernel with an image
@@ -28,8 +29,21 @@
  * grayscale, so the color values for R,G,B match for every pixel.
  *
  * @param src		The input image, which data will be read
- * @param dest		The output image, which will be (over)written to
+ * @param dest		The output image, which will be (over)written to,
+ * 			or NULL if memory cannot be allocated
  */
 void lane_laplace_apply(const lane_image_t *const src, lane_image_t **dest);
 
+/**
+ * @brief Convolute the Laplacian kernel with a plane
+ *
+ * Like lane_laplace_apply, but for a LANE_PLANE_U8 plane. The
+ * result is not clipped, so the negative side of an edge is kept.
+ *
+ * @param src		The input plane, which data will be read
+ * @param dest		Where the LANE_PLANE_S16 output should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_laplace_apply_plane(const lane_plane_t *const src, lane_plane_t **dest);
+
 #endif /* LANE_LAPLACE_H */
@@ -1,51 +1,76 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "lane_image.h"
 #include "lane_image_ppm.h"
 #include "lane_log.h"
 
 int main(int argc, char **argv) {
+	lane_image_ppm_stream_t *input = NULL,
+				*output = NULL;
 	lane_image_t *image = NULL;
 	FILE *file, *outfile = NULL;
+	int result;
 
 	if (argc < 3) {
-		LANE_LOG_ERROR("Argument 1 must be the filename of the PPM image and argument 2 must be a destination");
+		LANE_LOG_ERROR("Argument 1 must be the filename of the PPM image(s) and argument 2 must be a destination, either may be - for a pipe");
 		return 1;
 	}
 
-	file = fopen(argv[1], "rb");
+	// A file with one frame is simply a stream of one frame
+	file = strcmp(argv[1], "-") ? fopen(argv[1], "rb") : stdin;
 
 	if (!file) {
 		LANE_LOG_ERROR("File '%s' cannot be opened", argv[1]);
 		return 2;
 	}
 
-	if (lane_image_ppm_from_file(file, &image)) {
-		LANE_LOG_ERROR("Error while loading image from file '%s'", argv[1]);
-		return 3;
-	}
+	// Log messages are printed to stdout, so a stream to stdout gets
+	// its own descriptor, and stdout itself is sent to stderr instead
+	if (strcmp(argv[2], "-")) {
+		outfile = fopen(argv[2], "wb");
+	} else {
+		fflush(stdout);
+		outfile = fdopen(dup(STDOUT_FILENO), "wb");
 
-	if (file) {
-		fclose(file);
+		if (outfile) {
+			dup2(STDERR_FILENO, STDOUT_FILENO);
+		}
 	}
 
-	outfile = fopen(argv[2], "wb");
-
 	if (!outfile) {
 		LANE_LOG_ERROR("Output file '%s' cannot be opened", argv[2]);
+		return 2;
 	}
 
-	if (lane_image_ppm_to_file(outfile, image)) {
-		LANE_LOG_ERROR("Error while outputting to file '%s'", argv[2]);
-		return 4;
+	if (lane_image_ppm_stream_open(file, &input) || lane_image_ppm_stream_open(outfile, &output)) {
+		return 5;
 	}
 
-	if (outfile) {
-		fclose(outfile);
+	while (!(result = lane_image_ppm_stream_read(input, &image))) {
+		if (lane_image_ppm_stream_write(output, image)) {
+			LANE_LOG_ERROR("Error while outputting to file '%s'", argv[2]);
+			return 4;
+		}
 	}
 
-	return 0;
-}
+	if (result != LANE_IMAGE_PPM_END || !input->frames) {
+		LANE_LOG_ERROR("Error while loading image from file '%s'", argv[1]);
+		return 3;
+	}
+
+	LANE_LOG_INFO("Processed %zu frames", input->frames);
 
+	lane_image_ppm_stream_close(input);
+	lane_image_ppm_stream_close(output);
 
+	if (file != stdin) {
+		fclose(file);
+	}
+
+	fclose(outfile);
+
+	return 0;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file lane_plane.c
+ * @author Matthijs Bakker
+ * @brief Single-channel images with typed values
+ *
+ * This code unit provides images with a single channel of
+ * a specific value type, for the stages that only work on
+ * grayscale data or that need values beyond 0-255. Every
+ * row starts at an aligned address.
+ */
+
+#include "lane_plane.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "lane_log.h"
+#include "lane_simd.h"
+
+/**
+ * @internal
+ *
+ * Reads a value of a plane as a float.
+ *
+ * @param plane		The plane
+ * @param row		The row of the value
+ * @param x		The column of the value
+ * @return		The value
+ */
+static inline float load(const lane_plane_t *const plane, const void *row, uint16_t x);
+
+/**
+ * @internal
+ *
+ * Writes a float into a plane, clamped to the range of its type.
+ *
+ * @param plane		The plane
+ * @param row		The row of the value
+ * @param x		The column of the value
+ * @param value		The value
+ */
+static inline void store(const lane_plane_t *const plane, void *row, uint16_t x, float value);
+
+/*
+ * @inheritDoc
+ */
+lane_plane_t *lane_plane_new(uint16_t width, uint16_t height, uint8_t type) {
+	lane_plane_t *result;
+	size_t size = lane_plane_value_size(type);
+
+	if (!size) {
+		LANE_LOG_ERROR("Unknown plane type %d; aborting", type);
+		return NULL;
+	}
+
+	result = malloc(sizeof(lane_plane_t));
+
+	if (!result) {
+		LANE_LOG_ERROR("Allocating of plane failed; aborting");
+		return NULL;
+	}
+
+	result->width = width;
+	result->height = height;
+	result->type = type;
+	// Round the rows up, so that each of them is aligned as well
+	result->stride = ((width * size) + LANE_PLANE_ALIGNMENT - 1) & ~((size_t) LANE_PLANE_ALIGNMENT - 1);
+
+	// Like images, the data is not cleared upon allocation
+	if (posix_memalign(&(result->data), LANE_PLANE_ALIGNMENT, result->stride * (height ? height : 1))) {
+		LANE_LOG_ERROR("Allocating of plane data failed; aborting");
+		free(result);
+
+		return NULL;
+	}
+
+	return result;
+}
+
+/*
+ * @inheritDoc
+ */
+size_t lane_plane_value_size(uint8_t type) {
+	switch (type) {
+		case LANE_PLANE_U8:
+			return sizeof(uint8_t);
+		case LANE_PLANE_S16:
+			return sizeof(int16_t);
+		case LANE_PLANE_U16:
+			return sizeof(uint16_t);
+		case LANE_PLANE_F32:
+			return sizeof(float);
+		default:
+			return 0;
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_plane_from_image(const lane_image_t *const image, lane_plane_t **dest) {
+	lane_plane_t *out;
+	uint16_t y;
+
+	out = lane_plane_new(image->width, image->height, LANE_PLANE_U8);
+
+	if (!out) {
+		return 1;
+	}
+
+	for (y = 0; y < image->height; ++y) {
+		lane_simd_extract(&(image->data[y * image->width].r), LANE_PLANE_ROW(out, uint8_t, y), image->width);
+	}
+
+	(*dest) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_plane_convert(const lane_plane_t *const plane, uint8_t type, lane_plane_t **dest) {
+	lane_plane_t *out;
+	uint16_t x, y;
+
+	out = lane_plane_new(plane->width, plane->height, type);
+
+	if (!out) {
+		return 1;
+	}
+
+	for (y = 0; y < plane->height; ++y) {
+		if (type == plane->type) {
+			memcpy(LANE_PLANE_ROW(out, uint8_t, y), LANE_PLANE_ROW(plane, uint8_t, y), plane->width * lane_plane_value_size(type));
+			continue;
+		}
+
+		for (x = 0; x < plane->width; ++x) {
+			store(out, LANE_PLANE_ROW(out, uint8_t, y), x, load(plane, LANE_PLANE_ROW(plane, uint8_t, y), x));
+		}
+	}
+
+	(*dest) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_plane_to_image(const lane_plane_t *const plane, lane_image_t **dest) {
+	lane_plane_t *gray = NULL;
+	lane_image_t *out;
+	uint16_t y;
+
+	if (lane_plane_convert(plane, LANE_PLANE_U8, &gray)) {
+		return 1;
+	}
+
+	out = lane_image_new(plane->width, plane->height);
+
+	for (y = 0; y < gray->height; ++y) {
+		lane_simd_expand(LANE_PLANE_ROW(gray, uint8_t, y), &(out->data[y * out->width].r), gray->width);
+	}
+
+	lane_plane_free(gray);
+
+	(*dest) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_plane_free(lane_plane_t *plane) {
+	free(plane->data);
+	free(plane);
+}
+
+/*
+ * @inheritDoc
+ */
+static inline float load(const lane_plane_t *const plane, const void *row, uint16_t x) {
+	switch (plane->type) {
+		case LANE_PLANE_S16:
+			return ((const int16_t *) row)[x];
+		case LANE_PLANE_U16:
+			return ((const uint16_t *) row)[x];
+		case LANE_PLANE_F32:
+			return ((const float *) row)[x];
+		default:
+			return ((const uint8_t *) row)[x];
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+static inline void store(const lane_plane_t *const plane, void *row, uint16_t x, float value) {
+	switch (plane->type) {
+		case LANE_PLANE_S16:
+			((int16_t *) row)[x] = fminf(fmaxf(roundf(value), INT16_MIN), INT16_MAX);
+			break;
+		case LANE_PLANE_U16:
+			((uint16_t *) row)[x] = fminf(fmaxf(roundf(value), 0), UINT16_MAX);
+			break;
+		case LANE_PLANE_F32:
+			((float *) row)[x] = value;
+			break;
+		default:
+			((uint8_t *) row)[x] = fminf(fmaxf(roundf(value), 0), UINT8_MAX);
+			break;
+	}
+}
@@ -0,0 +1,138 @@
+/**
+ * @file lane_plane.h
+ * @author Matthijs Bakker
+ * @brief Single-channel images with typed values
+ *
+ * This code unit provides images with a single channel of
+ * a specific value type, for the stages that only work on
+ * grayscale data or that need values beyond 0-255. Every
+ * row starts at an aligned address.
+ */
+
+#ifndef LANE_PLANE_H
+#define LANE_PLANE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "lane_image.h"
+
+/**
+ * Values of a plane are of type uint8_t.
+ */
+#define LANE_PLANE_U8		(0)
+
+/**
+ * Values of a plane are of type int16_t.
+ */
+#define LANE_PLANE_S16		(1)
+
+/**
+ * Values of a plane are of type uint16_t.
+ */
+#define LANE_PLANE_U16		(2)
+
+/**
+ * Values of a plane are of type float.
+ */
+#define LANE_PLANE_F32		(3)
+
+/**
+ * The alignment in bytes of the data and of each row of a plane.
+ */
+#define LANE_PLANE_ALIGNMENT	(64)
+
+/**
+ * Gets a pointer to the first value in a row of a plane.
+ *
+ * @param plane		The plane
+ * @param type		The C type of the values of the plane
+ * @param y		The index of the row
+ */
+#define LANE_PLANE_ROW(plane, type, y)	((type *) (((uint8_t *) (plane)->data) + ((size_t) (y) * (plane)->stride)))
+
+/**
+ * @copydoc plane
+ */
+typedef struct plane	lane_plane_t;
+
+/**
+ * @brief A single-channel image in memory
+ *
+ * An image with one value per pixel, of one of the LANE_PLANE_* types.<br />
+ * <br />
+ * The rows are stored after each other, but the stride between
+ * them is rounded up to LANE_PLANE_ALIGNMENT bytes. So always find
+ * a row with LANE_PLANE_ROW instead of multiplying by the width.
+ * Planes that are views of other memory may not be aligned.
+ */
+struct plane {
+	uint16_t width, height;
+	uint8_t type;
+	size_t stride;
+	void *data;
+};
+
+/**
+ * Allocates a blank new plane.
+ *
+ * @param width		The width in pixels of the new plane
+ * @param height	The height in pixels of the new plane
+ * @param type		One of the LANE_PLANE_* types
+ * @return		A pointer to the struct, or NULL on failure
+ */
+lane_plane_t *lane_plane_new(uint16_t width, uint16_t height, uint8_t type);
+
+/**
+ * Gets the size of a single value of a plane type.
+ *
+ * @param type		One of the LANE_PLANE_* types
+ * @return		The size in bytes, or zero for unknown types
+ */
+size_t lane_plane_value_size(uint8_t type);
+
+/**
+ * @brief Extract a plane from an image
+ *
+ * Create a LANE_PLANE_U8 plane from the red channel of an image,
+ * which holds the value of every pixel of a grayscale image.
+ *
+ * @param image		The grayscale image, which data will be read
+ * @param dest		Where the new plane should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_plane_from_image(const lane_image_t *const image, lane_plane_t **dest);
+
+/**
+ * @brief Convert a plane to another value type
+ *
+ * Values that do not fit the new type are clamped to its
+ * range, and floating-point values are rounded.
+ *
+ * @param plane		The plane, which data will be read
+ * @param type		One of the LANE_PLANE_* types
+ * @param dest		Where the new plane should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_plane_convert(const lane_plane_t *const plane, uint8_t type, lane_plane_t **dest);
+
+/**
+ * @brief Convert a plane to a grayscale image
+ *
+ * The values are clamped to 0-255 like lane_plane_convert,
+ * so the plane can be plotted upon or saved.
+ *
+ * @param plane		The plane, which data will be read
+ * @param dest		Where the new image should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_plane_to_image(const lane_plane_t *const plane, lane_image_t **dest);
+
+/**
+ * Deallocates a plane and its associated data.
+ *
+ * @param plane		The plane to be deallocated
+ */
+void lane_plane_free(lane_plane_t *plane);
+
+#endif /* LANE_PLANE_H */
@@ -0,0 +1,260 @@
+/**
+ * @file lane_prefetch.c
+ * @author Matthijs Bakker
+ * @brief Load frames ahead of processing on a background thread
+ *
+ * This code unit provides a loader that reads and decodes PPM
+ * frames on a background thread, while the previous frames are
+ * still being processed. So the processing of a batch, such as
+ * the images of data/targets on a network share, does not have
+ * to wait for the disk before every frame.<br />
+ * <br />
+ * The decoded frames are kept in a bounded ring of images, which
+ * are reused for every frame with the same dimensions.
+ */
+
+#include "lane_prefetch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lane_log.h"
+
+/**
+ * @internal
+ *
+ * The largest amount of frames that can be read ahead
+ */
+#define MAX_DEPTH		(64)
+
+/**
+ * @internal
+ *
+ * Reads the frames of all files into the ring, until
+ * they are all read or the loader is stopped.
+ *
+ * @param arg		The loader
+ * @return		Nothing
+ */
+static void *produce(void *arg);
+
+/**
+ * @internal
+ *
+ * Reads the frames of one file into the ring.
+ *
+ * @param prefetch	The loader
+ * @param file		The file
+ * @return		Zero if all frames of the file were read, LANE_PREFETCH_END
+ * 			if the loader was stopped, otherwise an error code
+ */
+static int produce_file(lane_prefetch_t *prefetch, FILE *file);
+
+/*
+ * @inheritDoc
+ */
+int lane_prefetch_open(const char *const *paths, size_t count, size_t depth, lane_prefetch_t **prefetch) {
+	lane_prefetch_t *out;
+
+	if (!paths || !count) {
+		LANE_LOG_ERROR("No files specified");
+		return 1;
+	}
+
+	if (!depth || depth > MAX_DEPTH) {
+		LANE_LOG_ERROR("Depth must be between 1 and %d instead of %zu", MAX_DEPTH, depth);
+		return 2;
+	}
+
+	out = calloc(1, sizeof(lane_prefetch_t));
+
+	if (!out) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		return 5;
+	}
+
+	// The streams of the slots are opened by the thread, once
+	// it has a file, and then keep their image between files
+	out->slots = calloc(depth + 1, sizeof(lane_image_ppm_stream_t *));
+
+	if (!out->slots) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		free(out);
+
+		return 5;
+	}
+
+	out->paths = paths;
+	out->count = count;
+	out->depth = depth;
+
+	pthread_mutex_init(&(out->lock), NULL);
+	pthread_cond_init(&(out->changed), NULL);
+
+	if (pthread_create(&(out->thread), NULL, produce, out)) {
+		LANE_LOG_ERROR("Unable to spawn loader thread");
+
+		pthread_cond_destroy(&(out->changed));
+		pthread_mutex_destroy(&(out->lock));
+		free(out->slots);
+		free(out);
+
+		return 6;
+	}
+
+	(*prefetch) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_prefetch_next(lane_prefetch_t *prefetch, lane_image_t **image) {
+	int result = 0;
+
+	pthread_mutex_lock(&(prefetch->lock));
+
+	// The previous frame is done, so its slot may be filled again
+	if (prefetch->holding) {
+		++(prefetch->consumed);
+		prefetch->holding = false;
+
+		pthread_cond_broadcast(&(prefetch->changed));
+	}
+
+	while (prefetch->produced == prefetch->consumed && !prefetch->done) {
+		pthread_cond_wait(&(prefetch->changed), &(prefetch->lock));
+	}
+
+	// Frames that were read before an error are still returned
+	if (prefetch->produced == prefetch->consumed) {
+		result = prefetch->result;
+	} else {
+		(*image) = prefetch->slots[prefetch->consumed % (prefetch->depth + 1)]->image;
+		prefetch->holding = true;
+	}
+
+	pthread_mutex_unlock(&(prefetch->lock));
+
+	return result;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_prefetch_close(lane_prefetch_t *prefetch) {
+	size_t i;
+
+	pthread_mutex_lock(&(prefetch->lock));
+	prefetch->stop = true;
+	pthread_cond_broadcast(&(prefetch->changed));
+	pthread_mutex_unlock(&(prefetch->lock));
+
+	pthread_join(prefetch->thread, NULL);
+
+	for (i = 0; i <= prefetch->depth; ++i) {
+		if (prefetch->slots[i]) {
+			lane_image_ppm_stream_close(prefetch->slots[i]);
+		}
+	}
+
+	pthread_cond_destroy(&(prefetch->changed));
+	pthread_mutex_destroy(&(prefetch->lock));
+	free(prefetch->slots);
+	free(prefetch);
+}
+
+/*
+ * @inheritDoc
+ */
+static void *produce(void *arg) {
+	lane_prefetch_t *prefetch = arg;
+	FILE *file;
+	size_t i;
+	int result = 0;
+
+	for (i = 0; i < prefetch->count && !result; ++i) {
+		file = strcmp(prefetch->paths[i], "-") ? fopen(prefetch->paths[i], "rb") : stdin;
+
+		if (!file) {
+			LANE_LOG_ERROR("File '%s' cannot be opened", prefetch->paths[i]);
+			result = 3;
+
+			break;
+		}
+
+		result = produce_file(prefetch, file);
+
+		if (result && result != LANE_PREFETCH_END) {
+			LANE_LOG_ERROR("Error while loading image from file '%s'", prefetch->paths[i]);
+		}
+
+		if (file != stdin) {
+			fclose(file);
+		}
+	}
+
+	pthread_mutex_lock(&(prefetch->lock));
+	prefetch->result = result ? result : LANE_PREFETCH_END;
+	prefetch->done = true;
+	pthread_cond_broadcast(&(prefetch->changed));
+	pthread_mutex_unlock(&(prefetch->lock));
+
+	return NULL;
+}
+
+/*
+ * @inheritDoc
+ */
+static int produce_file(lane_prefetch_t *prefetch, FILE *file) {
+	lane_image_ppm_stream_t **slot;
+	lane_image_t *image;
+	bool stop;
+	int result;
+
+	for (;;) {
+		pthread_mutex_lock(&(prefetch->lock));
+
+		// The frame that was returned last is not ready, but its slot is not free either
+		while (prefetch->produced - prefetch->consumed - prefetch->holding >= prefetch->depth && !prefetch->stop) {
+			pthread_cond_wait(&(prefetch->changed), &(prefetch->lock));
+		}
+
+		slot = &(prefetch->slots[prefetch->produced % (prefetch->depth + 1)]);
+		stop = prefetch->stop;
+
+		pthread_mutex_unlock(&(prefetch->lock));
+
+		if (stop) {
+			return LANE_PREFETCH_END;
+		}
+
+		// The slot is not touched by the consumer until it is produced
+		if (!(*slot)) {
+			result = lane_image_ppm_stream_open(file, slot);
+
+			if (result) {
+				return result;
+			}
+		}
+
+		(*slot)->file = file;
+
+		result = lane_image_ppm_stream_read(*slot, &image);
+
+		if (result == LANE_IMAGE_PPM_END) {
+			return 0;
+		}
+
+		if (result) {
+			return result;
+		}
+
+		pthread_mutex_lock(&(prefetch->lock));
+		++(prefetch->produced);
+		pthread_cond_broadcast(&(prefetch->changed));
+		pthread_mutex_unlock(&(prefetch->lock));
+	}
+}
@@ -0,0 +1,91 @@
+/**
+ * @file lane_prefetch.h
+ * @author Matthijs Bakker
+ * @brief Load frames ahead of processing on a background thread
+ *
+ * This code unit provides a loader that reads and decodes PPM
+ * frames on a background thread, while the previous frames are
+ * still being processed. So the processing of a batch, such as
+ * the images of data/targets on a network share, does not have
+ * to wait for the disk before every frame.<br />
+ * <br />
+ * The decoded frames are kept in a bounded ring of images, which
+ * are reused for every frame with the same dimensions.
+ */
+
+#ifndef LANE_PREFETCH_H
+#define LANE_PREFETCH_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+
+/**
+ * Returned by lane_prefetch_next when all frames have been read.
+ */
+#define LANE_PREFETCH_END	(1)
+
+/**
+ * @copydoc prefetch
+ */
+typedef struct prefetch	lane_prefetch_t;
+
+/**
+ * @brief A loader of frames on a background thread
+ *
+ * The ring has one slot more than the amount of frames that
+ * is read ahead, which is the slot of the frame that has last
+ * been returned by lane_prefetch_next.
+ */
+struct prefetch {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	const char *const *paths;
+	size_t count, depth, produced, consumed;
+	lane_image_ppm_stream_t **slots;
+	int result;
+	bool holding, done, stop;
+};
+
+/**
+ * @brief Start loading frames on a background thread
+ *
+ * Starts a thread that reads the frames of each file in order, and
+ * keeps up to depth decoded frames ready for lane_prefetch_next. A
+ * file can also be a stream of PPM frames, or - for stdin.
+ *
+ * @param paths		The paths of the files, which must stay
+ * 			valid until lane_prefetch_close
+ * @param count		The amount of paths
+ * @param depth		The amount of frames to read ahead
+ * @param prefetch	Where the new loader should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_prefetch_open(const char *const *paths, size_t count, size_t depth, lane_prefetch_t **prefetch);
+
+/**
+ * @brief Take the next frame from the loader
+ *
+ * Waits until the next frame has been decoded, unless it already
+ * is. The image is returned to the ring by the next call, so it
+ * should not be used after that, nor be deallocated by the caller.
+ *
+ * @param prefetch	The loader
+ * @param image		Where the image of the frame should be placed
+ * @return		Zero if the operation succeeds, LANE_PREFETCH_END
+ * 			after the last frame, otherwise an error code
+ */
+int lane_prefetch_next(lane_prefetch_t *prefetch, lane_image_t **image);
+
+/**
+ * Stops the thread of a loader, and deallocates the loader and its images.
+ *
+ * @param prefetch	The loader to be deallocated
+ */
+void lane_prefetch_close(lane_prefetch_t *prefetch);
+
+#endif /* LANE_PREFETCH_H */
@@ -0,0 +1,1094 @@
+/**
+ * @file lane_simd.c
+ * @author Matthijs Bakker
+ * @brief Vectorized kernels for the image filters
+ *
+ * This code unit provides the inner loops of the image filters,
+ * implemented with the vector instructions of the processor. The
+ * best implementation is picked when the first kernel is used,
+ * by detecting which instruction sets the processor supports.
+ */
+
+#include "lane_simd.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "lane_log.h"
+#include "lane_sobel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON)
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+/**
+ * @internal
+ *
+ * Weight of the red channel, 0.2989 in fixed-point
+ */
+#define GRAY_R			(9794)
+
+/**
+ * @internal
+ *
+ * Weight of the green channel, 0.5870 in fixed-point
+ */
+#define GRAY_G			(19235)
+
+/**
+ * @internal
+ *
+ * Weight of the blue channel, 0.1140 in fixed-point
+ */
+#define GRAY_B			(3736)
+
+/**
+ * @internal
+ *
+ * The tangent of 22.5 degrees in 8-bit fixed-point, which is the
+ * border between a straight and a diagonal Sobel sector
+ */
+#define TAN_22_5		(106)
+
+/**
+ * @internal
+ *
+ * The largest magnitude that fits in a color channel
+ */
+#define MAGNITUDE_MAX		(255)
+
+/**
+ * @internal
+ *
+ * @copydoc kernels
+ */
+typedef struct kernels	lane_simd_kernels_t;
+
+/**
+ * @internal
+ *
+ * @brief The implementations of the kernels
+ *
+ * The kernels of a level, which are those of the level below
+ * for the kernels that the instruction set does not improve.
+ */
+struct kernels {
+	void (*gray)(const lane_color_t *, lane_color_t *, size_t);
+	void (*extract)(const lane_color_t *, lane_color_t *, size_t);
+	void (*expand)(const lane_color_t *, lane_color_t *, size_t);
+	void (*fill)(lane_color_t *, size_t, lane_pixel_t);
+	void (*threshold)(lane_color_t *, size_t, uint8_t, uint8_t, uint8_t, bool);
+	void (*add)(lane_color_t *, const lane_color_t *, size_t);
+	void (*laplace)(const lane_color_t *, const lane_color_t *, const lane_color_t *, lane_color_t *, size_t);
+	void (*sobel)(const lane_color_t *, const lane_color_t *, const lane_color_t *, lane_color_t *, uint8_t *, size_t);
+};
+
+/**
+ * @internal
+ *
+ * The kernels that are being used
+ */
+static lane_simd_kernels_t kernels;
+
+/**
+ * @internal
+ *
+ * The level of the kernels that are being used
+ */
+static uint8_t level;
+
+/**
+ * @internal
+ *
+ * The best level that the processor supports
+ */
+static uint8_t detected;
+
+/**
+ * @internal
+ *
+ * Makes sure the processor is only inspected once
+ */
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+/**
+ * @internal
+ *
+ * Detects the best level and selects its kernels.
+ */
+static void detect(void);
+
+/**
+ * @internal
+ *
+ * Selects the kernels of a level.
+ *
+ * @param target	One of the LANE_SIMD_* levels
+ */
+static void select_kernels(uint8_t target);
+
+/**
+ * @internal
+ *
+ * Finds the Sobel sector of the responses of both kernels.
+ *
+ * @param mx		The response of the horizontal kernel
+ * @param my		The response of the vertical kernel
+ * @return		One of the LANE_SOBEL_SECTOR_* codes
+ */
+static inline uint8_t sector(int mx, int my);
+
+/**
+ * @internal
+ *
+ * The plain C kernels, which also handle the remainders of
+ * the vectorized ones. Their documentation is that of the
+ * corresponding lane_simd_* function.
+ */
+static void gray_scalar(const lane_color_t *rgb, lane_color_t *dest, size_t n);
+static void extract_scalar(const lane_color_t *rgb, lane_color_t *dest, size_t n);
+static void expand_scalar(const lane_color_t *src, lane_color_t *rgb, size_t n);
+static void fill_scalar(lane_color_t *rgb, size_t n, lane_pixel_t color);
+static void threshold_scalar(lane_color_t *values, size_t n, uint8_t lower, uint8_t upper, uint8_t new, bool inside);
+static void add_scalar(lane_color_t *dest, const lane_color_t *src, size_t n);
+static void laplace_scalar(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *dest, size_t n);
+static void sobel_scalar(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *magnitudes, uint8_t *sectors, size_t n);
+
+#ifdef SIMD_X86
+/**
+ * @internal
+ *
+ * The SSE2, SSSE3 and AVX2 kernels.
+ */
+static void fill_sse2(lane_color_t *rgb, size_t n, lane_pixel_t color);
+static void threshold_sse2(lane_color_t *values, size_t n, uint8_t lower, uint8_t upper, uint8_t new, bool inside);
+static void add_sse2(lane_color_t *dest, const lane_color_t *src, size_t n);
+static void laplace_sse2(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *dest, size_t n);
+static void sobel_sse2(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *magnitudes, uint8_t *sectors, size_t n);
+static void gray_ssse3(const lane_color_t *rgb, lane_color_t *dest, size_t n);
+static void extract_ssse3(const lane_color_t *rgb, lane_color_t *dest, size_t n);
+static void expand_ssse3(const lane_color_t *src, lane_color_t *rgb, size_t n);
+static void threshold_avx2(lane_color_t *values, size_t n, uint8_t lower, uint8_t upper, uint8_t new, bool inside);
+static void add_avx2(lane_color_t *dest, const lane_color_t *src, size_t n);
+static void laplace_avx2(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *dest, size_t n);
+static void sobel_avx2(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *magnitudes, uint8_t *sectors, size_t n);
+#endif
+
+#ifdef SIMD_NEON
+/**
+ * @internal
+ *
+ * The NEON kernels.
+ */
+static void gray_neon(const lane_color_t *rgb, lane_color_t *dest, size_t n);
+static void extract_neon(const lane_color_t *rgb, lane_color_t *dest, size_t n);
+static void expand_neon(const lane_color_t *src, lane_color_t *rgb, size_t n);
+static void fill_neon(lane_color_t *rgb, size_t n, lane_pixel_t color);
+static void threshold_neon(lane_color_t *values, size_t n, uint8_t lower, uint8_t upper, uint8_t new, bool inside);
+static void add_neon(lane_color_t *dest, const lane_color_t *src, size_t n);
+static void laplace_neon(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *dest, size_t n);
+static void sobel_neon(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *magnitudes, uint8_t *sectors, size_t n);
+#endif
+
+/*
+ * @inheritDoc
+ */
+uint8_t lane_simd_level(void) {
+	pthread_once(&once, detect);
+
+	return level;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_simd_set_level(uint8_t target) {
+	pthread_once(&once, detect);
+
+	// NEON is not part of the x86 levels below it
+	if (target != LANE_SIMD_SCALAR && (target > detected || (detected == LANE_SIMD_NEON) != (target == LANE_SIMD_NEON))) {
+		LANE_LOG_ERROR("The processor does not support SIMD level %d", target);
+		return 1;
+	}
+
+	select_kernels(target);
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_simd_gray(const lane_color_t *rgb, lane_color_t *dest, size_t n) {
+	pthread_once(&once, detect);
+	kernels.gray(rgb, dest, n);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_simd_extract(const lane_color_t *rgb, lane_color_t *dest, size_t n) {
+	pthread_once(&once, detect);
+	kernels.extract(rgb, dest, n);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_simd_expand(const lane_color_t *src, lane_color_t *rgb, size_t n) {
+	pthread_once(&once, detect);
+	kernels.expand(src, rgb, n);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_simd_fill(lane_color_t *rgb, size_t n, lane_pixel_t color) {
+	pthread_once(&once, detect);
+	kernels.fill(rgb, n, color);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_simd_threshold(lane_color_t *values, size_t n, uint8_t lower, uint8_t upper, uint8_t new, bool inside) {
+	pthread_once(&once, detect);
+	kernels.threshold(values, n, lower, upper, new, inside);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_simd_add(lane_color_t *dest, const lane_color_t *src, size_t n) {
+	pthread_once(&once, detect);
+	kernels.add(dest, src, n);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_simd_laplace(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *dest, size_t n) {
+	pthread_once(&once, detect);
+	kernels.laplace(r0, r1, r2, dest, n);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_simd_sobel(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *magnitudes, uint8_t *sectors, size_t n) {
+	pthread_once(&once, detect);
+	kernels.sobel(r0, r1, r2, magnitudes, sectors, n);
+}
+
+/*
+ * @inheritDoc
+ */
+static void detect(void) {
+	detected = LANE_SIMD_SCALAR;
+
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		detected = LANE_SIMD_AVX2;
+	} else if (__builtin_cpu_supports("ssse3")) {
+		detected = LANE_SIMD_SSSE3;
+	} else if (__builtin_cpu_supports("sse2")) {
+		detected = LANE_SIMD_SSE2;
+	}
+#endif
+
+#ifdef SIMD_NEON
+	detected = LANE_SIMD_NEON;
+#endif
+
+	select_kernels(detected);
+}
+
+/*
+ * @inheritDoc
+ */
+static void select_kernels(uint8_t target) {
+	kernels = (lane_simd_kernels_t) {
+		.gray=gray_scalar,
+		.extract=extract_scalar,
+		.expand=expand_scalar,
+		.fill=fill_scalar,
+		.threshold=threshold_scalar,
+		.add=add_scalar,
+		.laplace=laplace_scalar,
+		.sobel=sobel_scalar
+	};
+
+#ifdef SIMD_X86
+	// Every level builds upon the one below it
+	if (target >= LANE_SIMD_SSE2) {
+		kernels.fill = fill_sse2;
+		kernels.threshold = threshold_sse2;
+		kernels.add = add_sse2;
+		kernels.laplace = laplace_sse2;
+		kernels.sobel = sobel_sse2;
+	}
+
+	if (target >= LANE_SIMD_SSSE3) {
+		kernels.gray = gray_ssse3;
+		kernels.extract = extract_ssse3;
+		kernels.expand = expand_ssse3;
+	}
+
+	if (target >= LANE_SIMD_AVX2) {
+		kernels.threshold = threshold_avx2;
+		kernels.add = add_avx2;
+		kernels.laplace = laplace_avx2;
+		kernels.sobel = sobel_avx2;
+	}
+#endif
+
+#ifdef SIMD_NEON
+	if (target == LANE_SIMD_NEON) {
+		kernels = (lane_simd_kernels_t) {
+			.gray=gray_neon,
+			.extract=extract_neon,
+			.expand=expand_neon,
+			.fill=fill_neon,
+			.threshold=threshold_neon,
+			.add=add_neon,
+			.laplace=laplace_neon,
+			.sobel=sobel_neon
+		};
+	}
+#endif
+
+	level = target;
+}
+
+/*
+ * @inheritDoc
+ */
+static inline uint8_t sector(int mx, int my) {
+	int ax = abs(mx),
+	    ay = abs(my);
+
+	if ((ay << 8) <= ax * TAN_22_5) {
+		return LANE_SOBEL_SECTOR_0;
+	}
+
+	if ((ax << 8) <= ay * TAN_22_5) {
+		return LANE_SOBEL_SECTOR_90;
+	}
+
+	return (mx > 0) != (my > 0) ? LANE_SOBEL_SECTOR_45 : LANE_SOBEL_SECTOR_135;
+}
+
+/*
+ * @inheritDoc
+ */
+static void gray_scalar(const lane_color_t *rgb, lane_color_t *dest, size_t n) {
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		dest[i] = ((GRAY_R * rgb[3 * i]) + (GRAY_G * rgb[(3 * i) + 1]) + (GRAY_B * rgb[(3 * i) + 2])) >> LANE_SIMD_GRAY_SHIFT;
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+static void extract_scalar(const lane_color_t *rgb, lane_color_t *dest, size_t n) {
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		dest[i] = rgb[3 * i];
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+static void expand_scalar(const lane_color_t *src, lane_color_t *rgb, size_t n) {
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		rgb[3 * i] = rgb[(3 * i) + 1] = rgb[(3 * i) + 2] = src[i];
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+static void fill_scalar(lane_color_t *rgb, size_t n, lane_pixel_t color) {
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		rgb[3 * i] = color.r;
+		rgb[(3 * i) + 1] = color.g;
+		rgb[(3 * i) + 2] = color.b;
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+static void threshold_scalar(lane_color_t *values, size_t n, uint8_t lower, uint8_t upper, uint8_t new, bool inside) {
+	size_t i;
+	bool within;
+
+	for (i = 0; i < n; ++i) {
+		within = values[i] >= lower && values[i] <= upper;
+
+		if (inside) {
+			values[i] = within ? new : 0;
+		} else if (!within) {
+			values[i] = new;
+		}
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+static void add_scalar(lane_color_t *dest, const lane_color_t *src, size_t n) {
+	size_t i;
+	int v;
+
+	for (i = 0; i < n; ++i) {
+		v = dest[i] + src[i];
+		dest[i] = v > UINT8_MAX ? UINT8_MAX : v;
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+static void laplace_scalar(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *dest, size_t n) {
+	size_t x;
+	int m;
+
+	for (x = 0; x < n; ++x) {
+		m = (4 * r1[x + 1]) - r0[x + 1] - r2[x + 1] - r1[x] - r1[x + 2];
+		dest[x] = m < 0 ? 0 : (m > UINT8_MAX ? UINT8_MAX : m);
+	}
+}
+
+/*
+ * @inheritDoc
+ */
+static void sobel_scalar(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *magnitudes, uint8_t *sectors, size_t n) {
+	size_t x;
+	int mx, my, m;
+
+	for (x = 0; x < n; ++x) {
+		mx = (r0[x + 2] - r0[x]) + 2 * (r1[x + 2] - r1[x]) + (r2[x + 2] - r2[x]);
+		my = (r0[x] + 2 * r0[x + 1] + r0[x + 2]) - (r2[x] + 2 * r2[x + 1] + r2[x + 2]);
+		m = (mx * mx) + (my * my);
+
+		sectors[x] = sector(mx, my);
+		magnitudes[x] = m >= MAGNITUDE_MAX * MAGNITUDE_MAX ? MAGNITUDE_MAX : (uint8_t) sqrtf(m);
+	}
+}
+
+#ifdef SIMD_X86
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("sse2")))
+static void fill_sse2(lane_color_t *rgb, size_t n, lane_pixel_t color) {
+	lane_color_t pattern[48];
+	__m128i p0, p1, p2;
+	size_t i;
+
+	// 16 pixels fill exactly three vectors
+	fill_scalar(pattern, 16, color);
+
+	p0 = _mm_loadu_si128((const __m128i *) &(pattern[0]));
+	p1 = _mm_loadu_si128((const __m128i *) &(pattern[16]));
+	p2 = _mm_loadu_si128((const __m128i *) &(pattern[32]));
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		_mm_storeu_si128((__m128i *) &(rgb[3 * i]), p0);
+		_mm_storeu_si128((__m128i *) &(rgb[(3 * i) + 16]), p1);
+		_mm_storeu_si128((__m128i *) &(rgb[(3 * i) + 32]), p2);
+	}
+
+	fill_scalar(&(rgb[3 * i]), n - i, color);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("sse2")))
+static void threshold_sse2(lane_color_t *values, size_t n, uint8_t lower, uint8_t upper, uint8_t new, bool inside) {
+	const __m128i lo = _mm_set1_epi8(lower),
+		      hi = _mm_set1_epi8(upper),
+		      nv = _mm_set1_epi8(new);
+	__m128i v, within;
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		v = _mm_loadu_si128((const __m128i *) &(values[i]));
+
+		// There are no unsigned comparisons, but a value is
+		// within a bound if clamping to it does not change it
+		within = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, lo), v), _mm_cmpeq_epi8(_mm_min_epu8(v, hi), v));
+
+		if (inside) {
+			v = _mm_and_si128(within, nv);
+		} else {
+			v = _mm_or_si128(_mm_and_si128(within, v), _mm_andnot_si128(within, nv));
+		}
+
+		_mm_storeu_si128((__m128i *) &(values[i]), v);
+	}
+
+	threshold_scalar(&(values[i]), n - i, lower, upper, new, inside);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("sse2")))
+static void add_sse2(lane_color_t *dest, const lane_color_t *src, size_t n) {
+	__m128i a, b;
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		a = _mm_loadu_si128((const __m128i *) &(dest[i]));
+		b = _mm_loadu_si128((const __m128i *) &(src[i]));
+		_mm_storeu_si128((__m128i *) &(dest[i]), _mm_adds_epu8(a, b));
+	}
+
+	add_scalar(&(dest[i]), &(src[i]), n - i);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("sse2")))
+static void laplace_sse2(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *dest, size_t n) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i c, m;
+	size_t x;
+
+	// Eight values at a time, widened to 16 bits
+	for (x = 0; x + 8 <= n; x += 8) {
+		c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r1[x + 1])), zero);
+		m = _mm_slli_epi16(c, 2);
+		m = _mm_sub_epi16(m, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r0[x + 1])), zero));
+		m = _mm_sub_epi16(m, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r2[x + 1])), zero));
+		m = _mm_sub_epi16(m, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r1[x])), zero));
+		m = _mm_sub_epi16(m, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r1[x + 2])), zero));
+
+		// Packing with unsigned saturation clips to 0-255
+		_mm_storel_epi64((__m128i *) &(dest[x]), _mm_packus_epi16(m, m));
+	}
+
+	laplace_scalar(&(r0[x]), &(r1[x]), &(r2[x]), &(dest[x]), n - x);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("sse2")))
+static void sobel_sse2(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *magnitudes, uint8_t *sectors, size_t n) {
+	const __m128i zero = _mm_setzero_si128(),
+		      one = _mm_set1_epi32(1),
+		      tangent = _mm_setr_epi16(1 << 8, -TAN_22_5, 1 << 8, -TAN_22_5, 1 << 8, -TAN_22_5, 1 << 8, -TAN_22_5),
+		      diagonal = _mm_set1_epi16(LANE_SOBEL_SECTOR_45),
+		      other = _mm_set1_epi16(LANE_SOBEL_SECTOR_135),
+		      vertical = _mm_set1_epi16(LANE_SOBEL_SECTOR_90);
+	__m128i a0, a1, a2, b0, b2, c0, c1, c2, mx, my, ax, ay, lo, hi, m, h, v, d, s;
+	size_t x;
+
+	for (x = 0; x + 8 <= n; x += 8) {
+		a0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r0[x])), zero);
+		a1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r1[x])), zero);
+		a2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r2[x])), zero);
+		b0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r0[x + 1])), zero);
+		b2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r2[x + 1])), zero);
+		c0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r0[x + 2])), zero);
+		c1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r1[x + 2])), zero);
+		c2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &(r2[x + 2])), zero);
+
+		mx = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(c0, a0), _mm_sub_epi16(c2, a2)), _mm_slli_epi16(_mm_sub_epi16(c1, a1), 1));
+		my = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(a0, c0), _mm_slli_epi16(b0, 1)), _mm_add_epi16(_mm_add_epi16(a2, c2), _mm_slli_epi16(b2, 1)));
+
+		// The squares no longer fit in 16 bits, but pairs of
+		// them can be multiplied and added into 32 bits
+		lo = _mm_unpacklo_epi16(mx, my);
+		hi = _mm_unpackhi_epi16(mx, my);
+		lo = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(lo, lo))));
+		hi = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(hi, hi))));
+
+		// Packing with unsigned saturation clips to 0-255
+		m = _mm_packs_epi32(lo, hi);
+		_mm_storel_epi64((__m128i *) &(magnitudes[x]), _mm_packus_epi16(m, m));
+
+		ax = _mm_max_epi16(mx, _mm_sub_epi16(zero, mx));
+		ay = _mm_max_epi16(my, _mm_sub_epi16(zero, my));
+
+		// Horizontal if (ay << 8) - ax * TAN_22_5 <= 0,
+		// which is one multiply-add of the pairs (ay, ax)
+		lo = _mm_madd_epi16(_mm_unpacklo_epi16(ay, ax), tangent);
+		hi = _mm_madd_epi16(_mm_unpackhi_epi16(ay, ax), tangent);
+		h = _mm_packs_epi32(_mm_cmpgt_epi32(one, lo), _mm_cmpgt_epi32(one, hi));
+
+		lo = _mm_madd_epi16(_mm_unpacklo_epi16(ax, ay), tangent);
+		hi = _mm_madd_epi16(_mm_unpackhi_epi16(ax, ay), tangent);
+		v = _mm_packs_epi32(_mm_cmpgt_epi32(one, lo), _mm_cmpgt_epi32(one, hi));
+
+		d = _mm_xor_si128(_mm_cmpgt_epi16(mx, zero), _mm_cmpgt_epi16(my, zero));
+
+		// Select the sectors in reverse order of precedence
+		s = _mm_or_si128(_mm_and_si128(d, diagonal), _mm_andnot_si128(d, other));
+		s = _mm_or_si128(_mm_and_si128(v, vertical), _mm_andnot_si128(v, s));
+		s = _mm_andnot_si128(h, s);
+		_mm_storel_epi64((__m128i *) &(sectors[x]), _mm_packus_epi16(s, s));
+	}
+
+	sobel_scalar(&(r0[x]), &(r1[x]), &(r2[x]), &(magnitudes[x]), &(sectors[x]), n - x);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("ssse3")))
+static void gray_ssse3(const lane_color_t *rgb, lane_color_t *dest, size_t n) {
+	// Shuffles that gather a channel of 16 pixels from three vectors
+	const __m128i r0 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+		      r1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1),
+		      r2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13),
+		      g0 = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+		      g1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1),
+		      g2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14),
+		      b0 = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+		      b1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1),
+		      b2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15),
+		      zero = _mm_setzero_si128(),
+		      rg = _mm_setr_epi16(GRAY_R, GRAY_G, GRAY_R, GRAY_G, GRAY_R, GRAY_G, GRAY_R, GRAY_G),
+		      bz = _mm_setr_epi16(GRAY_B, 0, GRAY_B, 0, GRAY_B, 0, GRAY_B, 0);
+	__m128i a, b, c, r, g, bl, rl, gl, bll, y0, y1, y2, y3;
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		a = _mm_loadu_si128((const __m128i *) &(rgb[3 * i]));
+		b = _mm_loadu_si128((const __m128i *) &(rgb[(3 * i) + 16]));
+		c = _mm_loadu_si128((const __m128i *) &(rgb[(3 * i) + 32]));
+
+		r = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, r0), _mm_shuffle_epi8(b, r1)), _mm_shuffle_epi8(c, r2));
+		g = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, g0), _mm_shuffle_epi8(b, g1)), _mm_shuffle_epi8(c, g2));
+		bl = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, b0), _mm_shuffle_epi8(b, b1)), _mm_shuffle_epi8(c, b2));
+
+		// The weighted sums of four pixels at a time, in 32 bits
+		rl = _mm_unpacklo_epi8(r, zero);
+		gl = _mm_unpacklo_epi8(g, zero);
+		bll = _mm_unpacklo_epi8(bl, zero);
+		y0 = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(rl, gl), rg), _mm_madd_epi16(_mm_unpacklo_epi16(bll, zero), bz));
+		y1 = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(rl, gl), rg), _mm_madd_epi16(_mm_unpackhi_epi16(bll, zero), bz));
+
+		rl = _mm_unpackhi_epi8(r, zero);
+		gl = _mm_unpackhi_epi8(g, zero);
+		bll = _mm_unpackhi_epi8(bl, zero);
+		y2 = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(rl, gl), rg), _mm_madd_epi16(_mm_unpacklo_epi16(bll, zero), bz));
+		y3 = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(rl, gl), rg), _mm_madd_epi16(_mm_unpackhi_epi16(bll, zero), bz));
+
+		y0 = _mm_packs_epi32(_mm_srli_epi32(y0, LANE_SIMD_GRAY_SHIFT), _mm_srli_epi32(y1, LANE_SIMD_GRAY_SHIFT));
+		y2 = _mm_packs_epi32(_mm_srli_epi32(y2, LANE_SIMD_GRAY_SHIFT), _mm_srli_epi32(y3, LANE_SIMD_GRAY_SHIFT));
+		_mm_storeu_si128((__m128i *) &(dest[i]), _mm_packus_epi16(y0, y2));
+	}
+
+	gray_scalar(&(rgb[3 * i]), &(dest[i]), n - i);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("ssse3")))
+static void extract_ssse3(const lane_color_t *rgb, lane_color_t *dest, size_t n) {
+	const __m128i r0 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+		      r1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1),
+		      r2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+	__m128i a, b, c;
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		a = _mm_loadu_si128((const __m128i *) &(rgb[3 * i]));
+		b = _mm_loadu_si128((const __m128i *) &(rgb[(3 * i) + 16]));
+		c = _mm_loadu_si128((const __m128i *) &(rgb[(3 * i) + 32]));
+
+		a = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, r0), _mm_shuffle_epi8(b, r1)), _mm_shuffle_epi8(c, r2));
+		_mm_storeu_si128((__m128i *) &(dest[i]), a);
+	}
+
+	extract_scalar(&(rgb[3 * i]), &(dest[i]), n - i);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("ssse3")))
+static void expand_ssse3(const lane_color_t *src, lane_color_t *rgb, size_t n) {
+	const __m128i e0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5),
+		      e1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10),
+		      e2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+	__m128i v;
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		v = _mm_loadu_si128((const __m128i *) &(src[i]));
+
+		_mm_storeu_si128((__m128i *) &(rgb[3 * i]), _mm_shuffle_epi8(v, e0));
+		_mm_storeu_si128((__m128i *) &(rgb[(3 * i) + 16]), _mm_shuffle_epi8(v, e1));
+		_mm_storeu_si128((__m128i *) &(rgb[(3 * i) + 32]), _mm_shuffle_epi8(v, e2));
+	}
+
+	expand_scalar(&(src[i]), &(rgb[3 * i]), n - i);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("avx2")))
+static void threshold_avx2(lane_color_t *values, size_t n, uint8_t lower, uint8_t upper, uint8_t new, bool inside) {
+	const __m256i lo = _mm256_set1_epi8(lower),
+		      hi = _mm256_set1_epi8(upper),
+		      nv = _mm256_set1_epi8(new);
+	__m256i v, within;
+	size_t i;
+
+	for (i = 0; i + 32 <= n; i += 32) {
+		v = _mm256_loadu_si256((const __m256i *) &(values[i]));
+		within = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(v, lo), v), _mm256_cmpeq_epi8(_mm256_min_epu8(v, hi), v));
+
+		if (inside) {
+			v = _mm256_and_si256(within, nv);
+		} else {
+			v = _mm256_blendv_epi8(nv, v, within);
+		}
+
+		_mm256_storeu_si256((__m256i *) &(values[i]), v);
+	}
+
+	threshold_scalar(&(values[i]), n - i, lower, upper, new, inside);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("avx2")))
+static void add_avx2(lane_color_t *dest, const lane_color_t *src, size_t n) {
+	__m256i a, b;
+	size_t i;
+
+	for (i = 0; i + 32 <= n; i += 32) {
+		a = _mm256_loadu_si256((const __m256i *) &(dest[i]));
+		b = _mm256_loadu_si256((const __m256i *) &(src[i]));
+		_mm256_storeu_si256((__m256i *) &(dest[i]), _mm256_adds_epu8(a, b));
+	}
+
+	add_scalar(&(dest[i]), &(src[i]), n - i);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("avx2")))
+static void laplace_avx2(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *dest, size_t n) {
+	__m256i m;
+	size_t x;
+
+	// Sixteen values at a time, widened to 16 bits
+	for (x = 0; x + 16 <= n; x += 16) {
+		m = _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r1[x + 1]))), 2);
+		m = _mm256_sub_epi16(m, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r0[x + 1]))));
+		m = _mm256_sub_epi16(m, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r2[x + 1]))));
+		m = _mm256_sub_epi16(m, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r1[x]))));
+		m = _mm256_sub_epi16(m, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r1[x + 2]))));
+
+		// Packing works within each half, so put the halves back in order
+		m = _mm256_permute4x64_epi64(_mm256_packus_epi16(m, m), 0xD8);
+		_mm_storeu_si128((__m128i *) &(dest[x]), _mm256_castsi256_si128(m));
+	}
+
+	laplace_scalar(&(r0[x]), &(r1[x]), &(r2[x]), &(dest[x]), n - x);
+}
+
+/*
+ * @inheritDoc
+ */
+__attribute__((target("avx2")))
+static void sobel_avx2(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *magnitudes, uint8_t *sectors, size_t n) {
+	const __m256i zero = _mm256_setzero_si256(),
+		      one = _mm256_set1_epi32(1),
+		      tangent = _mm256_set1_epi32((int32_t) (((uint32_t) (uint16_t) -TAN_22_5 << 16) | (1 << 8))),
+		      diagonal = _mm256_set1_epi16(LANE_SOBEL_SECTOR_45),
+		      other = _mm256_set1_epi16(LANE_SOBEL_SECTOR_135),
+		      vertical = _mm256_set1_epi16(LANE_SOBEL_SECTOR_90);
+	__m256i a0, a1, a2, b0, b2, c0, c1, c2, mx, my, ax, ay, lo, hi, m, h, v, d, s;
+	size_t x;
+
+	for (x = 0; x + 16 <= n; x += 16) {
+		a0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r0[x])));
+		a1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r1[x])));
+		a2 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r2[x])));
+		b0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r0[x + 1])));
+		b2 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r2[x + 1])));
+		c0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r0[x + 2])));
+		c1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r1[x + 2])));
+		c2 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &(r2[x + 2])));
+
+		mx = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(c0, a0), _mm256_sub_epi16(c2, a2)), _mm256_slli_epi16(_mm256_sub_epi16(c1, a1), 1));
+		my = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(a0, c0), _mm256_slli_epi16(b0, 1)), _mm256_add_epi16(_mm256_add_epi16(a2, c2), _mm256_slli_epi16(b2, 1)));
+
+		// Unpacking and packing both work within each half,
+		// so the order of the values is restored by packing
+		lo = _mm256_unpacklo_epi16(mx, my);
+		hi = _mm256_unpackhi_epi16(mx, my);
+		lo = _mm256_cvttps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(lo, lo))));
+		hi = _mm256_cvttps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(hi, hi))));
+		m = _mm256_packs_epi32(lo, hi);
+		m = _mm256_permute4x64_epi64(_mm256_packus_epi16(m, m), 0xD8);
+		_mm_storeu_si128((__m128i *) &(magnitudes[x]), _mm256_castsi256_si128(m));
+
+		ax = _mm256_abs_epi16(mx);
+		ay = _mm256_abs_epi16(my);
+
+		lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(ay, ax), tangent);
+		hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(ay, ax), tangent);
+		h = _mm256_packs_epi32(_mm256_cmpgt_epi32(one, lo), _mm256_cmpgt_epi32(one, hi));
+
+		lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(ax, ay), tangent);
+		hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(ax, ay), tangent);
+		v = _mm256_packs_epi32(_mm256_cmpgt_epi32(one, lo), _mm256_cmpgt_epi32(one, hi));
+
+		d = _mm256_xor_si256(_mm256_cmpgt_epi16(mx, zero), _mm256_cmpgt_epi16(my, zero));
+
+		s = _mm256_blendv_epi8(other, diagonal, d);
+		s = _mm256_blendv_epi8(s, vertical, v);
+		s = _mm256_andnot_si256(h, s);
+		s = _mm256_permute4x64_epi64(_mm256_packus_epi16(s, s), 0xD8);
+		_mm_storeu_si128((__m128i *) &(sectors[x]), _mm256_castsi256_si128(s));
+	}
+
+	sobel_scalar(&(r0[x]), &(r1[x]), &(r2[x]), &(magnitudes[x]), &(sectors[x]), n - x);
+}
+
+#endif /* SIMD_X86 */
+
+#ifdef SIMD_NEON
+
+/*
+ * @inheritDoc
+ */
+static void gray_neon(const lane_color_t *rgb, lane_color_t *dest, size_t n) {
+	uint8x16x3_t v;
+	uint16x8_t r, g, b;
+	uint32x4_t y0, y1, y2, y3;
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		// Loading with a stride of three splits the channels
+		v = vld3q_u8(&(rgb[3 * i]));
+
+		r = vmovl_u8(vget_low_u8(v.val[0]));
+		g = vmovl_u8(vget_low_u8(v.val[1]));
+		b = vmovl_u8(vget_low_u8(v.val[2]));
+		y0 = vmlal_n_u16(vmlal_n_u16(vmull_n_u16(vget_low_u16(r), GRAY_R), vget_low_u16(g), GRAY_G), vget_low_u16(b), GRAY_B);
+		y1 = vmlal_n_u16(vmlal_n_u16(vmull_n_u16(vget_high_u16(r), GRAY_R), vget_high_u16(g), GRAY_G), vget_high_u16(b), GRAY_B);
+
+		r = vmovl_u8(vget_high_u8(v.val[0]));
+		g = vmovl_u8(vget_high_u8(v.val[1]));
+		b = vmovl_u8(vget_high_u8(v.val[2]));
+		y2 = vmlal_n_u16(vmlal_n_u16(vmull_n_u16(vget_low_u16(r), GRAY_R), vget_low_u16(g), GRAY_G), vget_low_u16(b), GRAY_B);
+		y3 = vmlal_n_u16(vmlal_n_u16(vmull_n_u16(vget_high_u16(r), GRAY_R), vget_high_u16(g), GRAY_G), vget_high_u16(b), GRAY_B);
+
+		vst1q_u8(&(dest[i]), vcombine_u8(
+			vmovn_u16(vcombine_u16(vshrn_n_u32(y0, LANE_SIMD_GRAY_SHIFT), vshrn_n_u32(y1, LANE_SIMD_GRAY_SHIFT))),
+			vmovn_u16(vcombine_u16(vshrn_n_u32(y2, LANE_SIMD_GRAY_SHIFT), vshrn_n_u32(y3, LANE_SIMD_GRAY_SHIFT)))));
+	}
+
+	gray_scalar(&(rgb[3 * i]), &(dest[i]), n - i);
+}
+
+/*
+ * @inheritDoc
+ */
+static void extract_neon(const lane_color_t *rgb, lane_color_t *dest, size_t n) {
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		vst1q_u8(&(dest[i]), vld3q_u8(&(rgb[3 * i])).val[0]);
+	}
+
+	extract_scalar(&(rgb[3 * i]), &(dest[i]), n - i);
+}
+
+/*
+ * @inheritDoc
+ */
+static void expand_neon(const lane_color_t *src, lane_color_t *rgb, size_t n) {
+	uint8x16x3_t v;
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		v.val[0] = v.val[1] = v.val[2] = vld1q_u8(&(src[i]));
+		vst3q_u8(&(rgb[3 * i]), v);
+	}
+
+	expand_scalar(&(src[i]), &(rgb[3 * i]), n - i);
+}
+
+/*
+ * @inheritDoc
+ */
+static void fill_neon(lane_color_t *rgb, size_t n, lane_pixel_t color) {
+	uint8x16x3_t v;
+	size_t i;
+
+	v.val[0] = vdupq_n_u8(color.r);
+	v.val[1] = vdupq_n_u8(color.g);
+	v.val[2] = vdupq_n_u8(color.b);
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		vst3q_u8(&(rgb[3 * i]), v);
+	}
+
+	fill_scalar(&(rgb[3 * i]), n - i, color);
+}
+
+/*
+ * @inheritDoc
+ */
+static void threshold_neon(lane_color_t *values, size_t n, uint8_t lower, uint8_t upper, uint8_t new, bool inside) {
+	const uint8x16_t lo = vdupq_n_u8(lower),
+			 hi = vdupq_n_u8(upper),
+			 nv = vdupq_n_u8(new);
+	uint8x16_t v, within;
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		v = vld1q_u8(&(values[i]));
+		within = vandq_u8(vcgeq_u8(v, lo), vcleq_u8(v, hi));
+
+		if (inside) {
+			v = vandq_u8(within, nv);
+		} else {
+			v = vbslq_u8(within, v, nv);
+		}
+
+		vst1q_u8(&(values[i]), v);
+	}
+
+	threshold_scalar(&(values[i]), n - i, lower, upper, new, inside);
+}
+
+/*
+ * @inheritDoc
+ */
+static void add_neon(lane_color_t *dest, const lane_color_t *src, size_t n) {
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		vst1q_u8(&(dest[i]), vqaddq_u8(vld1q_u8(&(dest[i])), vld1q_u8(&(src[i]))));
+	}
+
+	add_scalar(&(dest[i]), &(src[i]), n - i);
+}
+
+/*
+ * @inheritDoc
+ */
+static void laplace_neon(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *dest, size_t n) {
+	int16x8_t m;
+	size_t x;
+
+	// Eight values at a time, widened to 16 bits
+	for (x = 0; x + 8 <= n; x += 8) {
+		m = vshlq_n_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r1[x + 1])))), 2);
+		m = vsubq_s16(m, vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r0[x + 1])))));
+		m = vsubq_s16(m, vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r2[x + 1])))));
+		m = vsubq_s16(m, vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r1[x])))));
+		m = vsubq_s16(m, vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r1[x + 2])))));
+
+		// Narrowing with unsigned saturation clips to 0-255
+		vst1_u8(&(dest[x]), vqmovun_s16(m));
+	}
+
+	laplace_scalar(&(r0[x]), &(r1[x]), &(r2[x]), &(dest[x]), n - x);
+}
+
+/*
+ * @inheritDoc
+ */
+static void sobel_neon(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *magnitudes, uint8_t *sectors, size_t n) {
+	const int32x4_t limit = vdupq_n_s32(MAGNITUDE_MAX * MAGNITUDE_MAX),
+			step = vdupq_n_s32(1);
+	int16x8_t a0, a1, a2, b0, b2, c0, c1, c2, mx, my, ax, ay;
+	int32x4_t m[2], r[2];
+	float32x4_t f, e;
+	uint16x8_t h, v, d, s;
+	size_t x;
+	uint8_t i;
+
+	for (x = 0; x + 8 <= n; x += 8) {
+		a0 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r0[x]))));
+		a1 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r1[x]))));
+		a2 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r2[x]))));
+		b0 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r0[x + 1]))));
+		b2 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r2[x + 1]))));
+		c0 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r0[x + 2]))));
+		c1 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r1[x + 2]))));
+		c2 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(&(r2[x + 2]))));
+
+		mx = vaddq_s16(vaddq_s16(vsubq_s16(c0, a0), vsubq_s16(c2, a2)), vshlq_n_s16(vsubq_s16(c1, a1), 1));
+		my = vsubq_s16(vaddq_s16(vaddq_s16(a0, c0), vshlq_n_s16(b0, 1)), vaddq_s16(vaddq_s16(a2, c2), vshlq_n_s16(b2, 1)));
+
+		m[0] = vmlal_s16(vmull_s16(vget_low_s16(mx), vget_low_s16(mx)), vget_low_s16(my), vget_low_s16(my));
+		m[1] = vmlal_s16(vmull_s16(vget_high_s16(mx), vget_high_s16(mx)), vget_high_s16(my), vget_high_s16(my));
+
+		// 32-bit ARM has no vector square root, so estimate the
+		// reciprocal square root and correct the rounded result
+		for (i = 0; i < 2; ++i) {
+			m[i] = vminq_s32(m[i], limit);
+			f = vcvtq_f32_s32(m[i]);
+			e = vrsqrteq_f32(f);
+			e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(f, e), e));
+			e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(f, e), e));
+
+			// Zero gives NaN, which is converted to zero as well
+			r[i] = vcvtq_s32_f32(vmulq_f32(f, e));
+			r[i] = vaddq_s32(r[i], vreinterpretq_s32_u32(vandq_u32(vcleq_s32(vmulq_s32(vaddq_s32(r[i], step), vaddq_s32(r[i], step)), m[i]), vreinterpretq_u32_s32(step))));
+			r[i] = vsubq_s32(r[i], vreinterpretq_s32_u32(vandq_u32(vcgtq_s32(vmulq_s32(r[i], r[i]), m[i]), vreinterpretq_u32_s32(step))));
+		}
+
+		vst1_u8(&(magnitudes[x]), vqmovun_s16(vcombine_s16(vmovn_s32(r[0]), vmovn_s32(r[1]))));
+
+		ax = vabsq_s16(mx);
+		ay = vabsq_s16(my);
+
+		h = vcombine_u16(
+			vmovn_u32(vcleq_s32(vshll_n_s16(vget_low_s16(ay), 8), vmull_n_s16(vget_low_s16(ax), TAN_22_5))),
+			vmovn_u32(vcleq_s32(vshll_n_s16(vget_high_s16(ay), 8), vmull_n_s16(vget_high_s16(ax), TAN_22_5))));
+		v = vcombine_u16(
+			vmovn_u32(vcleq_s32(vshll_n_s16(vget_low_s16(ax), 8), vmull_n_s16(vget_low_s16(ay), TAN_22_5))),
+			vmovn_u32(vcleq_s32(vshll_n_s16(vget_high_s16(ax), 8), vmull_n_s16(vget_high_s16(ay), TAN_22_5))));
+		d = veorq_u16(vcgtq_s16(mx, vdupq_n_s16(0)), vcgtq_s16(my, vdupq_n_s16(0)));
+
+		// Select the sectors in reverse order of precedence
+		s = vbslq_u16(d, vdupq_n_u16(LANE_SOBEL_SECTOR_45), vdupq_n_u16(LANE_SOBEL_SECTOR_135));
+		s = vbslq_u16(v, vdupq_n_u16(LANE_SOBEL_SECTOR_90), s);
+		s = vbicq_u16(s, h);
+		vst1_u8(&(sectors[x]), vmovn_u16(s));
+	}
+
+	sobel_scalar(&(r0[x]), &(r1[x]), &(r2[x]), &(magnitudes[x]), &(sectors[x]), n - x);
+}
+
+#endif /* SIMD_NEON */
@@ -0,0 +1,157 @@
+/**
+ * @file lane_simd.h
+ * @author Matthijs Bakker
+ * @brief Vectorized kernels for the image filters
+ *
+ * This code unit provides the inner loops of the image filters,
+ * implemented with the vector instructions of the processor. The
+ * best implementation is picked when the first kernel is used,
+ * by detecting which instruction sets the processor supports.
+ */
+
+#ifndef LANE_SIMD_H
+#define LANE_SIMD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lane_image.h"
+
+/**
+ * Plain C kernels, which work on every processor.
+ */
+#define LANE_SIMD_SCALAR	(0)
+
+/**
+ * Kernels using SSE2, which every x86-64 processor has.
+ */
+#define LANE_SIMD_SSE2		(1)
+
+/**
+ * Kernels using SSSE3, which adds the byte shuffles
+ * that are needed to split RGB pixels efficiently.
+ */
+#define LANE_SIMD_SSSE3		(2)
+
+/**
+ * Kernels using AVX2, which doubles the vector width.
+ */
+#define LANE_SIMD_AVX2		(3)
+
+/**
+ * Kernels using NEON, for the ARM cores of the Zynq. These are
+ * selected at compile time, because the compiler only enables
+ * them when NEON can be used (-mfpu=neon on 32-bit ARM).
+ */
+#define LANE_SIMD_NEON		(4)
+
+/**
+ * Amount of fractional bits of the grayscale weights.
+ */
+#define LANE_SIMD_GRAY_SHIFT	(15)
+
+/**
+ * Gets the kernels that are being used.
+ *
+ * @return		One of the LANE_SIMD_* levels
+ */
+uint8_t lane_simd_level(void);
+
+/**
+ * @brief Use the kernels of a specific level
+ *
+ * Use the kernels of a lower level than the detected one, for
+ * example to compare their results or speed. This is not thread
+ * safe, so it should be done before the filters are used.
+ *
+ * @param level		One of the LANE_SIMD_* levels
+ * @return		Zero if the operation succeeds, or an error
+ * 			code if the processor does not support the level
+ */
+int lane_simd_set_level(uint8_t level);
+
+/**
+ * Converts RGB pixels to their gray value, using the BT.601-7
+ * weights of lane_grayscale_apply in fixed-point.
+ *
+ * @param rgb		The color channels of the pixels
+ * @param dest		Output for one value per pixel
+ * @param n		The amount of pixels
+ */
+void lane_simd_gray(const lane_color_t *rgb, lane_color_t *dest, size_t n);
+
+/**
+ * Copies the red channel of RGB pixels, which holds
+ * the value of every pixel of a grayscale image.
+ *
+ * @param rgb		The color channels of the pixels
+ * @param dest		Output for one value per pixel
+ * @param n		The amount of pixels
+ */
+void lane_simd_extract(const lane_color_t *rgb, lane_color_t *dest, size_t n);
+
+/**
+ * Copies gray values into all color channels of RGB pixels.
+ *
+ * @param src		One value per pixel
+ * @param rgb		Output for the color channels of the pixels
+ * @param n		The amount of pixels
+ */
+void lane_simd_expand(const lane_color_t *src, lane_color_t *rgb, size_t n);
+
+/**
+ * Sets RGB pixels to a color.
+ *
+ * @param rgb		The color channels of the pixels
+ * @param n		The amount of pixels
+ * @param color		The color that will be set for each pixel
+ */
+void lane_simd_fill(lane_color_t *rgb, size_t n, lane_pixel_t color);
+
+/**
+ * Thresholds values like lane_threshold_apply does with pixels.
+ *
+ * @param values	The values, which will be modified
+ * @param n		The amount of values
+ * @param lower		The inclusive lower bound of the threshold
+ * @param upper		The inclusive upper bound of the threshold
+ * @param new		The replacement value
+ * @param inside	Replace inside or outside the range
+ */
+void lane_simd_threshold(lane_color_t *values, size_t n, uint8_t lower, uint8_t upper, uint8_t new, bool inside);
+
+/**
+ * Adds values to others, saturating at 255.
+ *
+ * @param dest		The values that will be added upon
+ * @param src		The values that will be added
+ * @param n		The amount of values
+ */
+void lane_simd_add(lane_color_t *dest, const lane_color_t *src, size_t n);
+
+/**
+ * Convolves the Laplacian kernel with a row, clipping to 0-255.
+ *
+ * @param r0		The row above, with n+2 values
+ * @param r1		The row itself, with n+2 values
+ * @param r2		The row below, with n+2 values
+ * @param dest		Output for the n values of the inner columns
+ * @param n		The amount of values to compute
+ */
+void lane_simd_laplace(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *dest, size_t n);
+
+/**
+ * Convolves the Sobel kernels with a row, like lane_sobel_apply_sectors.
+ *
+ * @param r0		The row above, with n+2 values
+ * @param r1		The row itself, with n+2 values
+ * @param r2		The row below, with n+2 values
+ * @param magnitudes	Output for the n magnitudes of the inner
+ * 			columns, clipped to 0-255
+ * @param sectors	Output for the n LANE_SOBEL_SECTOR_* codes
+ * @param n		The amount of values to compute
+ */
+void lane_simd_sobel(const lane_color_t *r0, const lane_color_t *r1, const lane_color_t *r2, lane_color_t *magnitudes, uint8_t *sectors, size_t n);
+
+#endif /* LANE_SIMD_H */
@@ -6,13 +6,19 @@
  * This code unit provides a Sobel filter which convolutes
  * two predefined 3x3 kernels with an image and calculates
  * the gradient magnitude for each pixel.
+ *
+ * The other stages of the Canny edge detector are also
+ * provided, both separately and fused into one operator.
  */
 
 #include "lane_sobel.h"
 
 #include <math.h>
+#include <string.h>
 
+#include "lane_gaussian.h"
 #include "lane_log.h"
+#include "lane_simd.h"
 
 /**
  * @internal
@@ -31,9 +37,60 @@
 /**
  * @internal
  *
- * Converts degrees to radians.
+ * The tangent of 22.5 degrees in 8-bit fixed-point, which is the
+ * border between a straight and a diagonal sector
+ */
+#define TAN_22_5		(106)
+
+/**
+ * @internal
+ *
+ * The largest magnitude that fits in a color channel
+ */
+#define MAGNITUDE_MAX		(255)
+
+/**
+ * @internal
+ *
+ * Label of a pixel that hysteresis leaves untouched
+ */
+#define LABEL_KEEP		(0)
+
+/**
+ * @internal
+ *
+ * Label of a pixel that is discarded by hysteresis
+ */
+#define LABEL_DISCARD		(1)
+
+/**
+ * @internal
+ *
+ * Label of a weak edge pixel that has not been reached yet
+ */
+#define LABEL_WEAK		(2)
+
+/**
+ * @internal
+ *
+ * Label of a strong edge pixel, or a weak one that is connected to it
+ */
+#define LABEL_STRONG		(3)
+
+/**
+ * @internal
+ *
+ * Amount of fractional bits that are kept between the passes of the
+ * blur in lane_canny_apply, the same as in lane_gaussian_apply
  */
-#define RADIANS(degrees)	(degrees * M_PI / 180L)
+#define BLUR_SHIFT		(8)
+
+/**
+ * @internal
+ *
+ * Amount of rows that the Sobel and non-maximum stages look at
+ */
+#define LINES			(KERNEL_DIAMETER)
 
 /**
  * @internal
@@ -57,120 +114,491 @@ const int ky[KERNEL_DIAMETER][KERNEL_DIAMETER] = {
 	{-1, -2, -1},
 };
 
+/**
+ * @internal
+ *
+ * Finds the sector of a gradient that was computed with kx and ky.
+ *
+ * @param mx		The response of the horizontal kernel
+ * @param my		The response of the vertical kernel
+ * @return		One of the LANE_SOBEL_SECTOR_* codes
+ */
+static inline uint8_t sector(int mx, int my);
+
+/**
+ * @internal
+ *
+ * Keeps the pixels that are larger than both neighbours in
+ * the direction of their gradient.
+ *
+ * @param src		The input image with edge values
+ * @param sectors	The gradient sector of each pixel, or NULL
+ * 			to derive them from the directions
+ * @param directions	The gradient direction of each pixel, or NULL
+ * 			to use the angle of the sectors in the list
+ * @param dest		Where the output image should be placed
+ * @param edges		If not NULL, the remaining edge pixels
+ */
+static void suppress(const lane_image_t *const src, const uint8_t *const sectors, const double *const directions, lane_image_t **dest, lane_edge_list_t *edges);
+
+/**
+ * @internal
+ *
+ * Promotes all weak pixels that are connected to a strong pixel
+ * through other weak pixels, in time linear to the image size.<br />
+ * <br />
+ * The pixels are labelled in one pass, after which the strong ones
+ * are pushed on a stack. Every weak neighbour that is popped from it
+ * is relabelled before being pushed, so no pixel is visited twice.
+ *
+ * @param image		The image with edge values
+ * @param labels	The LABEL_* of each possible pixel value
+ * @param strong	The value of the pixels that are kept
+ * @param edges		If not NULL, the kept pixels are also stored here
+ */
+static void track(lane_image_t *image, const uint8_t labels[256], uint8_t strong, lane_edge_list_t *edges);
+
 /*
  * @inheritDoc
  */
 void lane_sobel_apply(const lane_image_t *const src, lane_image_t **magnitudes, double **directions) {
 	lane_image_t *outm;
 	double *outd;
-	int x, y, mx, my, m, i, j, si, ci;
+	uint8_t *rows, *line, *sectors;
+	const uint8_t *r0, *r1, *r2;
+	int x, y, mx, my;
 
 	// Because the kernel cannot be convoluted with the 1 pixel
 	// border of the input image (there are no neighbor pixels)
 	// we have to cut off a part of the image and correct for it.
 	outm = lane_image_new(src->width - KERNEL_RADIUS * 2, src->height - KERNEL_RADIUS * 2);
-	outd = calloc(outm->width * outm->height, sizeof(double));
+	outd = outm ? calloc(outm->width * outm->height, sizeof(double)) : NULL;
 
-	if (!outm || !outd) {
+	// The last three rows of the input, as gray values, like
+	// in lane_sobel_apply_sectors, whose sectors are not needed
+	rows = malloc(LINES * src->width * sizeof(uint8_t));
+	line = outm ? malloc(outm->width * sizeof(uint8_t)) : NULL;
+	sectors = outm ? malloc(outm->width * sizeof(uint8_t)) : NULL;
+
+	if (!outm || !outm->data || !outd || !rows || !line || !sectors) {
 		LANE_LOG_ERROR("Unable to initialize memory");
+
+		if (outm) {
+			lane_image_free(outm);
+		}
+
+		free(outd);
+		free(rows);
+		free(line);
+		free(sectors);
+
+		(*magnitudes) = NULL;
+		(*directions) = NULL;
+
 		return;
 	}
 
-	// For each pixel
+	for (y = 0; y < src->height; ++y) {
+		lane_simd_extract(&(src->data[y * src->width].r), &(rows[(y % LINES) * src->width]), src->width);
+
+		if (y < LINES - 1) {
+			continue;
+		}
+
+		// The rows above, at and below the pixels of this output row
+		r0 = &(rows[((y - 2) % LINES) * src->width]);
+		r1 = &(rows[((y - 1) % LINES) * src->width]);
+		r2 = &(rows[(y % LINES) * src->width]);
+
+		// The magnitudes are clipped to 0-255 by the kernel
+		lane_simd_sobel(r0, r1, r2, line, sectors, outm->width);
+		lane_simd_expand(line, &(outm->data[(y - 2) * outm->width].r), outm->width);
+
+		// The directions need the responses of kx and ky themselves,
+		// and the arc tangent of them stays in double precision
+		for (x = 0; x < outm->width; ++x) {
+			mx = (r0[x + 2] - r0[x]) + 2 * (r1[x + 2] - r1[x]) + (r2[x + 2] - r2[x]);
+			my = (r0[x] + 2 * r0[x + 1] + r0[x + 2]) - (r2[x] + 2 * r2[x + 1] + r2[x + 2]);
+
+			outd[((y - 2) * outm->width) + x] = atan2(mx, my);
+		}
+	}
+
+	free(rows);
+	free(line);
+	free(sectors);
+
+	(*magnitudes) = outm;
+	(*directions) = outd;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_sobel_apply_sectors(const lane_image_t *const src, lane_image_t **magnitudes, uint8_t **sectors) {
+	lane_image_t *outm;
+	uint8_t *outs, *rows, *line;
+	int y;
+
+	outm = lane_image_new(src->width - KERNEL_RADIUS * 2, src->height - KERNEL_RADIUS * 2);
+	outs = outm ? malloc(outm->width * outm->height * sizeof(uint8_t)) : NULL;
+
+	// The last three rows of the input, as gray values
+	rows = malloc(LINES * src->width * sizeof(uint8_t));
+	line = outm ? malloc(outm->width * sizeof(uint8_t)) : NULL;
+
+	if (!outm || !outm->data || !outs || !rows || !line) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+
+		if (outm) {
+			lane_image_free(outm);
+		}
+
+		free(outs);
+		free(rows);
+		free(line);
+
+		(*magnitudes) = NULL;
+		(*sectors) = NULL;
+
+		return;
+	}
+
+	for (y = 0; y < src->height; ++y) {
+		lane_simd_extract(&(src->data[y * src->width].r), &(rows[(y % LINES) * src->width]), src->width);
+
+		if (y < LINES - 1) {
+			continue;
+		}
+
+		// The rows above, at and below the pixels of this output row
+		lane_simd_sobel(&(rows[((y - 2) % LINES) * src->width]),
+				&(rows[((y - 1) % LINES) * src->width]),
+				&(rows[(y % LINES) * src->width]),
+				line, &(outs[(y - 2) * outm->width]), outm->width);
+
+		lane_simd_expand(line, &(outm->data[(y - 2) * outm->width].r), outm->width);
+	}
+
+	free(rows);
+	free(line);
+
+	(*magnitudes) = outm;
+	(*sectors) = outs;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_sobel_apply_plane(const lane_plane_t *const src, lane_plane_t **magnitudes, lane_plane_t **gx, lane_plane_t **gy) {
+	const uint8_t *r0, *r1, *r2;
+	lane_plane_t *outm, *outx = NULL, *outy = NULL;
+	uint16_t *m;
+	int16_t *ox = NULL, *oy = NULL;
+	int x, y, mx, my;
+
+	if (src->type != LANE_PLANE_U8) {
+		LANE_LOG_ERROR("Only planes of type LANE_PLANE_U8 are supported; aborting");
+		return 1;
+	}
+
+	outm = lane_plane_new(src->width - KERNEL_RADIUS * 2, src->height - KERNEL_RADIUS * 2, LANE_PLANE_U16);
+	outx = gx ? lane_plane_new(outm ? outm->width : 0, outm ? outm->height : 0, LANE_PLANE_S16) : NULL;
+	outy = gy ? lane_plane_new(outm ? outm->width : 0, outm ? outm->height : 0, LANE_PLANE_S16) : NULL;
+
+	if (!outm || (gx && !outx) || (gy && !outy)) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+
+		if (outm) lane_plane_free(outm);
+		if (outx) lane_plane_free(outx);
+		if (outy) lane_plane_free(outy);
+
+		return 2;
+	}
+
 	for (y = KERNEL_RADIUS; y < src->height - KERNEL_RADIUS; ++y) {
+		r0 = LANE_PLANE_ROW(src, uint8_t, y - 1);
+		r1 = LANE_PLANE_ROW(src, uint8_t, y);
+		r2 = LANE_PLANE_ROW(src, uint8_t, y + 1);
+		m = LANE_PLANE_ROW(outm, uint16_t, y - KERNEL_RADIUS);
+
+		if (outx) ox = LANE_PLANE_ROW(outx, int16_t, y - KERNEL_RADIUS);
+		if (outy) oy = LANE_PLANE_ROW(outy, int16_t, y - KERNEL_RADIUS);
+
 		for (x = KERNEL_RADIUS; x < src->width - KERNEL_RADIUS; ++x) {
-			mx = my = 0;
-			
-			// Convolve kernels with the original image to get
-			// the horizontal and vertical magnitudes (mx, my)
-			for (i = 0; i < KERNEL_DIAMETER; ++i) {
-				for (j = 0; j < KERNEL_DIAMETER; ++j) {
-					si = (y - KERNEL_RADIUS + i) * src->width + x - KERNEL_RADIUS + j;
-					mx += src->data[si].r * kx[i][j];
-					my += src->data[si].r * ky[i][j];
-				}
+			mx = (r0[x + 1] - r0[x - 1]) + 2 * (r1[x + 1] - r1[x - 1]) + (r2[x + 1] - r2[x - 1]);
+			my = (r0[x - 1] + 2 * r0[x] + r0[x + 1]) - (r2[x - 1] + 2 * r2[x] + r2[x + 1]);
+
+			// At most 1020 * sqrt(2), which fits without clipping
+			m[x - KERNEL_RADIUS] = sqrtf((mx * mx) + (my * my));
+
+			if (ox) ox[x - KERNEL_RADIUS] = mx;
+			if (oy) oy[x - KERNEL_RADIUS] = my;
+		}
+	}
+
+	(*magnitudes) = outm;
+
+	if (gx) (*gx) = outx;
+	if (gy) (*gy) = outy;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_nonmax_apply(const lane_image_t *const src, const double *const directions, lane_image_t **dest, lane_edge_list_t *edges) {
+	suppress(src, NULL, directions, dest, edges);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_nonmax_apply_sectors(const lane_image_t *const src, const uint8_t *const sectors, lane_image_t **dest, lane_edge_list_t *edges) {
+	suppress(src, sectors, NULL, dest, edges);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_hysteresis_apply(lane_image_t *image, uint8_t weak, uint8_t strong, lane_edge_list_t *edges) {
+	uint8_t labels[256] = { LABEL_KEEP };
+
+	labels[weak] = LABEL_WEAK;
+	labels[strong] = LABEL_STRONG;
+
+	track(image, labels, strong, edges);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_hysteresis_apply_thresholds(lane_image_t *image, uint8_t low, uint8_t high, lane_edge_list_t *edges) {
+	uint8_t labels[256];
+	int v;
+
+	for (v = 0; v < 256; ++v) {
+		labels[v] = v >= high ? LABEL_STRONG : (v >= low ? LABEL_WEAK : LABEL_DISCARD);
+	}
+
+	track(image, labels, MAGNITUDE_MAX, edges);
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_canny_apply(const lane_image_t *const src, lane_image_t **dest, uint8_t size, double variance, uint8_t low, uint8_t high, lane_edge_list_t *edges) {
+	const uint8_t *b0, *b1, *b2, *m0, *m1, *m2, *s1;
+	lane_image_t *out;
+	uint16_t *weights, *rows, *h;
+	uint32_t *sums;
+	uint8_t *line, *blurred, *magnitudes, *sectors, *b, v, p, n;
+	int x, y, yb, ys, yn, i, c, radius, ir, width, height;
+
+	// Column offsets of the neighbours in the rows above and
+	// below for each sector, the straight one is handled apart
+	const int dx[4] = {
+		[LANE_SOBEL_SECTOR_0] = 0,
+		[LANE_SOBEL_SECTOR_45] = 1,
+		[LANE_SOBEL_SECTOR_90] = 0,
+		[LANE_SOBEL_SECTOR_135] = -1
+	};
+
+	radius = (size - 1) / 2;
+	ir = radius + 1;
+
+	// The size of the blurred image, which is cropped
+	// by another pixel by each of the next two stages
+	width = src->width - (2 * ir);
+	height = src->height - (2 * ir);
+
+	if (size % 2 == 0 || width <= 2 * LINES - 2 || height <= 2 * LINES - 2) {
+		LANE_LOG_ERROR("The kernel size must be odd and smaller than the image");
+		(*dest) = NULL;
+
+		return;
+	}
+
+	out = lane_image_new(width - 4 * KERNEL_RADIUS, height - 4 * KERNEL_RADIUS);
+
+	// Only the last few rows of each stage are kept
+	weights = malloc(size * sizeof(uint16_t));
+	rows = malloc(size * width * sizeof(uint16_t));
+	sums = malloc(width * sizeof(uint32_t));
+	line = malloc(src->width * sizeof(uint8_t));
+	blurred = malloc(LINES * width * sizeof(uint8_t));
+	magnitudes = malloc(LINES * (width - 2) * sizeof(uint8_t));
+	sectors = malloc(LINES * (width - 2) * sizeof(uint8_t));
+
+	if (!out || !weights || !rows || !sums || !line || !blurred || !magnitudes || !sectors) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+
+		lane_image_free(out);
+		out = NULL;
+
+		goto cleanup;
+	}
+
+	lane_gaussian_weights(size, variance, weights);
+
+	for (y = 0; y < src->height; ++y) {
+		lane_simd_extract(&(src->data[y * src->width].r), line, src->width);
+
+		// Horizontal pass of the blur, the same as lane_gaussian_apply
+		memset(sums, 0, width * sizeof(uint32_t));
+
+		for (i = 0; i < size; ++i) {
+			for (x = 0; x < width; ++x) {
+				sums[x] += weights[i] * line[1 + i + x];
 			}
+		}
+
+		h = &(rows[(y % size) * width]);
+
+		for (x = 0; x < width; ++x) {
+			h[x] = (sums[x] + (1 << (LANE_GAUSSIAN_WEIGHT_SHIFT - BLUR_SHIFT - 1))) >> (LANE_GAUSSIAN_WEIGHT_SHIFT - BLUR_SHIFT);
+		}
+
+		// Vertical pass, once all rows under the kernel are there
+		yb = y - (2 * radius) - 1;
 
-			// Calculate the gradient magnitude
-			m = sqrt(pow(mx, 2) + pow(my, 2));
+		if (yb < 0 || yb >= height) {
+			continue;
+		}
 
-			// Restrict the gradient magnitude within bounds
-			//
-			// TODO we could calculate the max using:
-			//      sqrt(pow(4*255-4*0, 2)*2)
-			//      and divide m by that.
-			//
-			if (m < 0) m = 0;
-			if (m > 255) m = 255;
-	
-			// Calculate the corrected index of the target image
-			// (this takes into consideration the cropping)
-			ci = ((y - KERNEL_RADIUS) * outm->width) + (x - KERNEL_RADIUS);
+		memset(sums, 0, width * sizeof(uint32_t));
 
-			// Calculate the arc tangent
-			outd[ci] = atan2(mx, my);
+		for (i = 0; i < size; ++i) {
+			h = &(rows[((yb + 1 + i) % size) * width]);
 
-			// Update the output pixel
-        		outm->data[ci].r = m;
-        		outm->data[ci].g = m;
-        		outm->data[ci].b = m;
+			for (x = 0; x < width; ++x) {
+				sums[x] += weights[i] * h[x];
+			}
+		}
+
+		b = &(blurred[(yb % LINES) * width]);
+
+		for (x = 0; x < width; ++x) {
+			b[x] = (sums[x] + (1 << (LANE_GAUSSIAN_WEIGHT_SHIFT + BLUR_SHIFT - 1))) >> (LANE_GAUSSIAN_WEIGHT_SHIFT + BLUR_SHIFT);
+		}
+
+		// Gradients of the row in the middle of the last three
+		ys = yb - (LINES - 1);
+
+		if (ys < 0) {
+			continue;
+		}
+
+		b0 = &(blurred[(ys % LINES) * width]);
+		b1 = &(blurred[((ys + 1) % LINES) * width]);
+		b2 = &(blurred[((ys + 2) % LINES) * width]);
+		i = (ys % LINES) * (width - 2);
+
+		lane_simd_sobel(b0, b1, b2, &(magnitudes[i]), &(sectors[i]), width - 2);
+
+		// Non-maximum suppression of the row in the middle
+		yn = ys - (LINES - 1);
+
+		if (yn < 0) {
+			continue;
+		}
+
+		m0 = &(magnitudes[(yn % LINES) * (width - 2)]);
+		m1 = &(magnitudes[((yn + 1) % LINES) * (width - 2)]);
+		m2 = &(magnitudes[((yn + 2) % LINES) * (width - 2)]);
+		s1 = &(sectors[((yn + 1) % LINES) * (width - 2)]);
+
+		for (x = 0; x < out->width; ++x) {
+			c = x + 1;
+
+			if (s1[c] == LANE_SOBEL_SECTOR_0) {
+				p = m1[c - 1];
+				n = m1[c + 1];
+			} else {
+				p = m0[c - dx[s1[c]]];
+				n = m2[c + dx[s1[c]]];
+			}
+
+			v = (m1[c] > p && m1[c] > n) ? m1[c] : 0;
+
+			out->data[(yn * out->width) + x].r = v;
+			out->data[(yn * out->width) + x].g = v;
+			out->data[(yn * out->width) + x].b = v;
 		}
 	}
 
-	(*magnitudes) = outm;
-	(*directions) = outd;
+	// Edges can be connected across the whole image,
+	// so only this stage needs the complete frame
+	lane_hysteresis_apply_thresholds(out, low, high, edges);
+
+cleanup:
+	free(weights);
+	free(rows);
+	free(sums);
+	free(line);
+	free(blurred);
+	free(magnitudes);
+	free(sectors);
+
+	(*dest) = out;
 }
 
 /*
  * @inheritDoc
  */
-void lane_nonmax_apply(const lane_image_t *const src, const double *const directions, lane_image_t **dest) {
+static inline uint8_t sector(int mx, int my) {
+	int ax = abs(mx),
+	    ay = abs(my);
+
+	// The gradient in image coordinates (with y pointing
+	// down) is (mx, -my), since ky subtracts the bottom row
+	if ((ay << 8) <= ax * TAN_22_5) {
+		return LANE_SOBEL_SECTOR_0;
+	}
+
+	if ((ax << 8) <= ay * TAN_22_5) {
+		return LANE_SOBEL_SECTOR_90;
+	}
+
+	return (mx > 0) != (my > 0) ? LANE_SOBEL_SECTOR_45 : LANE_SOBEL_SECTOR_135;
+}
+
+/*
+ * @inheritDoc
+ */
+static void suppress(const lane_image_t *const src, const uint8_t *const sectors, const double *const directions, lane_image_t **dest, lane_edge_list_t *edges) {
 	lane_image_t *out;
 	// {si,ci,pi,ni} = {source,current,prev,next} index
 	int x, y, si, ci, pi, ni;
-	uint16_t d;
+	uint8_t s;
+
+	// Offsets of the neighbours along the gradient of each sector
+	const int offsets[4] = {
+		[LANE_SOBEL_SECTOR_0] = 1,
+		[LANE_SOBEL_SECTOR_45] = src->width + 1,
+		[LANE_SOBEL_SECTOR_90] = src->width,
+		[LANE_SOBEL_SECTOR_135] = src->width - 1
+	};
 
 	out = lane_image_new(src->width - KERNEL_RADIUS * 2, src->height - KERNEL_RADIUS * 2);
 
+	if (edges) {
+		lane_edge_list_clear(edges, out->width, out->height);
+	}
+
 	// For each pixel
 	for (y = KERNEL_RADIUS; y < src->height - KERNEL_RADIUS; ++y) {
 		for (x = KERNEL_RADIUS; x < src->width - KERNEL_RADIUS; ++x) {
 			// Calculate the correct index for the input {image,directions} array
 			si = y * src->width + x;
 
-			d = RADIANS(directions[si]);
-			if (d < 0L) {
-				d += 180L;
-			}
-
-			if (d > 181L) {
-				LANE_LOG_ERROR("Je bent slecht in wiskunde");
-			}
+			// The directions are atan2(mx, my), so the sine and
+			// cosine are proportional to the kernel responses
+			s = sectors ? sectors[si] : sector(lround(sin(directions[si]) * MAGNITUDE_MAX), lround(cos(directions[si]) * MAGNITUDE_MAX));
 
-			// Check which direction the line faces
-			// Northeast (45 deg) or east (90 deg) facing
-			if (d > 22 && d < 113) {
-				// Check for southeast (45+(90-45)/2≃68)
-				if (d < 68) {
-					pi = (y - 1) * src->width + (x + 1);
-					ni = (y + 1) * src->width + (x - 1);
-				// Else, it faces east
-				} else {
-					pi = (y - 0) * src->width + (x + 1);
-					ni = (y - 0) * src->width + (x - 1);
-				}
-			// Southeast (135 deg) or north (0 deg) facing
-			} else {
-				// Check for southeast
-				if (d > 112 && d < 158) {
-					pi = (y - 1) * src->width + (x - 1);
-					ni = (y + 1) * src->width + (x + 1);
-				// Else, it faces north
-				} else {
-					pi = (y - 1) * src->width + (x - 0);
-					ni = (y + 1) * src->width + (x - 0);
-				}
-			}
+			pi = si - offsets[s];
+			ni = si + offsets[s];
 
 			// Calculate the corrected index for the output
 			ci = ((y - KERNEL_RADIUS) * out->width) + (x - KERNEL_RADIUS);
@@ -179,6 +607,11 @@ void lane_nonmax_apply(const lane_image_t *const src, const double *const direct
 				out->data[ci].r = src->data[si].r;
 				out->data[ci].g = src->data[si].g;
 				out->data[ci].b = src->data[si].b;
+
+				if (edges) {
+					lane_edge_list_push(edges, x - KERNEL_RADIUS, y - KERNEL_RADIUS,
+							directions ? lane_edge_theta(directions[si]) : s * 45, src->data[si].r);
+				}
 			} else {
 				out->data[ci].r = out->data[ci].g = out->data[ci].b = 0;
 			}
@@ -191,40 +624,77 @@ void lane_nonmax_apply(const lane_image_t *const src, const double *const direct
 /*
  * @inheritDoc
  */
-// Note that we do not discard edge pixels because strong edge pixels
-// are totally valid in this case.
-void lane_hysteresis_apply(lane_image_t *image, uint8_t weak, uint8_t strong) {
-	int x, y, i, j, k, ki;
-
-	for (y = KERNEL_RADIUS; y < image->height - KERNEL_RADIUS; ++y) {
-		for (x = KERNEL_RADIUS; x < image->width - KERNEL_RADIUS; ++x) {
-			i = (y * image->width) + x;
-
-			if (image->data[i].r == weak) {
-				// Check for strong pixels in a 3 by 3 region
-				for (j = 0; j < KERNEL_DIAMETER; ++j) {
-					for (k = 0; k < KERNEL_DIAMETER; ++k) {
-						// Relative index to the kernel element
-						ki = (y - KERNEL_RADIUS + j) * image->width + x - KERNEL_RADIUS + k;
-
-						// Skip the middle element
-						if (ki == i) continue;
-
-						// Detected a strong pixel, so the current edge is valid
-						if (image->data[ki].r == strong) {
-							image->data[i].r = image->data[i].g = image->data[i].b = strong;
-							goto next;
-						}
-					}
-				}
+static void track(lane_image_t *image, const uint8_t labels[256], uint8_t strong, lane_edge_list_t *edges) {
+	// The labels have a border of one pixel that is never
+	// an edge, so the neighbours need no bounds checks
+	const int stride = image->width + 2;
+	const int neighbours[8] = {
+		-stride - 1, -stride, -stride + 1,
+		-1, 1,
+		stride - 1, stride, stride + 1
+	};
+	uint8_t *marks;
+	uint32_t *stack;
+	size_t top = 0;
+	int x, y, i, li, ni, k;
+
+	marks = calloc(stride * (image->height + 2), sizeof(uint8_t));
+	stack = malloc(image->width * image->height * sizeof(uint32_t));
+
+	if (!marks || !stack) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		free(marks);
+		free(stack);
+		return;
+	}
 
-				// Current edge is invalid
-				image->data[i].r = image->data[i].g = image->data[i].b = 0;
+	for (y = 0; y < image->height; ++y) {
+		for (x = 0; x < image->width; ++x) {
+			li = (y + 1) * stride + x + 1;
+			marks[li] = labels[image->data[y * image->width + x].r];
+
+			if (marks[li] == LABEL_STRONG) {
+				stack[top++] = li;
+			}
+		}
+	}
 
-next:				({(void)0;});
+	// Every pixel is pushed at most once, because it is
+	// labelled as strong before it goes on the stack
+	while (top) {
+		li = stack[--top];
 
+		for (k = 0; k < 8; ++k) {
+			ni = li + neighbours[k];
+
+			if (marks[ni] == LABEL_WEAK) {
+				marks[ni] = LABEL_STRONG;
+				stack[top++] = ni;
 			}
 		}
 	}
-}
 
+	if (edges) {
+		lane_edge_list_clear(edges, image->width, image->height);
+	}
+
+	for (y = 0; y < image->height; ++y) {
+		for (x = 0; x < image->width; ++x) {
+			i = y * image->width + x;
+			li = (y + 1) * stride + x + 1;
+
+			if (marks[li] == LABEL_STRONG) {
+				image->data[i].r = image->data[i].g = image->data[i].b = strong;
+
+				if (edges) {
+					lane_edge_list_push(edges, x, y, LANE_EDGE_NO_DIRECTION, strong);
+				}
+			} else if (marks[li] != LABEL_KEEP) {
+				image->data[i].r = image->data[i].g = image->data[i].b = 0;
+			}
+		}
+	}
+
+	free(marks);
+	free(stack);
+}
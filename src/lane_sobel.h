@@ -13,7 +13,33 @@
 
 #include <stdbool.h>
 
+#include "lane_edge.h"
 #include "lane_image.h"
+#include "lane_plane.h"
+
+/**
+ * Gradient sector of a pixel whose gradient points along the x axis.<br />
+ * <br />
+ * The sectors are the normal of the edge, rounded to 45 degrees,
+ * in the same convention as the theta of the Hough transform. So
+ * the sector times 45 is the angle in degrees.
+ */
+#define LANE_SOBEL_SECTOR_0	(0)
+
+/**
+ * Gradient sector of a pixel whose gradient points down and to the right.
+ */
+#define LANE_SOBEL_SECTOR_45	(1)
+
+/**
+ * Gradient sector of a pixel whose gradient points along the y axis.
+ */
+#define LANE_SOBEL_SECTOR_90	(2)
+
+/**
+ * Gradient sector of a pixel whose gradient points down and to the left.
+ */
+#define LANE_SOBEL_SECTOR_135	(3)
 
 /**
  * @brief Highlight edges within an image using the Sobel operator
@@ -35,6 +61,42 @@
  */
 void lane_sobel_apply(const lane_image_t *const src, lane_image_t **magnitudes, double **directions);
 
+/**
+ * @brief Highlight edges within an image using the Sobel operator, with coarse directions
+ *
+ * Like lane_sobel_apply, but the gradient direction of each pixel
+ * is only stored as one of the four LANE_SOBEL_SECTOR_* codes.<br />
+ * <br />
+ * The gradients are computed with integers and the sector is found
+ * by comparing them, so no trigonometry is needed. This is all the
+ * information that non-maximum suppression uses, at one byte per
+ * pixel instead of eight.<br />
+ * <br />
+ * Both outputs are set to NULL if memory cannot be allocated.
+ *
+ * @param src		The input image, which data will be read
+ * @param magnitudes	The output image, which will be (over)written to
+ * @param sectors	The gradient sectors for each pixel
+ */
+void lane_sobel_apply_sectors(const lane_image_t *const src, lane_image_t **magnitudes, uint8_t **sectors);
+
+/**
+ * @brief Highlight edges within a plane using the Sobel operator
+ *
+ * Like lane_sobel_apply, but for a LANE_PLANE_U8 plane. The
+ * magnitudes are not clipped to 0-255 and the responses of both
+ * kernels can be kept, so their signs give the direction.
+ *
+ * @param src		The input plane, which data will be read
+ * @param magnitudes	Where the LANE_PLANE_U16 magnitudes should be placed
+ * @param gx		If not NULL, where the LANE_PLANE_S16
+ * 			horizontal responses should be placed
+ * @param gy		If not NULL, where the LANE_PLANE_S16
+ * 			vertical responses should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_sobel_apply_plane(const lane_plane_t *const src, lane_plane_t **magnitudes, lane_plane_t **gx, lane_plane_t **gy);
+
 /**
  * @brief Apply non-maximum suppression
  *
@@ -52,20 +114,87 @@ void lane_sobel_apply(const lane_image_t *const src, lane_image_t **magnitudes,
  * @param directions	The gradient directions for each pixel
  * 			encoded in a row-major array
  * @param dest		Where the output image should be placed
+ * @param edges		If not NULL, the remaining edge pixels and their
+ * 			directions are also stored in this list
+ */
+void lane_nonmax_apply(const lane_image_t *const src, const double *const directions, lane_image_t **dest, lane_edge_list_t *edges);
+
+/**
+ * @brief Apply non-maximum suppression using gradient sectors
+ *
+ * Like lane_nonmax_apply, but with the sectors that are produced by
+ * lane_sobel_apply_sectors.<br />
+ * <br />
+ * The edge pixels in the list get the angle of their sector, so a
+ * Hough window around it should be at least 23 degrees wide.
+ *
+ * @param src		The input image with edge values
+ * @param sectors	The gradient sectors for each pixel
+ * 			encoded in a row-major array
+ * @param dest		Where the output image should be placed
+ * @param edges		If not NULL, the remaining edge pixels and their
+ * 			directions are also stored in this list
  */
-void lane_nonmax_apply(const lane_image_t *const src, const double *const directions, lane_image_t **dest);
+void lane_nonmax_apply_sectors(const lane_image_t *const src, const uint8_t *const sectors, lane_image_t **dest, lane_edge_list_t *edges);
 
 /**
  * @brief Apply edge tracking by hysteresis
  *
  * Track if weak edges are connected to strong edges.<br />
  * <br />
- * If they are not connected, they will be discarded.
+ * If they are not connected, they will be discarded. A weak edge
+ * may be connected through a chain of other weak edges of any
+ * length. Pixels with other values are left as they are.
  *
  * @param image		The input image with weak and strong edges
  * @param weak		The value of weak edges
  * @param strong	The value of strong edges
+ * @param edges		If not NULL, the resulting strong edge pixels
+ * 			are also stored in this list
+ */
+void lane_hysteresis_apply(lane_image_t *image, uint8_t weak, uint8_t strong, lane_edge_list_t *edges);
+
+/**
+ * @brief Apply edge tracking by hysteresis on raw edge values
+ *
+ * Pixels from the high threshold upwards are strong edges and
+ * pixels from the low threshold upwards are weak edges. This saves
+ * thresholding the image into weak and strong values first.<br />
+ * <br />
+ * The strong edges and all weak edges that are connected to them
+ * become white and everything else becomes black.
+ *
+ * @param image		The input image with edge values
+ * @param low		The lowest value of a weak edge
+ * @param high		The lowest value of a strong edge
+ * @param edges		If not NULL, the resulting edge pixels
+ * 			are also stored in this list
+ */
+void lane_hysteresis_apply_thresholds(lane_image_t *image, uint8_t low, uint8_t high, lane_edge_list_t *edges);
+
+/**
+ * @brief Detect edges with the Canny edge detector
+ *
+ * Blur the image with lane_gaussian_apply_gray, apply the Sobel
+ * operator with sectors, suppress non-maximum pixels and track the
+ * edges by hysteresis, all in one operator.<br />
+ * <br />
+ * Instead of storing each stage as an image, the rows stream through
+ * a few line buffers per stage, the same way as the dataflow of the
+ * accelerator. Only hysteresis works on the output image, because
+ * edges may be connected anywhere within it. The result equals
+ * applying the separate stages, so the output is cropped by
+ * <i>(size-1)/2+3</i> px on each side.
+ *
+ * @param src		The grayscale input image, which data will be read
+ * @param dest		The output image, which will be (over)written to
+ * @param size		The size of the Gaussian kernel, which must be odd
+ * @param variance	The sigma value of the Gaussian function
+ * @param low		The lowest value of a weak edge
+ * @param high		The lowest value of a strong edge
+ * @param edges		If not NULL, the resulting edge pixels
+ * 			are also stored in this list
  */
-void lane_hysteresis_apply(lane_image_t *image, uint8_t weak, uint8_t strong);
+void lane_canny_apply(const lane_image_t *const src, lane_image_t **dest, uint8_t size, double variance, uint8_t low, uint8_t high, lane_edge_list_t *edges);
 
 #endif /* LANE_SOBEL_H */
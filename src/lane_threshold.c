@@ -10,51 +10,95 @@
 #include "lane_threshold.h"
 
 #include "lane_grayscale.h"
+#include "lane_log.h"
+#include "lane_simd.h"
 
 /*
  * @inheritDoc
  */
-void lane_threshold_apply(lane_image_t *image, uint8_t lower, uint8_t upper, uint8_t new, bool inside) {
-	lane_pixel_t pixel;
+void lane_threshold_apply(lane_image_t *image, uint8_t lower, uint8_t upper, uint8_t new, bool inside, lane_edge_list_t *edges) {
 	size_t x, y, index;
 
-	// Loop over each pixel
+	// Every channel of a grayscale pixel holds the same value,
+	// so the channels can be thresholded as separate values
+	lane_simd_threshold(&(image->data[0].r), (size_t) image->width * image->height * 3, lower, upper, new, inside);
+
+	if (!edges) {
+		return;
+	}
+
+	lane_edge_list_clear(edges, image->width, image->height);
+
 	for (y = 0; y < image->height; ++y) {
 		for (x = 0; x < image->width; ++x) {
 			index = (y * image->width) + x;
-			pixel = image->data[index];
-
-			// Check which mode we're using
-			if (!inside) {
-				// If the pixel value falls within the threshold,
-				// don't modify it.
-				if (pixel.r >= lower && pixel.r <= upper &&
-				    pixel.g >= lower && pixel.g <= upper &&
-				    pixel.b >= lower && pixel.b <= upper) {
-					continue;
-				}
 
-				// The value if not within the threshold.
-				// Replace it with the new value.
-				image->data[index].r = new;
-				image->data[index].g = new;
-				image->data[index].b = new;
-			} else {	
-				// If the pixel value falls within the threshold
-				// modify it
-				if (pixel.r >= lower && pixel.r <= upper &&
-				    pixel.g >= lower && pixel.g <= upper &&
-				    pixel.b >= lower && pixel.b <= upper) {
-					image->data[index].r = new;
-					image->data[index].g = new;
-					image->data[index].b = new;
-				} else {
-					image->data[index].r = 0;
-					image->data[index].g = 0;
-					image->data[index].b = 0;
-				}
+			if (image->data[index].r) {
+				lane_edge_list_push(edges, x, y, LANE_EDGE_NO_DIRECTION, image->data[index].r);
 			}
 		}
 	}
 }
 
+/*
+ * @inheritDoc
+ */
+int lane_threshold_apply_plane(lane_plane_t *plane, uint16_t lower, uint16_t upper, uint16_t new, bool inside, lane_edge_list_t *edges) {
+	uint8_t *row8;
+	uint16_t *row16, value;
+	size_t x, y;
+	bool within;
+
+	if (plane->type != LANE_PLANE_U8 && plane->type != LANE_PLANE_U16) {
+		LANE_LOG_ERROR("Only unsigned integer planes can be thresholded; aborting");
+		return 1;
+	}
+
+	if (edges) {
+		lane_edge_list_clear(edges, plane->width, plane->height);
+	}
+
+	for (y = 0; y < plane->height; ++y) {
+		if (plane->type == LANE_PLANE_U8) {
+			row8 = LANE_PLANE_ROW(plane, uint8_t, y);
+
+			// Bounds beyond the type are clipped, and a lower
+			// bound beyond it means no value is within the range
+			if (lower > UINT8_MAX) {
+				lane_simd_threshold(row8, plane->width, 1, 0, new > UINT8_MAX ? UINT8_MAX : new, inside);
+			} else {
+				lane_simd_threshold(row8, plane->width, lower, upper > UINT8_MAX ? UINT8_MAX : upper, new > UINT8_MAX ? UINT8_MAX : new, inside);
+			}
+
+			for (x = 0; edges && x < plane->width; ++x) {
+				if (row8[x]) {
+					lane_edge_list_push(edges, x, y, LANE_EDGE_NO_DIRECTION, row8[x]);
+				}
+			}
+
+			continue;
+		}
+
+		row16 = LANE_PLANE_ROW(plane, uint16_t, y);
+
+		for (x = 0; x < plane->width; ++x) {
+			value = row16[x];
+			within = value >= lower && value <= upper;
+
+			// The same two modes as for images
+			if (inside) {
+				value = within ? new : 0;
+			} else if (!within) {
+				value = new;
+			}
+
+			row16[x] = value;
+
+			if (edges && value) {
+				lane_edge_list_push(edges, x, y, LANE_EDGE_NO_DIRECTION, value > UINT8_MAX ? UINT8_MAX : value);
+			}
+		}
+	}
+
+	return 0;
+}
@@ -12,7 +12,9 @@
 
 #include <stdbool.h>
 
+#include "lane_edge.h"
 #include "lane_image.h"
+#include "lane_plane.h"
 
 /**
  * The default lower threshold.
@@ -38,7 +40,28 @@
  * 			(255 or LANE_THRESHOLD_UNUSED_UPPER for unused)
  * @param new		The replacement value when outside of threshold
  * @param inside	Replace inside or outside the range
+ * @param edges		If not NULL, the pixels that are non-zero after
+ * 			thresholding are also stored in this list
  */
-void lane_threshold_apply(lane_image_t *image, uint8_t lower, uint8_t upper, uint8_t new, bool inside);
+void lane_threshold_apply(lane_image_t *image, uint8_t lower, uint8_t upper, uint8_t new, bool inside, lane_edge_list_t *edges);
+
+/**
+ * @brief Replace values of a plane outside of a specific bound.
+ *
+ * Like lane_threshold_apply, but for a plane of type LANE_PLANE_U8
+ * or LANE_PLANE_U16, so the bounds may lie beyond 255.<br />
+ * <br />
+ * The magnitude of the pixels in the edge list is clamped to 255.
+ *
+ * @param plane		The plane that will be modified by this function
+ * @param lower		The inclusive lower bound of the threshold
+ * @param upper		The inclusive upper bound of the threshold
+ * @param new		The replacement value when outside of threshold
+ * @param inside	Replace inside or outside the range
+ * @param edges		If not NULL, the pixels that are non-zero after
+ * 			thresholding are also stored in this list
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_threshold_apply_plane(lane_plane_t *plane, uint16_t lower, uint16_t upper, uint16_t new, bool inside, lane_edge_list_t *edges);
 
 #endif /* LANE_THRESHOLD_H */
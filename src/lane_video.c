@@ -0,0 +1,332 @@
+/**
+ * @file lane_video.c
+ * @author Matthijs Bakker
+ * @brief Read the luma of YUV video streams
+ *
+ * This code unit provides the reading of recorded drives as video,
+ * frame by frame, from YUV4MPEG2 streams or from raw I420 and NV12
+ * streams. The streams can also be pipes, such as the output of
+ * a video decoder on the same machine.<br />
+ * <br />
+ * Only the luma of each frame is kept, which is the grayscale
+ * image that the rest of the pipeline works on. So there is no
+ * RGB decoding and no need for lane_grayscale_apply.
+ */
+
+#include "lane_video.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "lane_log.h"
+
+/**
+ * @internal
+ *
+ * The size of the buffer for the headers of a YUV4MPEG2 stream
+ */
+#define LINE_BUFFER_SIZE	(1024)
+
+/**
+ * @internal
+ *
+ * The size of the buffer for chroma that cannot be skipped
+ */
+#define SKIP_BUFFER_SIZE	(65536)
+
+/**
+ * @internal
+ *
+ * The start of a YUV4MPEG2 stream
+ */
+#define Y4M_MAGIC		"YUV4MPEG2"
+
+/**
+ * @internal
+ *
+ * The start of the header of each frame of a YUV4MPEG2 stream
+ */
+#define Y4M_FRAME		"FRAME"
+
+/**
+ * @internal
+ *
+ * Reads a header line of a YUV4MPEG2 stream, of which
+ * the part that does not fit the buffer is skipped.
+ *
+ * @param file		The stream
+ * @param line		The buffer of LINE_BUFFER_SIZE bytes
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+static int read_line(FILE *file, char *line);
+
+/**
+ * @internal
+ *
+ * Reads the header of a YUV4MPEG2 stream, and sets the
+ * dimensions and the chroma size of the video.
+ *
+ * @param video		The video
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+static int read_header(lane_video_t *video);
+
+/**
+ * @internal
+ *
+ * Skips the chroma of a frame, by seeking past it if the
+ * stream is a file that contains all of it, and by reading
+ * it otherwise, such as if it is a pipe.
+ *
+ * @param video		The video
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+static int skip_chroma(lane_video_t *video);
+
+/*
+ * @inheritDoc
+ */
+int lane_video_open(FILE *file, uint8_t format, uint16_t width, uint16_t height, lane_video_t **video) {
+	lane_video_t *out;
+	int result;
+
+	if (!file) {
+		LANE_LOG_ERROR("No file specified");
+		return 1;
+	}
+
+	if (format > LANE_VIDEO_NV12) {
+		LANE_LOG_ERROR("Unknown video format %d", format);
+		return 2;
+	}
+
+	out = calloc(1, sizeof(lane_video_t));
+
+	if (!out) {
+		LANE_LOG_ERROR("Unable to initialize memory");
+		return 5;
+	}
+
+	out->file = file;
+	out->format = format;
+	out->width = width;
+	out->height = height;
+
+	// Both raw layouts have quarter-size chroma, the header
+	// of a YUV4MPEG2 stream tells the size of its chroma
+	if (format == LANE_VIDEO_Y4M) {
+		result = read_header(out);
+
+		if (result) {
+			free(out);
+			return result;
+		}
+	} else {
+		out->chroma = 2 * (size_t) ((width + 1) / 2) * ((height + 1) / 2);
+	}
+
+	if (!out->width || !out->height) {
+		LANE_LOG_ERROR("Video has no dimensions");
+		free(out);
+
+		return 3;
+	}
+
+	out->luma = lane_plane_new(out->width, out->height, LANE_PLANE_U8);
+
+	if (!out->luma) {
+		free(out);
+		return 5;
+	}
+
+	LANE_LOG_INFO("Reading video of %u x %u", out->width, out->height);
+
+	(*video) = out;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+int lane_video_read(lane_video_t *video, const lane_plane_t **luma) {
+	char line[LINE_BUFFER_SIZE];
+	uint16_t y;
+
+	if (video->format == LANE_VIDEO_Y4M) {
+		if (read_line(video->file, line)) {
+			return feof(video->file) ? LANE_VIDEO_END : 2;
+		}
+
+		if (strncmp(line, Y4M_FRAME, strlen(Y4M_FRAME))) {
+			LANE_LOG_ERROR("Frame %zu has no frame header", video->frames);
+			return 3;
+		}
+	}
+
+	// The rows of the plane are padded, but the file is read
+	// in large blocks anyway, so each row is read directly
+	for (y = 0; y < video->height; ++y) {
+		if (fread(LANE_PLANE_ROW(video->luma, uint8_t, y), 1, video->width, video->file) < video->width) {
+			// Raw streams can only end before a frame
+			if (!y && video->format != LANE_VIDEO_Y4M && feof(video->file) && !ferror(video->file)) {
+				return LANE_VIDEO_END;
+			}
+
+			LANE_LOG_ERROR("Frame %zu ends after %d rows", video->frames, y);
+			return 4;
+		}
+	}
+
+	if (skip_chroma(video)) {
+		return 4;
+	}
+
+	++(video->frames);
+
+	(*luma) = video->luma;
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+void lane_video_close(lane_video_t *video) {
+	lane_plane_free(video->luma);
+	free(video->skip);
+	free(video);
+}
+
+/*
+ * @inheritDoc
+ */
+static int read_line(FILE *file, char *line) {
+	char rest[LINE_BUFFER_SIZE];
+
+	if (!fgets(line, LINE_BUFFER_SIZE, file)) {
+		return 1;
+	}
+
+	// Parameters beyond the buffer are not needed
+	if (!strchr(line, '\n')) {
+		while (fgets(rest, LINE_BUFFER_SIZE, file) && !strchr(rest, '\n'));
+	}
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+static int read_header(lane_video_t *video) {
+	char line[LINE_BUFFER_SIZE], *token, *state;
+	size_t width, height, planes;
+	bool alpha = false;
+
+	if (read_line(video->file, line) || strncmp(line, Y4M_MAGIC, strlen(Y4M_MAGIC))) {
+		LANE_LOG_ERROR("Stream is not in YUV4MPEG2 format");
+		return 3;
+	}
+
+	// Without a color space parameter, the chroma is 4:2:0
+	width = height = 0;
+	planes = 420;
+
+	for (token = strtok_r(line, " \n", &state); token; token = strtok_r(NULL, " \n", &state)) {
+		switch (token[0]) {
+			case 'W':
+				width = strtoul(&(token[1]), NULL, 10);
+				break;
+			case 'H':
+				height = strtoul(&(token[1]), NULL, 10);
+				break;
+			case 'C':
+				// Samples of more than 8 bits, such as C420p10
+				if (strlen(token) > 5 && token[4] == 'p' && isdigit(token[5])) {
+					LANE_LOG_ERROR("Only videos with 8-bit samples are supported");
+					return 3;
+				}
+
+				planes = !strncmp(&(token[1]), "mono", 4) ? 0 : strtoul(&(token[1]), NULL, 10);
+				alpha = strstr(token, "alpha") != NULL;
+				break;
+		}
+	}
+
+	if (!width || !height || width > UINT16_MAX || height > UINT16_MAX) {
+		LANE_LOG_ERROR("Video has invalid dimensions %zu x %zu", width, height);
+		return 3;
+	}
+
+	video->width = width;
+	video->height = height;
+
+	switch (planes) {
+		case 0:
+			video->chroma = 0;
+			break;
+		case 420:
+			video->chroma = 2 * ((width + 1) / 2) * ((height + 1) / 2);
+			break;
+		case 422:
+			video->chroma = 2 * ((width + 1) / 2) * height;
+			break;
+		case 444:
+			// The alpha plane of C444alpha is skipped as well
+			video->chroma = (alpha ? 3 : 2) * width * height;
+			break;
+		default:
+			LANE_LOG_ERROR("Video has unsupported chroma subsampling");
+			return 3;
+	}
+
+	return 0;
+}
+
+/*
+ * @inheritDoc
+ */
+static int skip_chroma(lane_video_t *video) {
+	struct stat info;
+	size_t left, amount;
+	off_t position;
+
+	if (!video->chroma) {
+		return 0;
+	}
+
+	// Seeking past the end of a file succeeds as well, so a file that
+	// ends within the chroma is read below instead, which detects it
+	position = ftello(video->file);
+
+	if (position >= 0 && !fstat(fileno(video->file), &info) && S_ISREG(info.st_mode)
+			&& info.st_size - position >= (off_t) video->chroma
+			&& !fseeko(video->file, video->chroma, SEEK_CUR)) {
+		return 0;
+	}
+
+	// Pipes cannot seek, so the chroma is read into a scratch buffer
+	if (!video->skip) {
+		video->skip = malloc(SKIP_BUFFER_SIZE);
+
+		if (!video->skip) {
+			LANE_LOG_ERROR("Unable to initialize memory");
+			return 1;
+		}
+	}
+
+	for (left = video->chroma; left > 0; left -= amount) {
+		amount = left < SKIP_BUFFER_SIZE ? left : SKIP_BUFFER_SIZE;
+
+		if (fread(video->skip, 1, amount, video->file) < amount) {
+			LANE_LOG_ERROR("Frame %zu ends in its chroma", video->frames);
+			return 1;
+		}
+	}
+
+	return 0;
+}
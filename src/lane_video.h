@@ -0,0 +1,103 @@
+/**
+ * @file lane_video.h
+ * @author Matthijs Bakker
+ * @brief Read the luma of YUV video streams
+ *
+ * This code unit provides the reading of recorded drives as video,
+ * frame by frame, from YUV4MPEG2 streams or from raw I420 and NV12
+ * streams. The streams can also be pipes, such as the output of
+ * a video decoder on the same machine.<br />
+ * <br />
+ * Only the luma of each frame is kept, which is the grayscale
+ * image that the rest of the pipeline works on. So there is no
+ * RGB decoding and no need for lane_grayscale_apply.
+ */
+
+#ifndef LANE_VIDEO_H
+#define LANE_VIDEO_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lane_plane.h"
+
+/**
+ * A YUV4MPEG2 stream, which has a header with the
+ * dimensions and a small header before each frame.
+ */
+#define LANE_VIDEO_Y4M		(0)
+
+/**
+ * A raw stream of frames in the I420 layout; the luma
+ * plane followed by the quarter-size U and V planes.
+ */
+#define LANE_VIDEO_I420		(1)
+
+/**
+ * A raw stream of frames in the NV12 layout; the luma plane
+ * followed by one quarter-size plane of interleaved U and V.
+ */
+#define LANE_VIDEO_NV12		(2)
+
+/**
+ * Returned by lane_video_read when the stream has no more frames.
+ */
+#define LANE_VIDEO_END		(1)
+
+/**
+ * @copydoc video
+ */
+typedef struct video	lane_video_t;
+
+/**
+ * @brief A video stream that is being read
+ *
+ * The luma plane is reused for every frame, so
+ * it is overwritten by the next lane_video_read.
+ */
+struct video {
+	FILE *file;
+	uint8_t format;
+	uint16_t width, height;
+	size_t chroma, frames;
+	uint8_t *skip;
+	lane_plane_t *luma;
+};
+
+/**
+ * @brief Open a video stream
+ *
+ * Starts reading a video from a file or a pipe. The dimensions of
+ * YUV4MPEG2 streams are read from their header, so they are only
+ * needed for raw streams.
+ *
+ * @param file		The stream, which is not closed by lane_video_close
+ * @param format	One of the LANE_VIDEO_* formats
+ * @param width		The width of the frames of a raw stream
+ * @param height	The height of the frames of a raw stream
+ * @param video		Where the new video should be placed
+ * @return		Zero if the operation succeeds, otherwise an error code
+ */
+int lane_video_open(FILE *file, uint8_t format, uint16_t width, uint16_t height, lane_video_t **video);
+
+/**
+ * @brief Read the next frame of a video stream
+ *
+ * Reads the luma of the next frame directly into the plane of
+ * the video, which is a LANE_PLANE_U8 plane, and skips the chroma.
+ *
+ * @param video		The video
+ * @param luma		Where the luma plane of the frame should be placed
+ * @return		Zero if the operation succeeds, LANE_VIDEO_END
+ * 			at the end of the stream, otherwise an error code
+ */
+int lane_video_read(lane_video_t *video, const lane_plane_t **luma);
+
+/**
+ * Deallocates a video and its plane.
+ *
+ * @param video		The video to be deallocated
+ */
+void lane_video_close(lane_video_t *video);
+
+#endif /* LANE_VIDEO_H */
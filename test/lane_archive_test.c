@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lane_archive.h"
+#include "lane_grayscale.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_plane.h"
+#include "lane_test_common.h"
+
+/**
+ * How the grayscale frames are stored
+ */
+#ifdef LANE_LZ4_ENABLE
+#define GRAY_COMPRESSION	(LANE_ARCHIVE_LZ4)
+#else
+#define GRAY_COMPRESSION	(LANE_ARCHIVE_RAW)
+#endif
+
+// To verify the archives, this test converts every frame
+// of a PPM file or stream into an archive, both as image
+// and as grayscale plane, and then compares the frames of
+// the archive to copies of them in reverse order
+
+int main(int argc, char **argv) {
+	lane_image_ppm_stream_t *stream = NULL;
+	lane_archive_writer_t *writer = NULL;
+	lane_archive_t *archive = NULL;
+	lane_image_t *image = NULL,
+		     *view = NULL,
+		     **copies = NULL;
+	lane_plane_t *gray = NULL,
+		     *plane = NULL,
+		     **grays = NULL;
+	FILE *file, *output_file;
+	size_t frames = 0, i;
+	uint16_t y;
+	int result;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	file = fopen(argv[1], "rb");
+	output_file = fopen(argv[2], "wb+");
+
+	if (!file || !output_file || lane_image_ppm_stream_open(file, &stream) || lane_archive_writer_open(output_file, &writer)) {
+		LANE_LOG_ERROR("Files '%s' and '%s' cannot be opened", argv[1], argv[2]);
+		return 2;
+	}
+
+	while (!(result = lane_image_ppm_stream_read(stream, &image))) {
+		if (lane_grayscale_apply_plane(image, &gray)
+				|| lane_archive_write_image(writer, image, LANE_ARCHIVE_RAW)
+				|| lane_archive_write_plane(writer, gray, GRAY_COMPRESSION)) {
+			LANE_LOG_ERROR("Error while writing frame %zu to '%s'", frames, argv[2]);
+			return 4;
+		}
+
+		copies = realloc(copies, (frames + 1) * sizeof(lane_image_t *));
+		grays = realloc(grays, (frames + 1) * sizeof(lane_plane_t *));
+
+		if (!copies || !grays) {
+			return 6;
+		}
+
+		copies[frames] = lane_image_copy(image);
+		grays[frames] = gray;
+		++frames;
+	}
+
+	if (result != LANE_IMAGE_PPM_END || lane_archive_writer_close(writer)) {
+		return 4;
+	}
+
+	if (lane_archive_open(output_file, &archive) || archive->count != frames * 2) {
+		LANE_LOG_ERROR("Archive '%s' cannot be opened", argv[2]);
+		return 3;
+	}
+
+	// Random access, so the frames are compared from the last one
+	for (i = frames; i-- > 0;) {
+		image = copies[i];
+		gray = grays[i];
+
+		LANE_PROFILE(read, result = lane_archive_read(archive, i * 2, &view, &plane)
+				|| !view || memcmp(view->data, image->data, (size_t) image->width * image->height * sizeof(lane_pixel_t))
+				|| lane_archive_read(archive, (i * 2) + 1, &view, &plane) || !plane);
+
+		for (y = 0; !result && y < gray->height; ++y) {
+			result = memcmp(LANE_PLANE_ROW(plane, uint8_t, y), LANE_PLANE_ROW(gray, uint8_t, y), gray->width);
+		}
+
+		if (result) {
+			LANE_LOG_ERROR("Frame %zu of the archive differs from the file", i);
+			return 5;
+		}
+
+		lane_image_free(image);
+		lane_plane_free(gray);
+	}
+
+	free(copies);
+	free(grays);
+
+	lane_archive_close(archive);
+	lane_image_ppm_stream_close(stream);
+
+	fclose(file);
+	fclose(output_file);
+
+	return 0;
+}
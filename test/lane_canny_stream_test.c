@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lane_edge.h"
+#include "lane_gaussian.h"
+#include "lane_grayscale.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_sobel.h"
+#include "lane_test_common.h"
+
+/**
+ * @see test/lane_gaussian_test.c#GAUSSIAN_SIZE
+ */
+#define GAUSSIAN_SIZE		(5)
+
+/**
+ * @see test/lane_gaussian_test.c#GAUSSIAN_VARIANCE
+ */
+#define GAUSSIAN_VARIANCE	(1.4)
+
+/**
+ * @see test/lane_canny_test.c#LOWER_THRESHOLD
+ */
+#define LOWER_THRESHOLD		(4)
+
+/**
+ * @see test/lane_canny_test.c#UPPER_THRESHOLD
+ */
+#define UPPER_THRESHOLD		(32)
+
+// To verify that the fused operator equals the separate stages,
+// this test also applies them one by one and compares both the
+// output images and the lists of edge pixels
+
+int main(int argc, char **argv) {
+	lane_image_t *input = NULL,
+		     *edges = NULL,
+		     *blurred = NULL,
+		     *sobel = NULL,
+		     *chained = NULL;
+	lane_edge_list_t *list, *chained_list;
+	uint8_t *sectors = NULL;
+	int result = 0;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	list = lane_edge_list_new(0, 0);
+	chained_list = lane_edge_list_new(0, 0);
+
+	if (!list || !chained_list) {
+		return 5;
+	}
+
+	LANE_PROFILE(grayscale, lane_grayscale_apply(input));
+	LANE_PROFILE(canny, lane_canny_apply(input, &edges, GAUSSIAN_SIZE, GAUSSIAN_VARIANCE, LOWER_THRESHOLD, UPPER_THRESHOLD, list));
+
+	if (!edges) {
+		return 5;
+	}
+
+	LANE_PROFILE(gaussian, lane_gaussian_apply_gray(input, &blurred, GAUSSIAN_SIZE, GAUSSIAN_VARIANCE, LANE_GAUSSIAN_EXACT));
+	LANE_PROFILE(sobel, lane_sobel_apply_sectors(blurred, &sobel, &sectors));
+
+	if (!sobel) {
+		return 5;
+	}
+
+	LANE_PROFILE(nonmax, lane_nonmax_apply_sectors(sobel, sectors, &chained, NULL));
+	LANE_PROFILE(hysteresis, lane_hysteresis_apply_thresholds(chained, LOWER_THRESHOLD, UPPER_THRESHOLD, chained_list));
+
+	if (edges->width != chained->width || edges->height != chained->height
+			|| memcmp(edges->data, chained->data, (size_t) edges->width * edges->height * sizeof(lane_pixel_t))) {
+		LANE_LOG_ERROR("The fused operator differs from the separate stages");
+		result = 6;
+	} else if (list->size != chained_list->size
+			|| memcmp(list->points, chained_list->points, list->size * sizeof(lane_edge_point_t))) {
+		LANE_LOG_ERROR("The edge pixels differ from the separate stages");
+		result = 6;
+	}
+
+	if (!result) {
+		TEST_SAVE_IMAGE(argv[2], edges);
+	}
+
+	lane_image_free(input);
+	lane_image_free(edges);
+	lane_image_free(blurred);
+	lane_image_free(sobel);
+	lane_image_free(chained);
+	lane_edge_list_free(list);
+	lane_edge_list_free(chained_list);
+	free(sectors);
+
+	return result;
+}
@@ -1,4 +1,3 @@
-#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -9,7 +8,6 @@
 #include "lane_log.h"
 #include "lane_sobel.h"
 #include "lane_test_common.h"
-#include "lane_threshold.h"
 
 /**
  * The threshold at which edges are questionable
@@ -24,34 +22,23 @@
 int main(int argc, char **argv) {
 	lane_image_t *input = NULL,
 		     *sobel = NULL,
-		     *edges = NULL,
-		     *weak = NULL,
-		     *strong = NULL;
-	double *directions = NULL;
+		     *edges = NULL;
+	uint8_t *sectors = NULL;
 
 	TEST_CHECK_ARGS(argc, argv);
 
 	TEST_LOAD_IMAGE(argv[1], input);
 
-	LANE_PROFILE(sobel, lane_sobel_apply(input, &sobel, &directions));
-	LANE_PROFILE(nonmax, lane_nonmax_apply(sobel, directions, &edges));
+	LANE_PROFILE(sobel, lane_sobel_apply_sectors(input, &sobel, &sectors));
+	LANE_PROFILE(nonmax, lane_nonmax_apply_sectors(sobel, sectors, &edges, NULL));
+	LANE_PROFILE(hysteresis, lane_hysteresis_apply_thresholds(edges, LOWER_THRESHOLD, UPPER_THRESHOLD, NULL));
 
-	weak = lane_image_copy(edges);
-	strong = lane_image_copy(edges);
-
-	lane_threshold_apply(weak, LOWER_THRESHOLD, (UPPER_THRESHOLD - 1), 64, true);
-	lane_threshold_apply(strong, UPPER_THRESHOLD, 255, 255, true);
-	lane_image_add(weak, strong);
-	lane_hysteresis_apply(weak, 64, 255);
-
-	TEST_SAVE_IMAGE(argv[2], weak);
+	TEST_SAVE_IMAGE(argv[2], edges);
 
 	lane_image_free(input);
 	lane_image_free(sobel);
 	lane_image_free(edges);
-	lane_image_free(weak);
-	lane_image_free(strong);
-	free(directions);
+	free(sectors);
 
 	return 0;
 }
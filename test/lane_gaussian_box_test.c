@@ -0,0 +1,116 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lane_gaussian.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_test_common.h"
+
+/**
+ * The smallest sigma for which the box approximation is documented
+ */
+#define SIGMA_MIN		(3.0)
+
+/**
+ * The largest sigma for which the box approximation is documented
+ */
+#define SIGMA_MAX		(8.0)
+
+/**
+ * The difference between the sigma values that are checked
+ */
+#define SIGMA_STEP		(0.5)
+
+/**
+ * The largest difference with the exact kernel, in levels
+ *
+ * @see src/lane_gaussian.h#LANE_GAUSSIAN_BOX
+ */
+#define MAX_ERROR		(3)
+
+/**
+ * The largest average difference with the exact kernel, in levels
+ *
+ * @see src/lane_gaussian.h#LANE_GAUSSIAN_BOX
+ */
+#define MEAN_ERROR		(0.2)
+
+// To verify the error bound of the box approximation, this test
+// blurs the image with both methods for every sigma in the range
+// that is documented, with a kernel of at least 6 sigma, and
+// saves the approximation with the largest sigma
+
+int main(int argc, char **argv) {
+	lane_image_t *image = NULL,
+		     *exact = NULL,
+		     *box = NULL;
+	const lane_color_t *e, *b;
+	double sigma, total;
+	size_t i, n;
+	uint8_t size;
+	int d, worst, result = 0;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], image);
+
+	for (sigma = SIGMA_MIN; sigma <= SIGMA_MAX; sigma += SIGMA_STEP) {
+		if (exact) {
+			lane_image_free(exact);
+		}
+
+		if (box) {
+			lane_image_free(box);
+		}
+
+		// The smallest odd size that covers three sigma on each side
+		size = (2 * (uint8_t) ceil(3 * sigma)) + 1;
+
+		LANE_PROFILE(exact, lane_gaussian_apply(image, &exact, size, sigma, LANE_GAUSSIAN_EXACT));
+		LANE_PROFILE(box, lane_gaussian_apply(image, &box, size, sigma, LANE_GAUSSIAN_BOX));
+
+		if (!exact->data || !box->data) {
+			LANE_LOG_ERROR("Unable to blur with sigma %.1f", sigma);
+			result = 5;
+			break;
+		}
+
+		if (exact->width != box->width || exact->height != box->height) {
+			LANE_LOG_ERROR("Sizes differ for sigma %.1f", sigma);
+			result = 5;
+			break;
+		}
+
+		n = (size_t) exact->width * exact->height * sizeof(lane_pixel_t);
+		e = &(exact->data->r);
+		b = &(box->data->r);
+		total = 0;
+		worst = 0;
+
+		for (i = 0; i < n; ++i) {
+			d = abs(e[i] - b[i]);
+			total += d;
+			worst = d > worst ? d : worst;
+		}
+
+		LANE_LOG_INFO("Sigma %.1f differs by at most %d and %.3f on average", sigma, worst, total / n);
+
+		if (worst > MAX_ERROR || total / n >= MEAN_ERROR) {
+			LANE_LOG_ERROR("Box approximation with sigma %.1f is outside of the bound", sigma);
+			result = 6;
+			break;
+		}
+	}
+
+	if (!result) {
+		TEST_SAVE_IMAGE(argv[2], box);
+	}
+
+	lane_image_free(image);
+	lane_image_free(exact);
+	lane_image_free(box);
+
+	return result;
+}
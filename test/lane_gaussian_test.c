@@ -21,6 +21,11 @@
  */
 #define GAUSSIAN_VARIANCE	(2.5)
 
+/**
+ * Whether to use the exact kernel or the box approximation.
+ */
+#define GAUSSIAN_METHOD		(LANE_GAUSSIAN_EXACT)
+
 int main(int argc, char **argv) {
 	lane_image_t *image = NULL,
 		     *out = NULL;
@@ -29,7 +34,7 @@ int main(int argc, char **argv) {
 
 	TEST_LOAD_IMAGE(argv[1], image);
 	
-	LANE_PROFILE(gaussian, lane_gaussian_apply(image, &out, GAUSSIAN_SIZE, GAUSSIAN_VARIANCE));
+	LANE_PROFILE(gaussian, lane_gaussian_apply(image, &out, GAUSSIAN_SIZE, GAUSSIAN_VARIANCE, GAUSSIAN_METHOD));
 
 	TEST_SAVE_IMAGE(argv[2], out);
 
@@ -0,0 +1,92 @@
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lane_hough.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_kmeans.h"
+#include "lane_log.h"
+#include "lane_sobel.h"
+#include "lane_test_common.h"
+#include "lane_threshold.h"
+
+/**
+ * @see test/lane_sobel_test.c#ARTIFACT_THRESHOLD
+ */
+#define ARTIFACT_THRESHOLD	(100)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_THRESHOLD
+ */
+#define HOUGH_THRESHOLD		(100)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MIN
+ */
+#define HOUGH_ANGLE_MIN		(0)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MAX
+ */
+#define HOUGH_ANGLE_MAX		(180)
+
+/**
+ * Amount of degrees to vote for around the gradient direction
+ */
+#define HOUGH_WINDOW		(5)
+
+/**
+ * @see test/lane_hough_kmeans_test.c#KMEANS_CLUSTERS
+ */
+#define KMEANS_CLUSTERS		(2)
+
+/**
+ * @see test/lane_hough_kmeans_test.c#KMEANS_ITERATIONS
+ */
+#define KMEANS_ITERATIONS	(255)
+
+int main(int argc, char **argv) {
+	lane_image_t *input = NULL,
+		     *edges = NULL,
+		     *overlay = NULL;
+	lane_hough_normal_t *normals = NULL;
+	lane_hough_space_t *space = NULL;
+	lane_hough_plan_t *plan = NULL;
+	lane_kmeans_medoid_t *medoids = NULL;
+	double *directions = NULL;
+	size_t lines_amount, i;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	LANE_PROFILE(sobel, lane_sobel_apply(input, &edges, &directions));
+	LANE_PROFILE(threshold, lane_threshold_apply(edges, ARTIFACT_THRESHOLD, 255, 0, false, NULL));
+
+	plan = lane_hough_plan_new(edges->width, edges->height, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX);
+
+	LANE_PROFILE(hough, lines_amount = lane_hough_apply_gradient(edges, directions, plan, HOUGH_WINDOW, &space, &normals, HOUGH_THRESHOLD));
+	lane_kmeans_apply(normals, lines_amount, &medoids, KMEANS_ITERATIONS, KMEANS_CLUSTERS);
+
+	// plot lines onto copy of the edges to create a nice overlay
+	overlay = lane_image_copy(edges);
+	for (i = 0; i < KMEANS_CLUSTERS; ++i) {
+		lane_kmeans_medoid_plot(overlay, plan, medoids[i]);
+	}
+
+	TEST_SAVE_IMAGE(argv[2], overlay);
+
+	lane_image_free(input);
+	lane_image_free(edges);
+	lane_image_free(overlay);
+	free(directions);
+	free(normals);
+	free(medoids);
+	free(space->acc);
+	free(space);
+	lane_hough_plan_free(plan);
+
+	return 0;
+}
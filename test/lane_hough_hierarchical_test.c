@@ -0,0 +1,134 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lane_edge.h"
+#include "lane_hough.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_kmeans.h"
+#include "lane_log.h"
+#include "lane_sobel.h"
+#include "lane_test_common.h"
+
+/**
+ * @see test/lane_sobel_test.c#ARTIFACT_THRESHOLD
+ */
+#define ARTIFACT_THRESHOLD	(100)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_THRESHOLD
+ */
+#define HOUGH_THRESHOLD		(100)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MIN
+ */
+#define HOUGH_ANGLE_MIN		(0)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MAX
+ */
+#define HOUGH_ANGLE_MAX		(180)
+
+/**
+ * Amount of fine cells in one coarse cell, per dimension
+ */
+#define HOUGH_FACTOR		(4)
+
+/**
+ * Only every n-th edge pixel votes at the coarse level
+ */
+#define HOUGH_DECIMATION	(4)
+
+/**
+ * A threshold below twice the decimation, which
+ * would leave no threshold at the coarse level
+ */
+#define HOUGH_THRESHOLD_LOW	(HOUGH_DECIMATION)
+
+/**
+ * How many times slower the low threshold may be, as it
+ * should still only refine the cells that received votes
+ */
+#define HOUGH_SLOWDOWN		(4)
+
+/**
+ * @see test/lane_hough_kmeans_test.c#KMEANS_CLUSTERS
+ */
+#define KMEANS_CLUSTERS		(2)
+
+/**
+ * @see test/lane_hough_kmeans_test.c#KMEANS_ITERATIONS
+ */
+#define KMEANS_ITERATIONS	(255)
+
+int main(int argc, char **argv) {
+	lane_image_t *input = NULL,
+		     *sobel = NULL;
+	lane_edge_list_t *list = NULL;
+	lane_hough_normal_t *normals = NULL,
+			    *weak = NULL;
+	lane_hough_plan_t *plan = NULL;
+	lane_kmeans_medoid_t *medoids = NULL;
+	double *directions = NULL;
+	size_t lines_amount, weak_amount, i, j;
+	clock_t start, normal, low;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	list = lane_edge_list_new(0, 0);
+
+	LANE_PROFILE(sobel, lane_sobel_apply(input, &sobel, &directions));
+	LANE_PROFILE(collect, lane_edge_list_from_image(sobel, NULL, ARTIFACT_THRESHOLD, list));
+
+	LANE_LOG_INFO("%lu edge pixels were emitted", list->size);
+
+	plan = lane_hough_plan_new(list->width, list->height, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX);
+
+	start = clock();
+	LANE_PROFILE(hough, lines_amount = lane_hough_apply_hierarchical(list, plan, HOUGH_FACTOR, HOUGH_FACTOR, HOUGH_DECIMATION, &normals, HOUGH_THRESHOLD));
+	normal = clock() - start;
+
+	start = clock();
+	LANE_PROFILE(hough_low, weak_amount = lane_hough_apply_hierarchical(list, plan, HOUGH_FACTOR, HOUGH_FACTOR, HOUGH_DECIMATION, &weak, HOUGH_THRESHOLD_LOW));
+	low = clock() - start;
+
+	// A lower threshold only adds lines
+	for (i = 0; i < lines_amount; ++i) {
+		for (j = 0; j < weak_amount && (weak[j].rho != normals[i].rho || weak[j].theta != normals[i].theta); ++j);
+
+		if (j == weak_amount) {
+			LANE_LOG_ERROR("Line rho=%d th=%d is missing with threshold %d", normals[i].rho, normals[i].theta, HOUGH_THRESHOLD_LOW);
+			return 5;
+		}
+	}
+
+	if (low > (normal + 1) * HOUGH_SLOWDOWN) {
+		LANE_LOG_ERROR("Threshold %d took %ld ticks instead of at most %ld", HOUGH_THRESHOLD_LOW, (long) low, (long) (normal + 1) * HOUGH_SLOWDOWN);
+		return 6;
+	}
+
+	lane_kmeans_apply(normals, lines_amount, &medoids, KMEANS_ITERATIONS, KMEANS_CLUSTERS);
+
+	// plot lines onto the edges to create a nice overlay
+	for (i = 0; i < KMEANS_CLUSTERS; ++i) {
+		lane_kmeans_medoid_plot(sobel, plan, medoids[i]);
+	}
+
+	TEST_SAVE_IMAGE(argv[2], sobel);
+
+	lane_image_free(input);
+	lane_image_free(sobel);
+	lane_edge_list_free(list);
+	free(directions);
+	free(normals);
+	free(weak);
+	free(medoids);
+	lane_hough_plan_free(plan);
+
+	return 0;
+}
@@ -42,6 +42,7 @@ int main(int argc, char **argv) {
 		     *overlay = NULL;
 	lane_hough_normal_t *normals = NULL;
 	lane_hough_space_t *space = NULL;
+	lane_hough_plan_t *plan = NULL;
 	lane_kmeans_medoid_t *medoids = NULL;
 	size_t lines_amount, i;
 
@@ -49,13 +50,15 @@ int main(int argc, char **argv) {
 
 	TEST_LOAD_IMAGE(argv[1], input);
 
-	lines_amount = lane_hough_apply(input, &space, &normals, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX, HOUGH_THRESHOLD);
+	plan = lane_hough_plan_new(input->width, input->height, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX);
+
+	lines_amount = lane_hough_apply(input, plan, &space, &normals, HOUGH_THRESHOLD);
 	lane_kmeans_apply(normals, lines_amount, &medoids, KMEANS_ITERATIONS, KMEANS_CLUSTERS);
 
 	// plot lines onto copy of current image to create a nice overlay
 	overlay = lane_image_copy(input);
 	for (i = 0; i < KMEANS_CLUSTERS; ++i) {
-		lane_kmeans_medoid_plot(overlay, space, medoids[i]);
+		lane_kmeans_medoid_plot(overlay, plan, medoids[i]);
 	}
 
 	TEST_SAVE_IMAGE(argv[2], overlay);
@@ -66,6 +69,7 @@ int main(int argc, char **argv) {
 	free(medoids);
 	free(space->acc);
 	free(space);
+	lane_hough_plan_free(plan);
 
 	return 0;
 }
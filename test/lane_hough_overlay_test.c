@@ -33,19 +33,22 @@ int main(int argc, char **argv) {
 	lane_hough_resolved_line_t *lines = NULL;
 	lane_hough_normal_t *normals = NULL;
 	lane_hough_space_t *space = NULL;
+	lane_hough_plan_t *plan = NULL;
 	size_t lines_amount, i;
 
 	TEST_CHECK_ARGS(argc, argv);
 
 	TEST_LOAD_IMAGE(argv[1], input);
 	
-	lines_amount = lane_hough_apply(input, &space, &normals, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX, HOUGH_THRESHOLD);
+	plan = lane_hough_plan_new(input->width, input->height, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX);
+
+	lines_amount = lane_hough_apply(input, plan, &space, &normals, HOUGH_THRESHOLD);
 
 	// plot lines onto copy of current image to create a nice overlay
 	overlay = lane_image_copy(input);
 	lines = calloc(lines_amount, sizeof(lane_hough_resolved_line_t));
 	for (i = 0; i < lines_amount; ++i) {
-		lines[i] = lane_hough_resolve_line(overlay, space, normals[i]);
+		lines[i] = lane_hough_resolve_line(overlay, plan, normals[i]);
 		lane_hough_plot_line(overlay, &(lines[i]));
 	}
 
@@ -59,6 +62,7 @@ int main(int argc, char **argv) {
 	free(normals);
 	free(space->acc);
 	free(space);
+	lane_hough_plan_free(plan);
 
 	return 0;
 }
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lane_grayscale.h"
+#include "lane_hough.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_sobel.h"
+#include "lane_test_common.h"
+
+/**
+ * @see test/lane_hough_space_test.c#HOUGH_THRESHOLD
+ */
+#define HOUGH_THRESHOLD		(100)
+
+/**
+ * @see test/lane_hough_space_test.c#HOUGH_ANGLE_MIN
+ */
+#define HOUGH_ANGLE_MIN		(0)
+
+/**
+ * @see test/lane_hough_space_test.c#HOUGH_ANGLE_MAX
+ */
+#define HOUGH_ANGLE_MAX		(180)
+
+/**
+ * The amounts of threads to compare with the serial transform,
+ * including ones that do not divide the amount of angles
+ */
+#define HOUGH_THREADS		{1, 2, 3, 4, 7, 16}
+
+// To verify the parallel transform, this test compares its
+// accumulator and lines with those of the serial transform
+// of the Sobel magnitudes, for several amounts of threads
+
+int main(int argc, char **argv) {
+	const uint8_t threads[] = HOUGH_THREADS;
+	lane_image_t *input = NULL,
+		     *magnitudes = NULL,
+		     *visualization = NULL;
+	lane_hough_normal_t *normals = NULL,
+			    *parallel_normals = NULL;
+	lane_hough_space_t *space = NULL,
+			   *parallel_space = NULL;
+	lane_hough_plan_t *plan = NULL;
+	double *directions = NULL;
+	size_t lines_amount, parallel_amount, i;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	lane_grayscale_apply(input);
+	lane_sobel_apply(input, &magnitudes, &directions);
+
+	plan = lane_hough_plan_new(magnitudes->width, magnitudes->height, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX);
+
+	LANE_PROFILE(serial, lines_amount = lane_hough_apply(magnitudes, plan, &space, &normals, HOUGH_THRESHOLD));
+
+	for (i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+		LANE_PROFILE(parallel, parallel_amount = lane_hough_apply_parallel(magnitudes, plan, threads[i], &parallel_space, &parallel_normals, HOUGH_THRESHOLD));
+
+		if (parallel_space->width != space->width || parallel_space->height != space->height
+				|| memcmp(parallel_space->acc, space->acc, space->size * sizeof(lane_hough_cell_t))) {
+			LANE_LOG_ERROR("The accumulator of %d threads differs from the serial one", threads[i]);
+			return 5;
+		}
+
+		if (parallel_amount != lines_amount || memcmp(parallel_normals, normals, lines_amount * sizeof(lane_hough_normal_t))) {
+			LANE_LOG_ERROR("The lines of %d threads differ from the serial ones", threads[i]);
+			return 6;
+		}
+
+		free(parallel_normals);
+		free(parallel_space->acc);
+		free(parallel_space);
+	}
+
+	LANE_LOG_INFO("%lu lines were found by every amount of threads", lines_amount);
+
+	// output the accumulator to the image
+	visualization = lane_image_new(space->width, space->height);
+	lane_hough_plot_graph(visualization, space);
+
+	TEST_SAVE_IMAGE(argv[2], visualization);
+
+	lane_image_free(input);
+	lane_image_free(magnitudes);
+	lane_image_free(visualization);
+	free(directions);
+	free(normals);
+	free(space->acc);
+	free(space);
+	lane_hough_plan_free(plan);
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lane_hough.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_sobel.h"
+#include "lane_test_common.h"
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_THRESHOLD
+ */
+#define HOUGH_THRESHOLD		(250)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MIN
+ */
+#define HOUGH_ANGLE_MIN		(0)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MAX
+ */
+#define HOUGH_ANGLE_MAX		(180)
+
+/**
+ * Which part of the image lies above the horizon, in percent.
+ */
+#define ROI_HORIZON		(40)
+
+/**
+ * The amount of corners of the region of interest.
+ */
+#define ROI_CORNERS		(4)
+
+/**
+ * The amount of bands in which lane markings are expected.
+ */
+#define ROI_BANDS		(2)
+
+int main(int argc, char **argv) {
+	lane_image_t *input = NULL,
+		     *sobel = NULL;
+	lane_hough_resolved_line_t line;
+	lane_hough_normal_t *normals = NULL;
+	lane_hough_space_t *space = NULL;
+	lane_hough_plan_t *plan = NULL;
+	lane_hough_vertex_t vertices[ROI_CORNERS];
+	const lane_hough_band_t bands[ROI_BANDS] = {
+		{20, 70},
+		{110, 160}
+	};
+	double *directions = NULL;
+	size_t lines_amount, i;
+	uint16_t horizon;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	LANE_PROFILE(sobel, lane_sobel_apply(input, &sobel, &directions));
+
+	plan = lane_hough_plan_new(sobel->width, sobel->height, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX);
+	horizon = (sobel->height * ROI_HORIZON) / 100;
+
+	// A trapezoid from the bottom corners up to the horizon,
+	// where the left and right markings are expected
+	vertices[0] = (lane_hough_vertex_t) {0, sobel->height};
+	vertices[1] = (lane_hough_vertex_t) {(sobel->width / 2) - (sobel->width / 10), horizon};
+	vertices[2] = (lane_hough_vertex_t) {(sobel->width / 2) + (sobel->width / 10), horizon};
+	vertices[3] = (lane_hough_vertex_t) {sobel->width, sobel->height};
+
+	lane_hough_plan_set_horizon(plan, horizon);
+
+	if (lane_hough_plan_set_roi(plan, vertices, ROI_CORNERS)
+			|| lane_hough_plan_set_bands(plan, bands, ROI_BANDS)) {
+		return 1;
+	}
+
+	LANE_PROFILE(hough, lines_amount = lane_hough_apply(sobel, plan, &space, &normals, HOUGH_THRESHOLD));
+
+	for (i = 0; i < lines_amount; ++i) {
+		line = lane_hough_resolve_line(sobel, plan, normals[i]);
+		lane_hough_plot_line(sobel, &line);
+	}
+
+	LANE_LOG_INFO("%lu lines were plotted", lines_amount);
+
+	TEST_SAVE_IMAGE(argv[2], sobel);
+
+	lane_image_free(input);
+	lane_image_free(sobel);
+	free(directions);
+	free(normals);
+	free(space->acc);
+	free(space);
+	lane_hough_plan_free(plan);
+
+	return 0;
+}
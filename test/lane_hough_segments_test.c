@@ -0,0 +1,67 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lane_hough.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_test_common.h"
+
+/**
+ * Accumulator value threshold for PPHT
+ */
+#define HOUGH_THRESHOLD		(50)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MIN
+ */
+#define HOUGH_ANGLE_MIN		(0)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MAX
+ */
+#define HOUGH_ANGLE_MAX		(180)
+
+/**
+ * Segments shorter than this amount of pixels are discarded
+ */
+#define HOUGH_MIN_LENGTH	(40)
+
+/**
+ * Segments may skip this amount of pixels without edges
+ */
+#define HOUGH_MAX_GAP		(5)
+
+int main(int argc, char **argv) {
+	lane_image_t *input = NULL,
+		     *overlay = NULL;
+	lane_hough_resolved_line_t *segments = NULL;
+	lane_hough_plan_t *plan = NULL;
+	size_t segments_amount, i;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	plan = lane_hough_plan_new(input->width, input->height, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX);
+
+	LANE_PROFILE(hough, segments_amount = lane_hough_apply_probabilistic(input, plan, HOUGH_THRESHOLD, HOUGH_MIN_LENGTH, HOUGH_MAX_GAP, &segments));
+
+	// plot segments onto copy of current image to create a nice overlay
+	overlay = lane_image_copy(input);
+	for (i = 0; i < segments_amount; ++i) {
+		lane_hough_plot_line(overlay, &(segments[i]));
+	}
+
+	LANE_LOG_INFO("%lu segments were plotted", segments_amount);
+
+	TEST_SAVE_IMAGE(argv[2], overlay);
+
+	lane_image_free(input);
+	lane_image_free(overlay);
+	free(segments);
+	lane_hough_plan_free(plan);
+
+	return 0;
+}
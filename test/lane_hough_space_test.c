@@ -32,12 +32,15 @@ int main(int argc, char **argv) {
 		     *visualization = NULL;
 	lane_hough_normal_t *normals = NULL;
 	lane_hough_space_t *space = NULL;
+	lane_hough_plan_t *plan = NULL;
 
 	TEST_CHECK_ARGS(argc, argv);
 
 	TEST_LOAD_IMAGE(argv[1], input);
 
-	(void) lane_hough_apply(input, &space, &normals, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX, HOUGH_THRESHOLD);
+	plan = lane_hough_plan_new(input->width, input->height, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX);
+
+	(void) lane_hough_apply(input, plan, &space, &normals, HOUGH_THRESHOLD);
 
 	// output the accumulator to the image
 	visualization = lane_image_new(space->width, space->height);
@@ -50,6 +53,7 @@ int main(int argc, char **argv) {
 	free(normals);
 	free(space->acc);
 	free(space);
+	lane_hough_plan_free(plan);
 
 	return 0;
 }
@@ -0,0 +1,116 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lane_edge.h"
+#include "lane_hough.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_kmeans.h"
+#include "lane_log.h"
+#include "lane_sobel.h"
+#include "lane_test_common.h"
+
+/**
+ * @see test/lane_sobel_test.c#ARTIFACT_THRESHOLD
+ */
+#define ARTIFACT_THRESHOLD	(100)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_THRESHOLD
+ */
+#define HOUGH_THRESHOLD		(100)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MIN
+ */
+#define HOUGH_ANGLE_MIN		(0)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MAX
+ */
+#define HOUGH_ANGLE_MAX		(180)
+
+/**
+ * @see test/lane_hough_gradient_test.c#HOUGH_WINDOW
+ */
+#define HOUGH_WINDOW		(5)
+
+/**
+ * Old votes lose 1/2^n of their value each frame
+ */
+#define STREAM_DECAY		(2)
+
+/**
+ * Only one in n edge pixels votes per frame
+ */
+#define STREAM_SUBSAMPLE	(4)
+
+/**
+ * The amount of frames to feed into the stream, which
+ * is enough for the accumulator to settle
+ */
+#define STREAM_FRAMES		(16)
+
+/**
+ * @see test/lane_hough_kmeans_test.c#KMEANS_CLUSTERS
+ */
+#define KMEANS_CLUSTERS		(2)
+
+/**
+ * @see test/lane_hough_kmeans_test.c#KMEANS_ITERATIONS
+ */
+#define KMEANS_ITERATIONS	(255)
+
+int main(int argc, char **argv) {
+	lane_image_t *input = NULL,
+		     *sobel = NULL;
+	lane_edge_list_t *list = NULL;
+	lane_hough_normal_t *normals = NULL;
+	lane_hough_plan_t *plan = NULL;
+	lane_hough_stream_t *stream = NULL;
+	lane_kmeans_medoid_t *medoids = NULL;
+	double *directions = NULL;
+	size_t lines_amount = 0, i;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	list = lane_edge_list_new(0, 0);
+
+	LANE_PROFILE(sobel, lane_sobel_apply(input, &sobel, &directions));
+	LANE_PROFILE(collect, lane_edge_list_from_image(sobel, directions, ARTIFACT_THRESHOLD, list));
+
+	LANE_LOG_INFO("%lu edge pixels were emitted", list->size);
+
+	plan = lane_hough_plan_new(list->width, list->height, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX);
+
+	stream = lane_hough_stream_new(plan, STREAM_DECAY, STREAM_SUBSAMPLE);
+
+	// Pretend that the image is a video where nothing moves
+	for (i = 0; i < STREAM_FRAMES; ++i) {
+		free(normals);
+		LANE_PROFILE(hough, lines_amount = lane_hough_stream_apply(stream, list, HOUGH_WINDOW, &normals, HOUGH_THRESHOLD));
+	}
+
+	lane_kmeans_apply(normals, lines_amount, &medoids, KMEANS_ITERATIONS, KMEANS_CLUSTERS);
+
+	// plot lines onto the edges to create a nice overlay
+	for (i = 0; i < KMEANS_CLUSTERS; ++i) {
+		lane_kmeans_medoid_plot(sobel, plan, medoids[i]);
+	}
+
+	TEST_SAVE_IMAGE(argv[2], sobel);
+
+	lane_image_free(input);
+	lane_image_free(sobel);
+	lane_edge_list_free(list);
+	free(directions);
+	free(normals);
+	free(medoids);
+	lane_hough_stream_free(stream);
+	lane_hough_plan_free(plan);
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lane_image.h"
+#include "lane_image_jpeg.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_plane.h"
+#include "lane_test_common.h"
+
+/**
+ * The divisor of the dimensions of the downscaled plane.
+ */
+#define JPEG_SCALE		(4)
+
+// To verify the JPEG loader, this test decodes a
+// JPEG image at full size and in grayscale at a
+// smaller size, and then saves the former
+
+int main(int argc, char **argv) {
+	lane_image_t *image = NULL;
+	lane_plane_t *gray = NULL;
+	FILE *file;
+	int result;
+
+	if (argc < 3) {
+		LANE_LOG_ERROR("Argument 1 must be the filename of the JPEG image and argument 2 must be a destination");
+		return 1;
+	}
+
+	file = fopen(argv[1], "rb");
+
+	if (!file) {
+		LANE_LOG_ERROR("File '%s' cannot be opened", argv[1]);
+		return 2;
+	}
+
+	LANE_PROFILE(jpeg, result = lane_image_jpeg_from_file(file, &image, 1));
+
+	if (result) {
+		LANE_LOG_ERROR("Error while loading image from file '%s'", argv[1]);
+		return 3;
+	}
+
+	rewind(file);
+
+	LANE_PROFILE(jpeg_gray, result = lane_image_jpeg_gray_from_file(file, &gray, JPEG_SCALE));
+
+	fclose(file);
+
+	if (result) {
+		LANE_LOG_ERROR("Error while loading plane from file '%s'", argv[1]);
+		return 3;
+	}
+
+	// The scaled dimensions are rounded up
+	if (gray->width != (image->width + JPEG_SCALE - 1) / JPEG_SCALE
+			|| gray->height != (image->height + JPEG_SCALE - 1) / JPEG_SCALE) {
+		LANE_LOG_ERROR("Plane is %u x %u for an image of %u x %u", gray->width, gray->height, image->width, image->height);
+		return 5;
+	}
+
+	TEST_SAVE_IMAGE(argv[2], image);
+
+	lane_image_free(image);
+	lane_plane_free(gray);
+
+	return 0;
+}
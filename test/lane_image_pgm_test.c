@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_plane.h"
+#include "lane_sobel.h"
+#include "lane_test_common.h"
+
+// To verify the PGM save functionality, this test
+// saves the Sobel magnitudes of an image as a PGM
+// file and then maps that file to compare them
+
+int main(int argc, char **argv) {
+	lane_plane_t *gray = NULL,
+		     *magnitudes = NULL,
+		     *expected = NULL;
+	lane_image_map_t *map = NULL;
+	FILE *file;
+	uint16_t y;
+	int result;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	file = fopen(argv[1], "rb");
+
+	if (!file || lane_image_ppm_gray_from_file(file, &gray)) {
+		LANE_LOG_ERROR("Error while loading plane from file '%s'", argv[1]);
+		return 2;
+	}
+
+	fclose(file);
+
+	if (lane_sobel_apply_plane(gray, &magnitudes, NULL, NULL)
+			|| lane_plane_convert(magnitudes, LANE_PLANE_U8, &expected)) {
+		return 3;
+	}
+
+	file = fopen(argv[2], "wb");
+
+	if (!file) {
+		LANE_LOG_ERROR("Output file '%s' cannot be opened", argv[2]);
+		return 4;
+	}
+
+	LANE_PROFILE(save, result = lane_image_ppm_plane_to_file(file, magnitudes));
+
+	fclose(file);
+
+	if (result) {
+		LANE_LOG_ERROR("Error while outputting to file '%s'", argv[2]);
+		return 4;
+	}
+
+	file = fopen(argv[2], "rb");
+
+	if (!file || lane_image_ppm_map(file, &map) || !map->plane) {
+		LANE_LOG_ERROR("Error while mapping plane from file '%s'", argv[2]);
+		return 5;
+	}
+
+	fclose(file);
+
+	for (y = 0; y < expected->height; ++y) {
+		if (map->plane->width != expected->width || map->plane->height != expected->height
+				|| memcmp(LANE_PLANE_ROW(map->plane, uint8_t, y), LANE_PLANE_ROW(expected, uint8_t, y), expected->width)) {
+			LANE_LOG_ERROR("Row %d of the saved plane differs", y);
+			return 6;
+		}
+	}
+
+	lane_plane_free(gray);
+	lane_plane_free(magnitudes);
+	lane_plane_free(expected);
+	lane_image_ppm_unmap(map);
+
+	return 0;
+}
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lane_grayscale.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_plane.h"
+#include "lane_test_common.h"
+
+int main(int argc, char **argv) {
+	lane_image_t *input = NULL,
+		     *output = NULL;
+	lane_plane_t *gray = NULL;
+	FILE *gray_file;
+	const uint8_t *row;
+	uint16_t x, y;
+	int result, d;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	// The separate passes, to compare against
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	LANE_PROFILE(grayscale, lane_grayscale_apply(input));
+
+	gray_file = fopen(argv[1], "rb");
+
+	if (!gray_file) {
+		LANE_LOG_ERROR("File '%s' cannot be opened", argv[1]);
+		return 2;
+	}
+
+	LANE_PROFILE(load_gray, result = lane_image_ppm_gray_from_file(gray_file, &gray));
+
+	fclose(gray_file);
+
+	if (result) {
+		LANE_LOG_ERROR("Error while loading plane from file '%s'", argv[1]);
+		return 3;
+	}
+
+	// Rounding instead of truncating adds at most one
+	for (y = 0; y < gray->height; ++y) {
+		row = LANE_PLANE_ROW(gray, uint8_t, y);
+
+		for (x = 0; x < gray->width; ++x) {
+			d = row[x] - input->data[(y * input->width) + x].r;
+
+			if (d < -1 || d > 1) {
+				LANE_LOG_ERROR("Gray value at (%d,%d) is %d instead of %d", x, y, row[x], input->data[(y * input->width) + x].r);
+				return 5;
+			}
+		}
+	}
+
+	if (lane_plane_to_image(gray, &output)) {
+		return 6;
+	}
+
+	TEST_SAVE_IMAGE(argv[2], output);
+
+	lane_image_free(input);
+	lane_image_free(output);
+	lane_plane_free(gray);
+
+	return 0;
+}
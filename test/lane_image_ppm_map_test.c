@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lane_grayscale.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_test_common.h"
+
+int main(int argc, char **argv) {
+	lane_image_t *input = NULL;
+	lane_image_map_t *map = NULL,
+			 *buffered = NULL,
+			 *second = NULL;
+	FILE *map_file, *stream;
+	uint8_t *twice;
+	size_t size;
+	int result;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	// The copying loader, to compare against
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	map_file = fopen(argv[1], "rb");
+
+	if (!map_file) {
+		LANE_LOG_ERROR("File '%s' cannot be opened", argv[1]);
+		return 2;
+	}
+
+	LANE_PROFILE(map, result = lane_image_ppm_map(map_file, &map));
+
+	if (result || !map->mapped || !map->image) {
+		LANE_LOG_ERROR("Error while mapping image from file '%s'", argv[1]);
+		return 3;
+	}
+
+	size = (size_t) input->width * input->height * sizeof(lane_pixel_t);
+
+	if (map->image->width != input->width || map->image->height != input->height
+			|| memcmp(map->image->data, input->data, size)) {
+		LANE_LOG_ERROR("The mapped image differs from the loaded one");
+		return 5;
+	}
+
+	// A stream in memory has no descriptor, like a pipe it cannot be
+	// mapped, and each image of it is buffered separately
+	twice = malloc(2 * map->length);
+
+	if (!twice) {
+		return 6;
+	}
+
+	memcpy(twice, map->base, map->length);
+	memcpy(&(twice[map->length]), map->base, map->length);
+
+	stream = fmemopen(twice, 2 * map->length, "rb");
+
+	if (!stream || lane_image_ppm_map(stream, &buffered) || buffered->mapped
+			|| memcmp(buffered->image->data, input->data, size)
+			|| lane_image_ppm_map(stream, &second)
+			|| memcmp(second->image->data, input->data, size)) {
+		LANE_LOG_ERROR("The buffered images differ from the loaded one");
+		return 6;
+	}
+
+	fclose(stream);
+	free(twice);
+	fclose(map_file);
+
+	// Filters work on the view like on any other image
+	LANE_PROFILE(grayscale, lane_grayscale_apply(map->image));
+
+	TEST_SAVE_IMAGE(argv[2], map->image);
+
+	lane_image_free(input);
+	lane_image_ppm_unmap(map);
+	lane_image_ppm_unmap(buffered);
+	lane_image_ppm_unmap(second);
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lane_grayscale.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_test_common.h"
+
+// To verify the PPM streams, this test converts every frame
+// of a stream of PPM images, such as the output of ffmpeg with
+// -f image2pipe -c:v ppm or a few images joined by cat, to
+// grayscale and writes them to one output stream. Either of
+// them can be "-" to use a pipe instead.
+
+int main(int argc, char **argv) {
+	lane_image_ppm_stream_t *input = NULL,
+				*output = NULL;
+	lane_image_t *image = NULL;
+	const lane_pixel_t *previous = NULL;
+	uint16_t width = 0, height = 0;
+	FILE *file, *output_file;
+	int result;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	file = strcmp(argv[1], "-") ? fopen(argv[1], "rb") : stdin;
+
+	// Log messages are printed to stdout, so a stream to stdout gets
+	// its own descriptor, and stdout itself is sent to stderr instead
+	if (strcmp(argv[2], "-")) {
+		output_file = fopen(argv[2], "wb");
+	} else {
+		fflush(stdout);
+		output_file = fdopen(dup(STDOUT_FILENO), "wb");
+
+		if (output_file) {
+			dup2(STDERR_FILENO, STDOUT_FILENO);
+		}
+	}
+
+	if (!file || !output_file) {
+		LANE_LOG_ERROR("Streams '%s' and '%s' cannot be opened", argv[1], argv[2]);
+		return 2;
+	}
+
+	if (lane_image_ppm_stream_open(file, &input) || lane_image_ppm_stream_open(output_file, &output)) {
+		return 2;
+	}
+
+	while (!(result = lane_image_ppm_stream_read(input, &image))) {
+		// Frames of the same size must not be allocated again, but
+		// the image of the previous frame is gone if the size changed
+		if (previous && width == image->width && height == image->height && previous != image->data) {
+			LANE_LOG_ERROR("Frame %zu was not read into the pixels of the previous frame", input->frames);
+			return 5;
+		}
+
+		previous = image->data;
+		width = image->width;
+		height = image->height;
+
+		LANE_PROFILE(grayscale, lane_grayscale_apply(image));
+
+		if (lane_image_ppm_stream_write(output, image)) {
+			LANE_LOG_ERROR("Error while outputting to file '%s'", argv[2]);
+			return 4;
+		}
+	}
+
+	if (result != LANE_IMAGE_PPM_END || !input->frames || input->frames != output->frames) {
+		LANE_LOG_ERROR("Error while reading frame %zu of '%s'", input->frames, argv[1]);
+		return 3;
+	}
+
+	LANE_LOG_INFO("Converted %zu frames", input->frames);
+
+	lane_image_ppm_stream_close(input);
+	lane_image_ppm_stream_close(output);
+
+	if (file != stdin) {
+		fclose(file);
+	}
+
+	fclose(output_file);
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lane_gaussian.h"
+#include "lane_grayscale.h"
+#include "lane_hough.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_plane.h"
+#include "lane_sobel.h"
+#include "lane_test_common.h"
+#include "lane_threshold.h"
+
+/**
+ * @see test/lane_gaussian_test.c#GAUSSIAN_SIZE
+ */
+#define GAUSSIAN_SIZE		(5)
+
+/**
+ * @see test/lane_gaussian_test.c#GAUSSIAN_VARIANCE
+ */
+#define GAUSSIAN_VARIANCE	(1.4)
+
+/**
+ * The lowest gradient magnitude of an edge, which
+ * may lie beyond 255 for planes of 16-bit values.
+ */
+#define EDGE_THRESHOLD		(300)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_THRESHOLD
+ */
+#define HOUGH_THRESHOLD		(250)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MIN
+ */
+#define HOUGH_ANGLE_MIN		(0)
+
+/**
+ * @see test/lane_hough_overlay_test.c#HOUGH_ANGLE_MAX
+ */
+#define HOUGH_ANGLE_MAX		(180)
+
+int main(int argc, char **argv) {
+	lane_image_t *input = NULL,
+		     *output = NULL;
+	lane_plane_t *gray = NULL,
+		     *blurred = NULL,
+		     *magnitudes = NULL,
+		     *edges = NULL;
+	lane_hough_resolved_line_t line;
+	lane_hough_normal_t *normals = NULL;
+	lane_hough_space_t *space = NULL;
+	lane_hough_plan_t *plan = NULL;
+	size_t lines_amount, i;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	LANE_PROFILE(grayscale, lane_grayscale_apply_plane(input, &gray));
+	LANE_PROFILE(gaussian, lane_gaussian_apply_plane(gray, &blurred, GAUSSIAN_SIZE, GAUSSIAN_VARIANCE, LANE_GAUSSIAN_EXACT));
+	LANE_PROFILE(sobel, lane_sobel_apply_plane(blurred, &magnitudes, NULL, NULL));
+	LANE_PROFILE(threshold, lane_threshold_apply_plane(magnitudes, EDGE_THRESHOLD, UINT16_MAX, UINT8_MAX, true, NULL));
+
+	if (!magnitudes || lane_plane_convert(magnitudes, LANE_PLANE_U8, &edges)) {
+		return 5;
+	}
+
+	plan = lane_hough_plan_new(edges->width, edges->height, HOUGH_ANGLE_MIN, HOUGH_ANGLE_MAX);
+
+	LANE_PROFILE(hough, lines_amount = lane_hough_apply_plane(edges, plan, &space, &normals, HOUGH_THRESHOLD));
+
+	if (lane_plane_to_image(edges, &output)) {
+		return 6;
+	}
+
+	for (i = 0; i < lines_amount; ++i) {
+		line = lane_hough_resolve_line(output, plan, normals[i]);
+		lane_hough_plot_line(output, &line);
+	}
+
+	LANE_LOG_INFO("%lu lines were plotted", lines_amount);
+
+	TEST_SAVE_IMAGE(argv[2], output);
+
+	lane_image_free(input);
+	lane_image_free(output);
+	lane_plane_free(gray);
+	lane_plane_free(blurred);
+	lane_plane_free(magnitudes);
+	lane_plane_free(edges);
+	free(normals);
+	free(space->acc);
+	free(space);
+	lane_hough_plan_free(plan);
+
+	return 0;
+}
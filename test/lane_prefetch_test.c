@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lane_grayscale.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_prefetch.h"
+#include "lane_test_common.h"
+
+/**
+ * The amount of times that the image is loaded
+ */
+#define FRAMES			(16)
+
+/**
+ * The amount of frames that is read ahead
+ */
+#define DEPTH			(3)
+
+// To verify the prefetcher, this test loads the same
+// image a number of times on the background thread,
+// compares every frame to the image that was loaded
+// directly and saves the grayscale of the last frame
+
+int main(int argc, char **argv) {
+	const char *paths[FRAMES];
+	lane_image_t *input = NULL,
+		     *image = NULL;
+	lane_prefetch_t *prefetch = NULL;
+	size_t frames = 0, i;
+	int result;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	for (i = 0; i < FRAMES; ++i) {
+		paths[i] = argv[1];
+	}
+
+	if (lane_prefetch_open(paths, FRAMES, DEPTH, &prefetch)) {
+		return 2;
+	}
+
+	while (!(result = lane_prefetch_next(prefetch, &image))) {
+		if (image->width != input->width || image->height != input->height
+				|| memcmp(image->data, input->data, (size_t) input->width * input->height * sizeof(lane_pixel_t))) {
+			LANE_LOG_ERROR("Frame %zu differs from the image", frames);
+			return 5;
+		}
+
+		// Processing happens while the next frames are read
+		LANE_PROFILE(grayscale, lane_grayscale_apply(image));
+
+		++frames;
+	}
+
+	if (result != LANE_PREFETCH_END || frames != FRAMES) {
+		LANE_LOG_ERROR("Only %zu of %d frames were loaded", frames, FRAMES);
+		return 3;
+	}
+
+	TEST_SAVE_IMAGE(argv[2], image);
+
+	lane_prefetch_close(prefetch);
+	lane_image_free(input);
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lane_grayscale.h"
+#include "lane_image.h"
+#include "lane_image_ppm.h"
+#include "lane_laplace.h"
+#include "lane_log.h"
+#include "lane_simd.h"
+#include "lane_sobel.h"
+#include "lane_test_common.h"
+
+/**
+ * @see test/lane_gaussian_test.c#GAUSSIAN_SIZE
+ */
+#define GAUSSIAN_SIZE		(5)
+
+/**
+ * @see test/lane_gaussian_test.c#GAUSSIAN_VARIANCE
+ */
+#define GAUSSIAN_VARIANCE	(1.4)
+
+/**
+ * @see test/lane_canny_test.c#LOWER_THRESHOLD
+ */
+#define LOWER_THRESHOLD		(4)
+
+/**
+ * @see test/lane_canny_test.c#UPPER_THRESHOLD
+ */
+#define UPPER_THRESHOLD		(32)
+
+/**
+ * Checks whether two images have the same size and pixels.
+ */
+#define SAME_IMAGE(a, b)	((a)->width == (b)->width && (a)->height == (b)->height \
+				&& !memcmp((a)->data, (b)->data, (size_t) (a)->width * (a)->height * sizeof(lane_pixel_t)))
+
+int main(int argc, char **argv) {
+	lane_image_t *input = NULL,
+		     *gray[2] = {NULL},
+		     *laplace[2] = {NULL},
+		     *sobel[2] = {NULL},
+		     *magnitudes[2] = {NULL},
+		     *canny[2] = {NULL};
+	double *directions[2] = {NULL};
+	uint8_t *sectors[2] = {NULL},
+		levels[2];
+	int i;
+
+	TEST_CHECK_ARGS(argc, argv);
+
+	TEST_LOAD_IMAGE(argv[1], input);
+
+	// Run the filters with the plain C kernels
+	// and with the best ones of this processor
+	levels[0] = LANE_SIMD_SCALAR;
+	levels[1] = lane_simd_level();
+
+	LANE_LOG_INFO("Comparing SIMD level %d with the plain C kernels", levels[1]);
+
+	for (i = 0; i < 2; ++i) {
+		if (lane_simd_set_level(levels[i])) {
+			return 5;
+		}
+
+		gray[i] = lane_image_copy(input);
+
+		LANE_PROFILE(grayscale, lane_grayscale_apply(gray[i]));
+		LANE_PROFILE(laplace, lane_laplace_apply(gray[i], &(laplace[i])));
+		LANE_PROFILE(sobel, lane_sobel_apply_sectors(gray[i], &(sobel[i]), &(sectors[i])));
+		LANE_PROFILE(sobel_directions, lane_sobel_apply(gray[i], &(magnitudes[i]), &(directions[i])));
+		LANE_PROFILE(canny, lane_canny_apply(gray[i], &(canny[i]), GAUSSIAN_SIZE, GAUSSIAN_VARIANCE, LOWER_THRESHOLD, UPPER_THRESHOLD, NULL));
+	}
+
+	if (!SAME_IMAGE(gray[0], gray[1]) || !SAME_IMAGE(laplace[0], laplace[1])
+			|| !SAME_IMAGE(sobel[0], sobel[1]) || !SAME_IMAGE(canny[0], canny[1])
+			|| memcmp(sectors[0], sectors[1], (size_t) sobel[0]->width * sobel[0]->height)
+			|| !SAME_IMAGE(magnitudes[0], magnitudes[1]) || !SAME_IMAGE(magnitudes[0], sobel[0])
+			|| memcmp(directions[0], directions[1], (size_t) magnitudes[0]->width * magnitudes[0]->height * sizeof(double))) {
+		LANE_LOG_ERROR("The results of SIMD level %d differ from the plain C kernels", levels[1]);
+		return 6;
+	}
+
+	TEST_SAVE_IMAGE(argv[2], canny[1]);
+
+	lane_image_free(input);
+
+	for (i = 0; i < 2; ++i) {
+		lane_image_free(gray[i]);
+		lane_image_free(laplace[i]);
+		lane_image_free(sobel[i]);
+		lane_image_free(magnitudes[i]);
+		free(directions[i]);
+		lane_image_free(canny[i]);
+		free(sectors[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lane_gaussian.h"
+#include "lane_image_ppm.h"
+#include "lane_log.h"
+#include "lane_plane.h"
+#include "lane_sobel.h"
+#include "lane_test_common.h"
+#include "lane_threshold.h"
+#include "lane_video.h"
+
+/**
+ * @see test/lane_gaussian_test.c#GAUSSIAN_SIZE
+ */
+#define GAUSSIAN_SIZE		(5)
+
+/**
+ * @see test/lane_gaussian_test.c#GAUSSIAN_VARIANCE
+ */
+#define GAUSSIAN_VARIANCE	(1.4)
+
+/**
+ * @see test/lane_plane_test.c#EDGE_THRESHOLD
+ */
+#define EDGE_THRESHOLD		(300)
+
+// To verify the video reader, this test finds the edges
+// in the luma of every frame of a YUV4MPEG2 stream, which
+// can be "-" to read it from a pipe, and saves the edges
+// of the last frame as a PGM file
+
+int main(int argc, char **argv) {
+	const lane_plane_t *luma = NULL;
+	lane_plane_t *blurred = NULL,
+		     *magnitudes = NULL;
+	lane_video_t *video = NULL;
+	FILE *file, *output_file;
+	int result;
+
+	if (argc < 3) {
+		LANE_LOG_ERROR("Argument 1 must be the filename of the Y4M video and argument 2 must be a destination");
+		return 1;
+	}
+
+	file = strcmp(argv[1], "-") ? fopen(argv[1], "rb") : stdin;
+
+	if (!file || lane_video_open(file, LANE_VIDEO_Y4M, 0, 0, &video)) {
+		LANE_LOG_ERROR("Video '%s' cannot be opened", argv[1]);
+		return 2;
+	}
+
+	while (!(result = lane_video_read(video, &luma))) {
+		if (magnitudes) {
+			lane_plane_free(magnitudes);
+		}
+
+		LANE_PROFILE(gaussian, lane_gaussian_apply_plane(luma, &blurred, GAUSSIAN_SIZE, GAUSSIAN_VARIANCE, LANE_GAUSSIAN_EXACT));
+		LANE_PROFILE(sobel, lane_sobel_apply_plane(blurred, &magnitudes, NULL, NULL));
+		LANE_PROFILE(threshold, lane_threshold_apply_plane(magnitudes, EDGE_THRESHOLD, UINT16_MAX, UINT16_MAX, true, NULL));
+
+		lane_plane_free(blurred);
+	}
+
+	if (result != LANE_VIDEO_END || !magnitudes) {
+		LANE_LOG_ERROR("Error while reading frame %zu", video->frames);
+		return 3;
+	}
+
+	LANE_LOG_INFO("%zu frames were read", video->frames);
+
+	output_file = fopen(argv[2], "wb");
+
+	if (!output_file || lane_image_ppm_plane_to_file(output_file, magnitudes)) {
+		LANE_LOG_ERROR("Error while outputting to file '%s'", argv[2]);
+		return 4;
+	}
+
+	fclose(output_file);
+	fclose(file);
+
+	lane_plane_free(magnitudes);
+	lane_video_close(video);
+
+	return 0;
+}